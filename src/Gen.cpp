@@ -1,9 +1,11 @@
 #include "Gen.h"
+#include "Runtime.h"
 #include <boost/foreach.hpp>
 #include <boost/range/algorithm/find.hpp>
 #include <boost/range/algorithm_ext/push_back.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/format.hpp>
 #include <boost/filesystem/path.hpp>
 
 #include <fstream>
@@ -18,6 +20,47 @@ using boost::range::push_back;
 using boost::algorithm::replace_first;
 namespace fs = boost::filesystem;
 
+Gen::Gen(const GenOptions & options) : options(options)
+{
+}
+
+void Gen::genRuntime(const string & outDir) const
+{
+	genRuntimeFile(outDir, "cppXbString.h", cppXbStringH);
+	if (options.pullParser || options.snapshots) {
+		genRuntimeFile(outDir, "cppXbFile.h", cppXbFileH);
+	}
+	if (options.pullParser) {
+		genRuntimeFile(outDir, "cppXbReader.h", cppXbReaderH);
+		genRuntimeFile(outDir, "cppXbScan.h", cppXbScanH);
+		genRuntimeFile(outDir, "cppXbParallel.h", cppXbParallelH);
+		genRuntimeFile(outDir, "cppXbValidate.h", cppXbValidateH);
+	}
+	if (options.snapshots) {
+		genRuntimeFile(outDir, "cppXbSnapshot.h", cppXbSnapshotH);
+	}
+	if (options.lazyTypes) {
+		genRuntimeFile(outDir, "cppXbLazy.h", cppXbLazyH);
+	}
+	if (options.dirtyTracking) {
+		genRuntimeFile(outDir, "cppXbDirty.h", cppXbDirtyH);
+	}
+	if (options.statistics) {
+		genRuntimeFile(outDir, "cppXbStats.h", cppXbStatsH);
+	}
+	if (options.pod) {
+		genRuntimeFile(outDir, "cppXbPod.h", cppXbPodH);
+	}
+	if (options.allocators) {
+		genRuntimeFile(outDir, "cppXbArena.h", cppXbArenaH);
+	}
+	genRuntimeFile(outDir, "cppXbConvert.h", cppXbConvertH);
+	genRuntimeFile(outDir, "cppXbWriter.h", cppXbWriterH);
+	genRuntimeFile(outDir, "cppXbBinary.h", cppXbBinaryH);
+	genRuntimeFile(outDir, "cppXbPatch.h", cppXbPatchH);
+	genRuntimeFile(outDir, "cppXbColumns.h", cppXbColumnsH);
+}
+
 bool Gen::isBasicType(const string & type) const
 {
 	return type == "bool"
@@ -28,6 +71,11 @@ bool Gen::isBasicType(const string & type) const
 	       || type == "long";
 }
 
+bool Gen::isPolymorphic(const Type & t) const
+{
+	return !t.pChildTypes.empty();
+}
+
 bool Gen::hasString(const Type & t) const
 {
 	BOOST_FOREACH(const Field & f, t.fields) {
@@ -50,261 +98,2385 @@ bool Gen::hasVector(const Type & t) const
 			return true;
 		}
 	}
-	BOOST_FOREACH(const Type & st, t.subTypes) {
-		if (hasVector(st)) {
-			return true;
+	BOOST_FOREACH(const Type & st, t.subTypes) {
+		if (hasVector(st)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Gen::hasOptional(const Type & t) const
+{
+	BOOST_FOREACH(const Field & f, t.fields) {
+		if (f.isOptionnal) {
+			return true;
+		}
+	}
+	BOOST_FOREACH(const Type & st, t.subTypes) {
+		if (hasOptional(st)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Gen::hasVirtual(const Type & t) const
+{
+	BOOST_FOREACH(const Field & f, t.fields) {
+		if (f.pType && isPolymorphic(*f.pType)) {
+			return true;
+		}
+	}
+	BOOST_FOREACH(const Type & st, t.subTypes) {
+		if (hasVirtual(st)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Gen::usesAllocator(const Field & f) const
+{
+	if (!options.allocators) {
+		return false;
+	}
+	if (f.type == "string") {
+		return !options.stringViews;
+	}
+	return f.pType && !isPolymorphic(*f.pType);
+}
+
+bool Gen::isStreamed(const Field & f) const
+{
+	if (f.size >= 0 || !options.pullParser) {
+		return false;
+	}
+	return f.isStreamed || options.streamedFields.count(f.pParentType->fullPath + "." + f.name) > 0;
+}
+
+bool Gen::hasStreamed(const Type & t) const
+{
+	BOOST_FOREACH(const Field & f, t.fields) {
+		if (isStreamed(f)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Gen::hasRepeatedElements(const Type & t) const
+{
+	vector<Field const *> fields;
+	getAllFields(t, fields);
+	BOOST_FOREACH(const Field * f, fields) {
+		if (!f->isAttr && f->size < 0 && !usesColumns(*f)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Gen::isLazy(const Field & f) const
+{
+	return options.lazyTypes && !f.isAttr && f.pType;
+}
+
+// A columnar type only holds single or optional values of simple types, so that each of its
+// fields is one array of the columns; it is neither derived nor a base type.
+bool Gen::isColumnar(const Type & t) const
+{
+	if (!t.columns && !options.columnTypes.count(t.fullPath)) {
+		return false;
+	}
+	if (t.fields.empty() || !t.superType.empty() || !t.pChildTypes.empty() || !t.subTypes.empty()) {
+		throw runtime_error("Type " + t.fullPath + " cannot be stored by column: it has no field, is derived, a base or has nested types.");
+	}
+	BOOST_FOREACH(const Field & f, t.fields) {
+		if (f.pType || (f.size != 1 && !f.isOptionnal)) {
+			throw runtime_error("Type " + t.fullPath + " cannot be stored by column: field " + f.name + " is not a simple value.");
+		}
+	}
+	return true;
+}
+
+bool Gen::hasColumnar(const vector<Type> & types) const
+{
+	BOOST_FOREACH(const Type & t, types) {
+		if (isColumnar(t) || hasColumnar(t.subTypes)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Streamed fields keep their item type, the visitor receiving whole values.
+bool Gen::usesColumns(const Field & f) const
+{
+	return !f.isAttr && f.size < 0 && f.pType && !isStreamed(f) && isColumnar(*f.pType);
+}
+
+bool Gen::hasMask(const Field & f) const
+{
+	return !f.isAttr && f.pType && !isPolymorphic(*f.pType) && !usesColumns(f);
+}
+
+bool Gen::hasTypeTag(const Type & t) const
+{
+	return isPolymorphic(t) || t.pSuperType;
+}
+
+// Tags are numbered depth first from the root of the hierarchy, so the tags of t and of
+// all the types derived from it form the range [tag, tagEnd).
+void Gen::getTypeTags(const Type & t, unsigned & tag, unsigned & tagEnd) const
+{
+	const Type * root = &t;
+	while (root->pSuperType) {
+		root = root->pSuperType;
+	}
+	vector<Type *> hierarchy, children;
+	getAllChildTypes(*root, hierarchy);
+	getAllChildTypes(t, children);
+	tag = 0;
+	for (size_t i = 0; i < hierarchy.size(); i++) {
+		if (hierarchy[i] == &t) {
+			tag = i + 1;
+		}
+	}
+	tagEnd = tag + children.size() + 1;
+}
+
+void Gen::getAllChildTypes(const Type & t, vector<Type *> & types) const
+{
+	BOOST_FOREACH(Type * ct, t.pChildTypes) {
+		types.push_back(ct);
+		getAllChildTypes(*ct, types);
+	}
+}
+
+// FNV-1a, the generated nameHash computes the same value at parse time.
+unsigned Gen::nameHash(const string & name) const
+{
+	unsigned h = 2166136261u;
+	BOOST_FOREACH(char c, name) {
+		h = (h ^ (unsigned char)c) * 16777619u;
+	}
+	return h & 0xffffffffu;
+}
+
+// 64 bits FNV-1a of the description of t and of every type its binary encoding depends on.
+unsigned long long Gen::fingerprint(const Type & t) const
+{
+	set<const Type *> seen;
+	string desc = "cppXb binary 1";
+	describeType(t, seen, desc);
+	unsigned long long h = 14695981039346656037ull;
+	BOOST_FOREACH(char c, desc) {
+		h = (h ^ (unsigned char)c) * 1099511628211ull;
+	}
+	return h;
+}
+
+void Gen::describeType(const Type & t, set<const Type *> & seen, string & desc) const
+{
+	if (!seen.insert(&t).second) {
+		return;
+	}
+	vector<Field const *> fields;
+	getAllFields(t, fields);
+	desc += "\n" + t.fullPath + (hasTypeTag(t) ? "#" + boost::lexical_cast<string>(t.pChildTypes.size()) : "") + "{";
+	BOOST_FOREACH(const Field * f, fields) {
+		desc += f->name + ":" + f->type + (f->isAttr ? "@" : "") + (f->isOptionnal ? "?" : "")
+		        + "[" + boost::lexical_cast<string>(f->size) + "];";
+		if (f->pEnum) {
+			desc += "(" + boost::join(f->pEnum->values, "|") + ")";
+		}
+	}
+	desc += "}";
+	BOOST_FOREACH(const Field * f, fields) {
+		if (f->pType) {
+			describeType(*f->pType, seen, desc);
+		}
+	}
+	if (isPolymorphic(t)) {
+		vector<Type *> childTypes;
+		getAllChildTypes(t, childTypes);
+		BOOST_FOREACH(Type * ct, childTypes) {
+			describeType(*ct, seen, desc);
+		}
+	}
+}
+
+bool Gen::isSubType(const string & n, const Type & t) const
+{
+	BOOST_FOREACH(const Type & st, t.subTypes) {
+		if (n.find(st.name) != string::npos) {
+			return true;
+		}
+		if (isSubType(n, st)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+string Gen::cppType(const Type & t) const
+{
+	string ct = t.fullPath;
+	boost::replace_all(ct, ".", "::");
+	return ct;
+}
+
+string Gen::cppType(const Field & f, bool absolute) const
+{
+	string t = f.type;
+	if (absolute && f.pType) {
+		t = cppType(*f.pType);
+	}
+	if (f.type == "string" && options.stringViews) {
+		t = "cppxb::xstring";
+	} else if (f.type == "string" && options.allocators) {
+		t = "std::pmr::string";
+	}
+	if (f.pType && isPolymorphic(*f.pType)) {
+		t = ptrType() + "< " + t + " >";
+	}
+	if (f.isOptionnal) {
+		t = "boost::optional< " + t + " >";
+	} else if (usesColumns(f)) {
+		t = t + "::columns";
+	} else if (f.size < 0) {
+		t = (options.allocators ? "std::pmr::vector< " : "vector< ") + t + " >";
+	} else if (f.size > 1) {
+		t = "boost::array<" + t + "," + boost::lexical_cast<string>(f.size) + ">";
+	}
+	return t;
+}
+
+string Gen::ptrType() const
+{
+	return options.allocators ? "cppxb::arena_ptr" : "boost::shared_ptr";
+}
+
+// Expression creating a value of type, held by a ptrType() pointer: a single allocation
+// holds both the object and the shared count, or the object is allocated from the arena.
+string Gen::newObject(const string & type) const
+{
+	return options.allocators ? "cppxb::arena_ptr<" + type + ">(cppxb::make<" + type + ">())" : "boost::make_shared<" + type + ">()";
+}
+
+void Gen::getDepends(const vector<Type> & types, set<string> & depends) const
+{
+	BOOST_FOREACH(const Type & t, types) {
+		for (size_t i = 0; i < t.pChildTypes.size(); i++) {
+			depends.insert("\"" + t.pChildTypes[i]->pInterRep->name + ".h\"");
+		}
+		getDepends(t.subTypes, depends);
+	}
+}
+
+void Gen::getAllFields(const Type & t, vector<Field const *> & fields) const
+{
+	if (t.pSuperType) {
+		getAllFields(*t.pSuperType, fields);
+	}
+	BOOST_FOREACH(const Field & f, t.fields) {
+		fields.push_back(&f);
+	}
+}
+
+string Gen::baseClause(const Type & t) const
+{
+	if (!t.superType.empty()) {
+		return " : public " + t.superType;
+	}
+	return options.dirtyTracking ? " : public cppxb::Tracked" : "";
+}
+
+void Gen::printType(const Type & t, ofstream & out, string indent) const
+{
+
+	vector<Type *> childTypes;
+	getAllChildTypes(t, childTypes);
+	BOOST_FOREACH(Type * ct, childTypes) {
+		out << indent << "struct " << cppType(*ct) << ";" << endl;
+	}
+	out << endl;
+	out << indent << "struct " << t.name << baseClause(t) << " {" << endl;
+	out << endl;
+	BOOST_FOREACH(const Type & st, t.subTypes) {
+		printType(st, out, "\t");
+	}
+
+	size_t maxTypeLen = 0;
+	BOOST_FOREACH(const Field & f, t.fields) {
+		maxTypeLen = max(maxTypeLen, cppType(f).length());
+	}
+
+	BOOST_FOREACH(const Field & f, t.fields) {
+		const string fType = cppType(f);
+		out << indent << "\t" << fType << string(maxTypeLen - fType.length(), ' ') << " " << f.name << ";" << endl;
+	}
+	out << endl;
+	printAllocatorSupport(t, out, indent);
+	printVisitor(t, out, indent);
+	printMask(t, out, indent);
+	printDirtyAccessors(t, out, indent);
+	printColumns(t, out, indent);
+
+	if (!t.pChildTypes.empty()) {
+		out << indent << "\tvirtual ~" << t.name << "(){}" << endl;
+		out << endl;
+	}
+	if (hasTypeTag(t)) {
+		unsigned tag, tagEnd;
+		getTypeTags(t, tag, tagEnd);
+		out << indent << "\tstatic const unsigned TYPE_TAG = " << tag << ";" << endl;
+		out << indent << "\tstatic const unsigned TYPE_TAG_END = " << tagEnd << ";" << endl;
+		out << indent << "\tvirtual unsigned typeTag() const { return TYPE_TAG; }" << endl;
+		out << endl;
+	}
+	BOOST_FOREACH(Type * ct, childTypes) {
+		const string ctType = cppType(*ct);
+		out << indent << "\t" << ctType << " * as_" << ct->name << "();" << endl;
+		out << indent << "\tconst " << ctType << " * as_" << ct->name << "() const;" << endl;
+	}
+	out << indent << "};" << endl;
+}
+
+// Fixed arrays have no setter, their items are changed through edit_.
+void Gen::printDirtyAccessors(const Type & t, ofstream & out, string indent) const
+{
+	if (!options.dirtyTracking || t.fields.empty()) {
+		return;
+	}
+	out << indent << "\t// Accessors marking the field as changed, see cppxb::Tracked." << endl;
+	BOOST_FOREACH(const Field & f, t.fields) {
+		if (f.size <= 1) {
+			out << indent << "\tvoid set_" << f.name << "(const decltype(" << f.name << ") & _v) { " << f.name << " = _v; _touch(mask::F_"
+			    << f.name << "); }" << endl;
+		}
+		out << indent << "\tdecltype(" << f.name << ") & edit_" << f.name << "() { _touch(mask::F_" << f.name << "); return " << f.name
+		    << "; }" << endl;
+	}
+	out << endl;
+}
+
+// One vector per field and a presence bitmap per optional field, the rows being proxies
+// referring to the items of the vectors.
+void Gen::printColumns(const Type & t, ofstream & out, string indent) const
+{
+	if (!isColumnar(t)) {
+		return;
+	}
+	const string vec = options.allocators ? "std::pmr::vector< " : "vector< ";
+	const string in = indent + "\t\t";
+	vector<string> names, types, clear, reserve, emplace, rowInit, constRowInit, toRow, toValue, equal, init, copyInit, moveInit;
+	BOOST_FOREACH(const Field & f, t.fields) {
+		Field item = f;
+		item.isOptionnal = false;
+		names.push_back(f.name);
+		types.push_back(vec + cppType(item) + " >");
+		if (f.isOptionnal) {
+			names.push_back("has_" + f.name);
+			types.push_back(vec + "bool >");
+		}
+	}
+	size_t maxTypeLen = 0;
+	BOOST_FOREACH(const string & type, types) {
+		maxTypeLen = max(maxTypeLen, type.length());
+	}
+	out << indent << "\t// Storage of the unbounded sequences of " << t.name << ", see cppXbColumns.h." << endl;
+	out << indent << "\tstruct columns {" << endl;
+	for (size_t i = 0; i < names.size(); i++) {
+		const string & n = names[i];
+		out << in << types[i] << string(maxTypeLen - types[i].length(), ' ') << " " << n << ";" << endl;
+		clear.push_back(n + ".clear();");
+		reserve.push_back(n + ".reserve(_n);");
+		emplace.push_back(boost::starts_with(n, "has_") ? n + ".push_back(false);" : n + ".emplace_back();");
+		rowInit.push_back(n + "[_i]");
+		init.push_back(n + "(_a)");
+		copyInit.push_back(n + "(_o." + n + ", _a)");
+		moveInit.push_back(n + "(std::move(_o." + n + "), _a)");
+	}
+	BOOST_FOREACH(const Field & f, t.fields) {
+		const string & n = f.name;
+		if (f.isOptionnal) {
+			toRow.push_back("has_" + n + " = bool(_v." + n + "); if (_v." + n + ") { " + n + " = *_v." + n + "; }");
+			toValue.push_back("if (has_" + n + ") { _v." + n + " = " + n + "; }");
+			equal.push_back("has_" + n + " == _o.has_" + n);
+		} else {
+			toRow.push_back(n + " = _v." + n + ";");
+			toValue.push_back("_v." + n + " = " + n + ";");
+			equal.push_back(n + " == _o." + n);
+		}
+	}
+	out << endl;
+	out << in << "typedef " << t.name << " value_type;" << endl;
+	for (int constant = 1; constant >= 0; constant--) {
+		const string row = constant ? "const_row" : "row";
+		out << in << "struct " << row << " {" << endl;
+		for (size_t i = 0; i < names.size(); i++) {
+			const string type = types[i].substr(vec.length(), types[i].length() - vec.length() - 2);
+			if (boost::starts_with(names[i], "has_")) {
+				out << in << "\t" << (constant ? "bool " : types[i] + "::reference ") << names[i] << ";" << endl;
+			} else {
+				out << in << "\t" << (constant ? "const " : "") << type << " & " << names[i] << ";" << endl;
+			}
+		}
+		if (!constant) {
+			out << in << "\t" << row << " & operator=(const value_type & _v) { " << boost::join(toRow, " ") << " return *this; }" << endl;
+			out << in << "\toperator const_row() const { return const_row{ " << boost::join(names, ", ") << " }; }" << endl;
+		}
+		out << in << "\tvalue_type value() const { value_type _v; " << boost::join(toValue, " ") << " return _v; }" << endl;
+		out << in << "};" << endl;
+	}
+	out << in << "typedef row reference;" << endl;
+	out << in << "typedef const_row const_reference;" << endl;
+	out << in << "typedef cppxb::RowIterator<columns, row> iterator;" << endl;
+	out << in << "typedef cppxb::RowIterator<const columns, const_row> const_iterator;" << endl;
+	out << endl;
+	if (options.allocators) {
+		out << in << "typedef cppxb::allocator_type allocator_type;" << endl;
+		out << endl;
+		out << in << "explicit columns(const allocator_type & _a = allocator_type())\n" << in << "\t: " << boost::join(init, ", ") << " {}" << endl;
+		out << in << "columns(const columns & _o, const allocator_type & _a = allocator_type())\n" << in << "\t: "
+		    << boost::join(copyInit, ", ") << " {}" << endl;
+		out << in << "columns(columns && _o, const allocator_type & _a)\n" << in << "\t: " << boost::join(moveInit, ", ") << " {}" << endl;
+		out << in << "columns(columns &&) = default;" << endl;
+		out << in << "columns & operator=(const columns &) = default;" << endl;
+		out << in << "columns & operator=(columns &&) = default;" << endl;
+		out << endl;
+	}
+	const string first = t.fields[0].name;
+	out << in << "size_t size() const { return " << first << ".size(); }" << endl;
+	out << in << "bool empty() const { return " << first << ".empty(); }" << endl;
+	out << in << "void clear() { " << boost::join(clear, " ") << " }" << endl;
+	out << in << "void reserve(size_t _n) { " << boost::join(reserve, " ") << " }" << endl;
+	out << in << "row operator[](size_t _i) { return row{ " << boost::join(rowInit, ", ") << " }; }" << endl;
+	out << in << "const_row operator[](size_t _i) const { return const_row{ " << boost::join(rowInit, ", ") << " }; }" << endl;
+	out << in << "row back() { return (*this)[size() - 1]; }" << endl;
+	out << in << "const_row back() const { return (*this)[size() - 1]; }" << endl;
+	out << in << "row emplace_back() { " << boost::join(emplace, " ") << " return back(); }" << endl;
+	out << in << "void push_back(const value_type & _v) { emplace_back() = _v; }" << endl;
+	out << in << "iterator begin() { return iterator(this, 0); }" << endl;
+	out << in << "iterator end() { return iterator(this, size()); }" << endl;
+	out << in << "const_iterator begin() const { return const_iterator(this, 0); }" << endl;
+	out << in << "const_iterator end() const { return const_iterator(this, size()); }" << endl;
+	//the values of absent optional fields are not compared
+	out << in << "bool operator==(const columns & _o) const {" << endl;
+	out << in << "\tif (!(" << boost::join(equal, " && ") << ")) {" << endl;
+	out << in << "\t\treturn false;" << endl;
+	out << in << "\t}" << endl;
+	BOOST_FOREACH(const Field & f, t.fields) {
+		if (f.isOptionnal) {
+			out << in << "\tfor (size_t _i = 0; _i < size(); _i++) {" << endl;
+			out << in << "\t\tif (has_" << f.name << "[_i] && " << f.name << "[_i] != _o." << f.name << "[_i]) {" << endl;
+			out << in << "\t\t\treturn false;" << endl;
+			out << in << "\t\t}" << endl;
+			out << in << "\t}" << endl;
+		}
+	}
+	out << in << "\treturn true;" << endl;
+	out << in << "}" << endl;
+	out << in << "bool operator!=(const columns & _o) const { return !(*this == _o); }" << endl;
+	out << indent << "\t};" << endl;
+	out << endl;
+}
+
+void Gen::printAllocatorSupport(const Type & t, ofstream & out, string indent) const
+{
+	if (!options.allocators) {
+		return;
+	}
+	vector<string> defInit, copyInit, moveInit, copyBody, moveBody;
+	if (t.pSuperType) {
+		const string superType = cppType(*t.pSuperType);
+		defInit.push_back(superType + "(_a)");
+		copyInit.push_back(superType + "(_o, _a)");
+		moveInit.push_back(superType + "(std::move(_o), _a)");
+	} else if (options.dirtyTracking) {
+		copyInit.push_back("cppxb::Tracked(_o)");
+		moveInit.push_back("cppxb::Tracked(_o)");
+	}
+	BOOST_FOREACH(const Field & f, t.fields) {
+		const string n = f.name;
+		if (usesAllocator(f) && f.isOptionnal) {
+			defInit.push_back(n + "()");
+			copyInit.push_back(n + "()");
+			moveInit.push_back(n + "()");
+			copyBody.push_back("if (_o." + n + ") { " + n + ".emplace(*_o." + n + ", _a); }");
+			moveBody.push_back("if (_o." + n + ") { " + n + ".emplace(std::move(*_o." + n + "), _a); }");
+		} else if (f.size < 0 || (usesAllocator(f) && f.size == 1)) {
+			defInit.push_back(n + "(_a)");
+			copyInit.push_back(n + "(_o." + n + ", _a)");
+			moveInit.push_back(n + "(std::move(_o." + n + "), _a)");
+		} else if (usesAllocator(f) && f.size > 1) {
+			Field elt = f;
+			elt.size = 1;
+			const string eltType = cppType(elt);
+			string defElts, copyElts, moveElts;
+			for (int i = 0; i < f.size; i++) {
+				const string sep = (i > 0) ? ", " : "";
+				const string idx = boost::lexical_cast<string>(i);
+				defElts += sep + eltType + "(_a)";
+				copyElts += sep + eltType + "(_o." + n + "[" + idx + "], _a)";
+				moveElts += sep + eltType + "(std::move(_o." + n + "[" + idx + "]), _a)";
+			}
+			defInit.push_back(n + "{" + defElts + "}");
+			copyInit.push_back(n + "{" + copyElts + "}");
+			moveInit.push_back(n + "{" + moveElts + "}");
+		} else {
+			defInit.push_back(n + "()");
+			copyInit.push_back(n + "(_o." + n + ")");
+			moveInit.push_back(n + "(std::move(_o." + n + "))");
+		}
+	}
+	const string in = indent + "\t";
+	out << in << "typedef cppxb::allocator_type allocator_type;" << endl;
+	out << endl;
+	out << in << "explicit " << t.name << "(const allocator_type & _a = allocator_type())";
+	out << (defInit.empty() ? "" : "\n" + in + "\t: " + boost::join(defInit, ", ")) << " {}" << endl;
+	out << in << t.name << "(const " << t.name << " & _o, const allocator_type & _a = allocator_type())";
+	out << (copyInit.empty() ? "" : "\n" + in + "\t: " + boost::join(copyInit, ", ")) << " {";
+	out << (copyBody.empty() ? "" : " " + boost::join(copyBody, " ") + " ") << "}" << endl;
+	out << in << t.name << "(" << t.name << " && _o, const allocator_type & _a)";
+	out << (moveInit.empty() ? "" : "\n" + in + "\t: " + boost::join(moveInit, ", ")) << " {";
+	out << (moveBody.empty() ? "" : " " + boost::join(moveBody, " ") + " ") << "}" << endl;
+	out << in << t.name << "(" << t.name << " &&) = default;" << endl;
+	out << in << t.name << " & operator=(const " << t.name << " &) = default;" << endl;
+	out << in << t.name << " & operator=(" << t.name << " &&) = default;" << endl;
+	out << endl;
+}
+
+void Gen::printMask(const Type & t, ofstream & out, string indent) const
+{
+	if (!options.pullParser) {
+		return;
+	}
+	vector<Field const *> fields;
+	getAllFields(t, fields);
+	out << indent << "\tstruct mask {" << endl;
+	out << indent << "\t\tenum field {";
+	for (size_t i = 0; i < fields.size(); i++) {
+		out << (i ? ", " : " ") << "F_" << fields[i]->name;
+	}
+	out << " };" << endl;
+	out << indent << "\t\tstd::bitset<" << fields.size() << "> fields;" << endl;
+	string init;
+	BOOST_FOREACH(const Field * f, fields) {
+		if (hasMask(*f)) {
+			out << indent << "\t\tconst " << f->type << "::mask * " << f->name << ";" << endl;
+			init += string(init.empty() ? " : " : ", ") + f->name + "(0)";
+		}
+	}
+	out << indent << "\t\tmask()" << init << " {}" << endl;
+	out << indent << "\t\tmask & set(field f) { fields.set(f); return *this; }" << endl;
+	out << indent << "\t\tbool has(field f) const { return fields.test(f); }" << endl;
+	out << indent << "\t};" << endl;
+	out << endl;
+}
+
+void Gen::printVisitor(const Type & t, ofstream & out, string indent) const
+{
+	if (!hasStreamed(t)) {
+		return;
+	}
+	out << indent << "\t// Receives the streamed items when registered with cppxb::Reader::setVisitor." << endl;
+	out << indent << "\tstruct visitor {" << endl;
+	out << indent << "\t\tvirtual ~visitor() {}" << endl;
+	BOOST_FOREACH(const Field & f, t.fields) {
+		if (isStreamed(f)) {
+			out << indent << "\t\tvirtual void on_" << f.name << "(" << cppType(f) << "::value_type & item) = 0;" << endl;
+		}
+	}
+	out << indent << "\t};" << endl;
+	out << endl;
+}
+
+// Slot kind of one item of f in a snapshot record, returns the size of the slot.
+size_t Gen::snapshotSlot(const Field & f, string & slot) const
+{
+	if (f.pType) {
+		slot = "cppxb::SnapshotRecord< view::" + cppType(*f.pType) + " >";
+		return 8;
+	}
+	if (f.pEnum) {
+		slot = "cppxb::SnapshotValue< std::uint32_t, " + f.type + " >";
+		return 4;
+	}
+	if (f.type == "string") {
+		slot = "cppxb::SnapshotString";
+		return 16;
+	}
+	if (f.type == "bool") {
+		slot = "cppxb::SnapshotValue< unsigned char, bool >";
+		return 1;
+	}
+	if (f.type == "char") {
+		slot = "cppxb::SnapshotValue< char, char >";
+		return 1;
+	}
+	if (f.type == "int") {
+		slot = "cppxb::SnapshotValue< std::int32_t, int >";
+		return 4;
+	}
+	if (f.type == "long") {
+		slot = "cppxb::SnapshotValue< std::int64_t, long >";
+		return 8;
+	}
+	if (f.type == "float") {
+		slot = "cppxb::SnapshotValue< float, float >";
+		return 4;
+	}
+	if (f.type == "double") {
+		slot = "cppxb::SnapshotValue< double, double >";
+		return 8;
+	}
+	throw runtime_error("Field " + f.name + " of type " + f.type + " cannot be stored in a snapshot");
+}
+
+// Size taken by f in the records of its type.
+size_t Gen::snapshotSize(const Field & f) const
+{
+	string slot;
+	const size_t size = snapshotSlot(f, slot);
+	if (f.isOptionnal) {
+		return 1 + size;
+	} else if (f.size < 0) {
+		return 16;
+	} else if (f.size > 1) {
+		return f.size * size;
+	}
+	return size;
+}
+
+// view::T reads the fields of T from a snapshot record, the records of a derived type starting
+// with the fields of its base type so that the view classes follow the inheritance of the types.
+void Gen::printSnapshotView(const Type & t, ofstream & out, string indent) const
+{
+	const string base = t.superType.empty() ? "cppxb::SnapshotView" : t.superType;
+	size_t offset = hasTypeTag(t) ? 4 : 0;
+	if (t.pSuperType) {
+		vector<Field const *> fields;
+		getAllFields(*t.pSuperType, fields);
+		BOOST_FOREACH(const Field * f, fields) {
+			offset += snapshotSize(*f);
+		}
+	}
+	vector<Type *> childTypes;
+	getAllChildTypes(t, childTypes);
+	BOOST_FOREACH(Type * ct, childTypes) {
+		out << indent << "class " << cppType(*ct) << ";" << endl;
+	}
+	out << indent << "class " << t.name << " : public " << base << " {" << endl;
+	out << indent << "public:" << endl;
+	BOOST_FOREACH(const Type & st, t.subTypes) {
+		printSnapshotView(st, out, indent + "\t");
+		out << endl;
+	}
+	out << indent << "\tstatic const unsigned long long FINGERPRINT = " << (boost::format("0x%016xull") % fingerprint(t)).str() << ";"
+	    << endl;
+	out << endl;
+	out << indent << "\t" << t.name << "() {}" << endl;
+	out << indent << "\t" << t.name << "(const char * _base, size_t _at) : " << base << "(_base, _at) {}" << endl;
+	out << indent << "\t// Root of a snapshot written by parser::snapshot." << endl;
+	out << indent << "\texplicit " << t.name << "(const cppxb::Snapshot & _s) : " << base << "(_s.data(), _s.root(FINGERPRINT)) {}"
+	    << endl;
+	out << endl;
+	if (hasTypeTag(t)) {
+		unsigned tag, tagEnd;
+		getTypeTags(t, tag, tagEnd);
+		out << indent << "\tstatic const unsigned TYPE_TAG = " << tag << ";" << endl;
+		out << indent << "\tstatic const unsigned TYPE_TAG_END = " << tagEnd << ";" << endl;
+		if (!t.pSuperType) {
+			out << indent << "\tunsigned typeTag() const { return _slot< cppxb::SnapshotValue< std::uint32_t, unsigned > >(0); }" << endl;
+		}
+	}
+	BOOST_FOREACH(Type * ct, childTypes) {
+		out << indent << "\t" << cppType(*ct) << " as_" << ct->name << "() const;" << endl;
+	}
+	BOOST_FOREACH(const Field & f, t.fields) {
+		string slot;
+		snapshotSlot(f, slot);
+		string value = f.type;
+		if (f.pType) {
+			value = "view::" + cppType(*f.pType);
+		} else if (f.type == "string") {
+			value = "std::string_view";
+		}
+		const string at = boost::lexical_cast<string>(offset);
+		if (f.isOptionnal) {
+			out << indent << "\tboost::optional< " << value << " > " << f.name << "() const { return _optional< " << slot
+			    << " >(" << at << "); }" << endl;
+		} else if (f.size < 0) {
+			out << indent << "\tcppxb::SnapshotRange< " << slot << " > " << f.name << "() const { return _range< " << slot << " >("
+			    << at << "); }" << endl;
+		} else if (f.size > 1) {
+			out << indent << "\tcppxb::SnapshotRange< " << slot << " > " << f.name << "() const { return _array< " << slot << " >("
+			    << at << ", " << f.size << "); }" << endl;
+		} else {
+			out << indent << "\t" << value << " " << f.name << "() const { return _slot< " << slot << " >(" << at << "); }"
+			    << endl;
+		}
+		offset += snapshotSize(f);
+	}
+	out << endl;
+	out << indent << "\tstatic const size_t RECORD_SIZE = " << offset << ";" << endl;
+	out << indent << "};" << endl;
+}
+
+void Gen::printSnapshotParse(const Type & t, ofstream & out) const
+{
+	out << "size_t snapshot(const " << t.fullPath << " &, cppxb::SnapshotWriter &);" << endl;
+	out << "void snapshot(const " << t.fullPath << " &, std::string & out);" << endl;
+	if (isPolymorphic(t)) {
+		out << "size_t snapshot(const " << ptrType() << "<" << t.fullPath << "> &, cppxb::SnapshotWriter &);" << endl;
+	}
+	BOOST_FOREACH(const Type & st, t.subTypes) {
+		printSnapshotParse(st, out);
+	}
+}
+
+// Fills the record of _type, the records of its complex fields being appended after it.
+void Gen::printTypeSnapshotSrc(const Type & t, ofstream & out) const
+{
+	vector<Field const *> fields;
+	getAllFields(t, fields);
+	const string view = "view::" + cppType(t);
+	out << "size_t snapshot(const " << t.fullPath << " & _type, cppxb::SnapshotWriter & _w) {" << endl;
+	out << "\tconst size_t _at = _w.allocate(" << view << "::RECORD_SIZE);" << endl;
+	size_t offset = 0;
+	if (hasTypeTag(t)) {
+		out << "\t_w.store<std::uint32_t>(_at, " << cppType(t) << "::TYPE_TAG);" << endl;
+		offset = 4;
+	}
+	BOOST_FOREACH(const Field * f, fields) {
+		string slot;
+		const size_t itemSize = snapshotSlot(*f, slot);
+		const string at = "_at + " + boost::lexical_cast<string>(offset);
+		if (f->isOptionnal) {
+			out << "\tif (_type." << f->name << ") {" << endl;
+			out << "\t\t_w.store<unsigned char>(" << at << ", 1);" << endl;
+			printFieldSnapshot(*f, "*_type." + f->name, at + " + 1", out, "\t\t");
+			out << "\t}" << endl;
+		} else if (f->size < 0) {
+			out << "\t{" << endl;
+			out << "\t\tconst size_t _items = _w.allocate(_type." << f->name << ".size() * " << itemSize << ");" << endl;
+			out << "\t\t_w.store<std::uint64_t>(" << at << ", _items);" << endl;
+			out << "\t\t_w.store<std::uint64_t>(" << at << " + 8, _type." << f->name << ".size());" << endl;
+			out << "\t\tfor (size_t _i = 0; _i < _type." << f->name << ".size(); _i++) {" << endl;
+			printFieldSnapshot(*f, "_type." + f->name + "[_i]", "_items + _i * " + boost::lexical_cast<string>(itemSize), out,
+			                   "\t\t\t");
+			out << "\t\t}" << endl;
+			out << "\t}" << endl;
+		} else if (f->size > 1) {
+			out << "\tfor (size_t _i = 0; _i < " << f->size << "; _i++) {" << endl;
+			printFieldSnapshot(*f, "_type." + f->name + "[_i]", at + " + _i * " + boost::lexical_cast<string>(itemSize), out, "\t\t");
+			out << "\t}" << endl;
+		} else {
+			printFieldSnapshot(*f, "_type." + f->name, at, out, "\t");
+		}
+		offset += snapshotSize(*f);
+	}
+	out << "\treturn _at;" << endl;
+	out << "}" << endl;
+	out << "void snapshot(const " << t.fullPath << " & _type, std::string & _out) {" << endl;
+	out << "\tcppxb::SnapshotWriter _w(_out, " << view << "::FINGERPRINT);" << endl;
+	out << "\t_w.root(snapshot(_type, _w));" << endl;
+	out << "}" << endl;
+	if (!isPolymorphic(t)) {
+		return;
+	}
+	vector<Type *> dynTypes;
+	getAllChildTypes(t, dynTypes);
+	out << "size_t snapshot(const " << ptrType() << "<" << t.fullPath << "> & _t, cppxb::SnapshotWriter & _w) {" << endl;
+	out << "\tif (!_t) {" << endl;
+	out << "\t\treturn 0;" << endl;
+	out << "\t}" << endl;
+	out << "\tswitch (_t->typeTag()) {" << endl;
+	BOOST_FOREACH(Type * dt, dynTypes) {
+		out << "\tcase " << cppType(*dt) << "::TYPE_TAG:" << endl;
+		out << "\t\treturn snapshot(static_cast<const " << cppType(*dt) << " &>(*_t), _w);" << endl;
+	}
+	out << "\t}" << endl;
+	out << "\treturn snapshot(*_t, _w);" << endl;
+	out << "}" << endl;
+}
+
+void Gen::printFieldSnapshot(const Field & f, const string & value, const string & at, ofstream & out, const string & indent) const
+{
+	if (f.pType) {
+		out << indent << "_w.store<std::uint64_t>(" << at << ", snapshot(" << value << ", _w));" << endl;
+	} else {
+		string slot;
+		snapshotSlot(f, slot);
+		out << indent << slot << "::put(_w, " << at << ", " << value << ");" << endl;
+	}
+}
+
+void Gen::printTypeParse(const Type & t, std::ofstream & out, std::string indent) const
+{
+	out << "void parse(const boost::property_tree::ptree &, " << t.fullPath << " &);" << endl;
+	if (isPolymorphic(t)) {
+		out << "void parse(const boost::property_tree::ptree &, " << ptrType() << "<" << t.fullPath << "> &);" << endl;
+	}
+	out << "void put(const " << t.fullPath << " &, boost::property_tree::ptree &, const std::string & path=std::string(\""
+	    << t.name << "\"));" << endl;
+	out << "void write(const " << t.fullPath << " &, cppxb::Writer &, std::string_view name = \"" << t.name << "\");" << endl;
+	out << "void writeContent(const " << t.fullPath << " &, cppxb::Writer &);" << endl;
+	out << "void encode(const " << t.fullPath << " &, cppxb::BinaryWriter &);" << endl;
+	out << "void decode(cppxb::BinaryReader &, " << t.fullPath << " &);" << endl;
+	out << "void encode(const " << t.fullPath << " &, std::string & out);" << endl;
+	out << "void decode(std::string_view data, " << t.fullPath << " &);" << endl;
+	out << "bool equal(const " << t.fullPath << " &, const " << t.fullPath << " &);" << endl;
+	out << "void diff(const " << t.fullPath << " &, const " << t.fullPath << " &, cppxb::Diff &);" << endl;
+	out << "void diff(const " << t.fullPath << " & from, const " << t.fullPath << " & to, cppxb::Patch &);" << endl;
+	out << "void apply(" << t.fullPath << " &, const cppxb::Edit &, size_t depth);" << endl;
+	out << "void apply(" << t.fullPath << " &, const cppxb::Patch &);" << endl;
+	if (isPolymorphic(t)) {
+		out << "void encode(const " << ptrType() << "<" << t.fullPath << "> &, cppxb::BinaryWriter &);" << endl;
+		out << "void decode(cppxb::BinaryReader &, " << ptrType() << "<" << t.fullPath << "> &);" << endl;
+		out << "void diff(const " << ptrType() << "<" << t.fullPath << "> &, const " << ptrType() << "<" << t.fullPath
+		    << "> &, cppxb::Diff &);" << endl;
+		out << "void apply(" << ptrType() << "<" << t.fullPath << "> &, const cppxb::Edit &, size_t depth);" << endl;
+	}
+	printColumnsParse(t, out);
+	BOOST_FOREACH(const Type & st, t.subTypes) {
+		printTypeParse(st, out);
+	}
+}
+
+void Gen::printColumnsParse(const Type & t, ofstream & out) const
+{
+	if (!isColumnar(t)) {
+		return;
+	}
+	const string row = t.fullPath + "::columns::row";
+	const string constRow = t.fullPath + "::columns::const_row";
+	out << "void parse(const boost::property_tree::ptree &, " << row << ");" << endl;
+	out << "void put(" << constRow << ", boost::property_tree::ptree &, const std::string & path);" << endl;
+	out << "void write(" << constRow << ", cppxb::Writer &, std::string_view name);" << endl;
+	out << "void encode(" << constRow << ", cppxb::BinaryWriter &);" << endl;
+	out << "void decode(cppxb::BinaryReader &, " << row << ");" << endl;
+	out << "void encode(const " << t.fullPath << "::columns &, cppxb::BinaryWriter &);" << endl;
+	out << "void decode(cppxb::BinaryReader &, " << t.fullPath << "::columns &);" << endl;
+	if (options.pullParser) {
+		out << "void parse(cppxb::Reader &, " << row << ");" << endl;
+	}
+	if (options.snapshots) {
+		out << "size_t snapshot(" << constRow << ", cppxb::SnapshotWriter &);" << endl;
+	}
+}
+
+// The rows are converted from and to the type, except by the pull parser which fills the
+// columns directly. The columns are encoded as a vector of the type.
+void Gen::printTypeColumnsSrc(const Type & t, ofstream & out) const
+{
+	if (!isColumnar(t)) {
+		return;
+	}
+	const string row = t.fullPath + "::columns::row";
+	const string constRow = t.fullPath + "::columns::const_row";
+	out << "void parse(const ptree & _pt, " << row << " _row) {" << endl;
+	out << "\t" << t.fullPath << " _value;" << endl;
+	out << "\tparse(_pt, _value);" << endl;
+	out << "\t_row = _value;" << endl;
+	out << "}" << endl;
+	out << "void put(" << constRow << " _row, ptree & _pt, const string & _path) {" << endl;
+	out << "\tput(_row.value(), _pt, _path);" << endl;
+	out << "}" << endl;
+	out << "void write(" << constRow << " _row, cppxb::Writer & _w, std::string_view _name) {" << endl;
+	out << "\twrite(_row.value(), _w, _name);" << endl;
+	out << "}" << endl;
+	out << "void encode(" << constRow << " _row, cppxb::BinaryWriter & _w) {" << endl;
+	out << "\tencode(_row.value(), _w);" << endl;
+	out << "}" << endl;
+	out << "void decode(cppxb::BinaryReader & _r, " << row << " _row) {" << endl;
+	out << "\t" << t.fullPath << " _value;" << endl;
+	out << "\tdecode(_r, _value);" << endl;
+	out << "\t_row = _value;" << endl;
+	out << "}" << endl;
+	out << "void encode(const " << t.fullPath << "::columns & _c, cppxb::BinaryWriter & _w) {" << endl;
+	out << "\t_w.varint(_c.size());" << endl;
+	out << "\tfor (size_t _i = 0; _i < _c.size(); _i++) {" << endl;
+	out << "\t\tencode(_c[_i], _w);" << endl;
+	out << "\t}" << endl;
+	out << "}" << endl;
+	out << "void decode(cppxb::BinaryReader & _r, " << t.fullPath << "::columns & _c) {" << endl;
+	out << "\tconst size_t _n = _r.count();" << endl;
+	out << "\t_c.clear();" << endl;
+	out << "\t_c.reserve(std::min(_n, _r.remaining()));" << endl;
+	out << "\tfor (size_t _i = 0; _i < _n; _i++) {" << endl;
+	out << "\t\tdecode(_r, _c.emplace_back());" << endl;
+	out << "\t}" << endl;
+	out << "}" << endl;
+	if (options.snapshots) {
+		out << "size_t snapshot(" << constRow << " _row, cppxb::SnapshotWriter & _w) {" << endl;
+		out << "\treturn snapshot(_row.value(), _w);" << endl;
+		out << "}" << endl;
+	}
+}
+
+// Same reading as printTypePullBody, the values going to the items of the row.
+void Gen::printColumnsPullSrc(const Type & t, ofstream & out) const
+{
+	if (!isColumnar(t)) {
+		return;
+	}
+	vector<Field const *> attrs, elts;
+	BOOST_FOREACH(const Field & f, t.fields) {
+		(f.isAttr ? attrs : elts).push_back(&f);
+	}
+	out << "void parse(cppxb::Reader & _r, " << t.fullPath << "::columns::row _row) {" << endl;
+	printStatsScope(t, "PARSE", "_r.tagOffset()", out);
+	BOOST_FOREACH(const Field & f, t.fields) {
+		if (!f.isOptionnal) {
+			out << "\tbool _has_" << f.name << " = false;" << endl;
+		}
+	}
+	if (!attrs.empty()) {
+		out << "\tBOOST_FOREACH(const cppxb::Attribute & _a, _r.attributes()) {" << endl;
+		BOOST_FOREACH(const Field * f, attrs) {
+			out << "\t\tif (_a.name == \"" << f->nodeName << "\") {" << endl;
+			out << "\t\t\tparseValue(_r, _a.value, _row." << f->name << ");" << endl;
+			out << "\t\t\t_" << (f->isOptionnal ? "row." : "") << "has_" << f->name << " = true;" << endl;
+			out << "\t\t\tcontinue;" << endl;
+			out << "\t\t}" << endl;
+		}
+		out << "\t}" << endl;
+	}
+	if (elts.empty()) {
+		out << "\t_r.skip();" << endl;
+	} else {
+		out << "\twhile (_r.nextChild()) {" << endl;
+		out << "\t\tconst std::string_view _name = _r.name();" << endl;
+		BOOST_FOREACH(const Field * f, elts) {
+			const string has = string(f->isOptionnal ? "_row." : "_") + "has_" + f->name;
+			out << "\t\tif (_name == \"" << f->nodeName << "\" && !" << has << ") {" << endl;
+			out << "\t\t\tparse(_r, _row." << f->name << ");" << endl;
+			out << "\t\t\t" << has << " = true;" << endl;
+			out << "\t\t\tcontinue;" << endl;
+			out << "\t\t}" << endl;
+		}
+		out << "\t\t_r.skip();" << endl;
+		out << "\t}" << endl;
+	}
+	BOOST_FOREACH(const Field & f, t.fields) {
+		if (!f.isOptionnal) {
+			out << "\tif (!_has_" << f.name << ") {" << endl;
+			out << "\t\t_r.missing(\"" << (f.isAttr ? "<xmlattr>." : "") << f.nodeName << "\");" << endl;
+			out << "\t}" << endl;
+		}
+	}
+	if (options.statistics) {
+		out << "\t_stats.consumed(_r.offset());" << endl;
+	}
+	out << "}" << endl;
+}
+
+void Gen::printTypeSrc(const Type & t, ofstream & out, const string & ns) const
+{
+	BOOST_FOREACH(const Type & st, t.subTypes) {
+		printTypeSrc(st, out, ns + t.name + "::");
+	}
+	out << endl;
+	printTypeParseSrc(t, out);
+	out << endl;
+
+	printTypePutSrc(t, out);
+	printTypeWriteSrc(t, out);
+	printTypeBinarySrc(t, out);
+	printTypeDiffSrc(t, out);
+	if (options.snapshots) {
+		printTypeSnapshotSrc(t, out);
+	}
+	printTypeColumnsSrc(t, out);
+
+	if (!t.pChildTypes.empty()) {
+		out << "void parse(const ptree & _pt, " << ptrType() << "<" << t.name << "> & _t) {" << endl;
+		out << "\tstd::string_view _baseType;" << endl;
+		out << "\tconst ptree::const_assoc_iterator _attrs = _pt.find(\"<xmlattr>\");" << endl;
+		out << "\tif (_attrs != _pt.not_found()) {" << endl;
+		out << "\t\tconst ptree::const_assoc_iterator _xsiType = _attrs->second.find(\"xsi:type\");" << endl;
+		out << "\t\tif (_xsiType != _attrs->second.not_found()) {" << endl;
+		out << "\t\t\t_baseType = _xsiType->second.data();" << endl;
+		out << "\t\t}" << endl;
+		out << "\t}" << endl;
+		printXsiTypeSwitch(t, out, "\t\t\t" + ptrType() + "<$T> _tmp = " + newObject("$T") + ";\n"
+		                   "\t\t\tparse(_pt, *_tmp);\n\t\t\t_t = std::move(_tmp);\n");
+		out << "}" << endl;
+	}
+}
+
+// Numbers and booleans go through cppxb::convert, other values through the ptree translators.
+void Gen::printValueParseSrc(ofstream & out) const
+{
+	out << "template<typename T>" << endl;
+	out << "void parse(const ptree & pt, T & t) {" << endl;
+	out << "\tif constexpr (std::is_arithmetic<T>::value) {" << endl;
+	out << "\t\tif (!cppxb::convert(pt.data(), t)) {" << endl;
+	out << "\t\t\tthrow boost::property_tree::ptree_bad_data(\"invalid value '\" + pt.data() + \"'\", pt.data());" << endl;
+	out << "\t\t}" << endl;
+	out << "\t} else if constexpr (std::is_same<T, string>::value) {" << endl;
+	out << "\t\tt = pt.data();" << endl;
+	out << "\t} else {" << endl;
+	out << "\t\tt = pt.get_value<T>();" << endl;
+	out << "\t}" << endl;
+	out << "}" << endl;
+}
+
+void Gen::printValuePutSrc(ofstream & out) const
+{
+	out << "template<typename T>" << endl;
+	out << "void put(const T & t, ptree & pt, const string & path) {" << endl;
+	out << "\tpt.put(path, t);" << endl;
+	out << "}" << endl;
+	out << "inline void put(const char & t, ptree & pt, const string & path) {" << endl;
+	out << "\tpt.put(path, (int)t);" << endl;
+	out << "}" << endl;
+}
+
+// A polymorphic value is put by the function of its dynamic type, after its xsi:type.
+void Gen::printTypePutSrc(const Type & t, ofstream & out) const
+{
+	vector<Field const *> fields;
+	getAllFields(t, fields);
+	out << "void put(const " << t.fullPath << " & _type, ptree & _pt, const string & _path) {" << endl;
+	if (fields.empty() && !isPolymorphic(t)) {
+		printStatsScope(t, "SERIALIZE", "", out);
+		out << "}" << endl;
+		return;
+	}
+	out << "\tconst string _prefix = _path.empty() ? \"\" : _path+\".\";" << endl;
+	if (isPolymorphic(t)) {
+		vector<Type *> dynTypes;
+		getAllChildTypes(t, dynTypes);
+		out << "\tswitch (_type.typeTag()) {" << endl;
+		BOOST_FOREACH(Type * dt, dynTypes) {
+			out << "\tcase " << cppType(*dt) << "::TYPE_TAG:" << endl;
+			out << "\t\tput( \"" << dt->name << "\", _pt, _prefix+\"<xmlattr>.xsi:type\");" << endl;
+			out << "\t\tput(static_cast<const " << cppType(*dt) << " &>(_type), _pt, _path);" << endl;
+			out << "\t\treturn;" << endl;
+		}
+		out << "\t}" << endl;
+	}
+	printStatsScope(t, "SERIALIZE", "", out);
+	BOOST_FOREACH(const Field * f, fields) {
+		if (f->isOptionnal) {
+			const string path = (f->isAttr) ? "<xmlattr>." : "";
+			out << "\tput(  _type." << f->name << ", _pt, _prefix+\"" << path << f->nodeName << "\" );" << endl;
+		} else if (f->isAttr) {
+			out << "\tput(  _type." << f->name << ", _pt, _prefix+\"<xmlattr>."  << f->nodeName << "\" );" << endl;
+		} else if (f->size < 0) {
+			out << "\tBOOST_FOREACH(const " << cppType(*f, true) << "::const_reference & _tmp, _type." << f->name << ") {" << endl;
+			out << "\t\tptree & _rPt = _pt.add(_prefix+\"" << f->nodeName << "\", \"\");" << endl;
+			out << "\t\tput(_tmp, _rPt, \"\");" << endl;
+			out << "\t}" << endl;
+		} else if (f->size > 1) {
+			out << "\tfor (size_t _i = 0; _i < " << f->size << "; _i++) {" << endl;
+			out << "\t\tptree & _rPt = _pt.add(_prefix+\"" << f->nodeName << "\", \"\");" << endl;
+			out << "\t\tput(_type." << f->name << "[_i], _rPt, \"\");" << endl;
+			out << "\t}" << endl;
+		} else {
+			out << "\tput(  _type." << f->name << ", _pt, _prefix+\""  << f->nodeName << "\" );" << endl;
+		}
+	}
+	out << "}" << endl;
+}
+
+// writeContent writes the attributes then the elements of all the fields, write wraps them
+// in the element, giving the xsi:type of polymorphic values.
+void Gen::printTypeWriteSrc(const Type & t, ofstream & out) const
+{
+	vector<Field const *> fields, attrs, elts;
+	getAllFields(t, fields);
+	BOOST_FOREACH(const Field * f, fields) {
+		(f->isAttr ? attrs : elts).push_back(f);
+	}
+	out << "void writeContent(const " << t.fullPath << " & _type, cppxb::Writer & _w) {" << endl;
+	printStatsScope(t, "SERIALIZE", "", out);
+	attrs.insert(attrs.end(), elts.begin(), elts.end());
+	BOOST_FOREACH(const Field * f, attrs) {
+		if (f->isOptionnal) {
+			out << "\tif (_type." << f->name << ") {" << endl;
+			printFieldWrite(*f, "*_type." + f->name, out, "\t\t");
+			out << "\t}" << endl;
+		} else if (f->size < 0) {
+			out << "\tBOOST_FOREACH(const " << cppType(*f, true) << "::const_reference & _item, _type." << f->name << ") {" << endl;
+			printFieldWrite(*f, "_item", out, "\t\t");
+			out << "\t}" << endl;
+		} else if (f->size > 1) {
+			out << "\tfor (size_t _i = 0; _i < " << f->size << "; _i++) {" << endl;
+			printFieldWrite(*f, "_type." + f->name + "[_i]", out, "\t\t");
+			out << "\t}" << endl;
+		} else {
+			printFieldWrite(*f, "_type." + f->name, out, "\t");
+		}
+	}
+	out << "}" << endl;
+	out << "void write(const " << t.fullPath << " & _type, cppxb::Writer & _w, std::string_view _name) {" << endl;
+	if (options.dirtyTracking) {
+		out << "\tif (_type._clean() && _w.copy(_type._source(), _name)) {" << endl;
+		out << "\t\treturn;" << endl;
+		out << "\t}" << endl;
+	}
+	out << "\t_w.start(_name);" << endl;
+	if (isPolymorphic(t)) {
+		vector<Type *> dynTypes;
+		getAllChildTypes(t, dynTypes);
+		out << "\tswitch (_type.typeTag()) {" << endl;
+		BOOST_FOREACH(Type * dt, dynTypes) {
+			out << "\tcase " << cppType(*dt) << "::TYPE_TAG:" << endl;
+			out << "\t\t_w.attribute(\"xsi:type\", \"" << dt->name << "\");" << endl;
+			out << "\t\twriteContent(static_cast<const " << cppType(*dt) << " &>(_type), _w);" << endl;
+			out << "\t\t_w.end(_name);" << endl;
+			out << "\t\treturn;" << endl;
+		}
+		out << "\t}" << endl;
+	}
+	out << "\twriteContent(_type, _w);" << endl;
+	out << "\t_w.end(_name);" << endl;
+	out << "}" << endl;
+}
+
+void Gen::printFieldWrite(const Field & f, const string & value, ofstream & out, const string & indent) const
+{
+	if (f.isAttr) {
+		out << indent << "_w.attribute(\"" << f.nodeName << "\", " << value << ");" << endl;
+	} else if (f.pType && isPolymorphic(*f.pType)) {
+		out << indent << "if (" << value << ") {" << endl;
+		out << indent << "\twrite(*" << value << ", _w, \"" << f.nodeName << "\");" << endl;
+		out << indent << "}" << endl;
+	} else if (f.pType) {
+		out << indent << "write(" << value << ", _w, \"" << f.nodeName << "\");" << endl;
+	} else {
+		out << indent << "_w.element(\"" << f.nodeName << "\", " << value << ");" << endl;
+	}
+}
+
+// The optional fields are announced by a presence bit each, written before the fields;
+// polymorphic pointers are encoded as the tag of their dynamic type plus one (0 for null)
+// followed by its fields.
+void Gen::printTypeBinarySrc(const Type & t, ofstream & out) const
+{
+	vector<Field const *> fields, optionals;
+	getAllFields(t, fields);
+	BOOST_FOREACH(const Field * f, fields) {
+		if (f->isOptionnal) {
+			optionals.push_back(f);
+		}
+	}
+	const size_t presentSize = (optionals.size() + 7) / 8;
+	out << "void encode(const " << t.fullPath << " & _type, cppxb::BinaryWriter & _w) {" << endl;
+	if (!optionals.empty()) {
+		out << "\tunsigned char _present[" << presentSize << "] = {};" << endl;
+		for (size_t i = 0; i < optionals.size(); i++) {
+			out << "\tif (_type." << optionals[i]->name << ") {" << endl;
+			out << "\t\t_present[" << i / 8 << "] |= " << (1 << (i % 8)) << ";" << endl;
+			out << "\t}" << endl;
+		}
+		out << "\t_w.raw(_present, " << presentSize << ");" << endl;
+	}
+	BOOST_FOREACH(const Field * f, fields) {
+		if (f->isOptionnal) {
+			out << "\tif (_type." << f->name << ") {" << endl;
+			printFieldEncode(*f, "*_type." + f->name, out, "\t\t");
+			out << "\t}" << endl;
+		} else if (f->size < 0) {
+			out << "\t_w.varint(_type." << f->name << ".size());" << endl;
+			out << "\tBOOST_FOREACH(const " << cppType(*f, true) << "::const_reference & _item, _type." << f->name << ") {" << endl;
+			printFieldEncode(*f, "_item", out, "\t\t");
+			out << "\t}" << endl;
+		} else if (f->size > 1) {
+			out << "\tfor (size_t _i = 0; _i < " << f->size << "; _i++) {" << endl;
+			printFieldEncode(*f, "_type." + f->name + "[_i]", out, "\t\t");
+			out << "\t}" << endl;
+		} else {
+			printFieldEncode(*f, "_type." + f->name, out, "\t");
+		}
+	}
+	out << "}" << endl;
+	out << "void decode(cppxb::BinaryReader & _r, " << t.fullPath << " & _type) {" << endl;
+	if (options.dirtyTracking) {
+		out << "\t_type._touchAll();" << endl;
+	}
+	if (!optionals.empty()) {
+		out << "\tconst unsigned char * _present = (const unsigned char *)_r.raw(" << presentSize << ");" << endl;
+	}
+	size_t optional = 0;
+	BOOST_FOREACH(const Field * f, fields) {
+		if (f->isOptionnal) {
+			out << "\tif (_present[" << optional / 8 << "] & " << (1 << (optional % 8)) << ") {" << endl;
+			if (usesAllocator(*f)) {
+				out << "\t\tcppxb::emplace(_type." << f->name << ");" << endl;
+			} else {
+				out << "\t\t_type." << f->name << ".emplace();" << endl;
+			}
+			printFieldDecode(*f, "*_type." + f->name, out, "\t\t");
+			out << "\t} else {" << endl;
+			out << "\t\t_type." << f->name << " = boost::none;" << endl;
+			out << "\t}" << endl;
+			optional++;
+		} else if (f->size < 0) {
+			out << "\t{" << endl;
+			out << "\t\tconst size_t _n = _r.count();" << endl;
+			printCapacityCheck(*f, "_n", "_r.invalid($M);", out, "\t\t");
+			out << "\t\t_type." << f->name << ".clear();" << endl;
+			out << "\t\t_type." << f->name << ".reserve(std::min(_n, _r.remaining()));" << endl;
+			out << "\t\tfor (size_t _i = 0; _i < _n; _i++) {" << endl;
+			out << "\t\t\t_type." << f->name << ".emplace_back();" << endl;
+			printFieldDecode(*f, "_type." + f->name + ".back()", out, "\t\t\t");
+			out << "\t\t}" << endl;
+			out << "\t}" << endl;
+		} else if (f->size > 1) {
+			out << "\tfor (size_t _i = 0; _i < " << f->size << "; _i++) {" << endl;
+			printFieldDecode(*f, "_type." + f->name + "[_i]", out, "\t\t");
+			out << "\t}" << endl;
+		} else {
+			printFieldDecode(*f, "_type." + f->name, out, "\t");
+		}
+	}
+	out << "}" << endl;
+	const string fp = (boost::format("0x%016xull") % fingerprint(t)).str();
+	out << "void encode(const " << t.fullPath << " & _type, std::string & _out) {" << endl;
+	out << "\tcppxb::BinaryWriter _w(_out);" << endl;
+	out << "\t_w.header(" << fp << ");" << endl;
+	out << "\tencode(_type, _w);" << endl;
+	out << "}" << endl;
+	out << "void decode(std::string_view _data, " << t.fullPath << " & _type) {" << endl;
+	out << "\tcppxb::BinaryReader _r(_data);" << endl;
+	out << "\t_r.header(" << fp << ");" << endl;
+	out << "\tdecode(_r, _type);" << endl;
+	out << "\tif (!_r.atEnd()) {" << endl;
+	out << "\t\t_r.invalid(\"trailing data\");" << endl;
+	out << "\t}" << endl;
+	out << "}" << endl;
+	if (!isPolymorphic(t)) {
+		return;
+	}
+	vector<Type *> dynTypes;
+	getAllChildTypes(t, dynTypes);
+	out << "void encode(const " << ptrType() << "<" << t.fullPath << "> & _t, cppxb::BinaryWriter & _w) {" << endl;
+	out << "\tif (!_t) {" << endl;
+	out << "\t\t_w.varint(0);" << endl;
+	out << "\t\treturn;" << endl;
+	out << "\t}" << endl;
+	out << "\t_w.varint(_t->typeTag() + 1);" << endl;
+	out << "\tswitch (_t->typeTag()) {" << endl;
+	BOOST_FOREACH(Type * dt, dynTypes) {
+		out << "\tcase " << cppType(*dt) << "::TYPE_TAG:" << endl;
+		out << "\t\tencode(static_cast<const " << cppType(*dt) << " &>(*_t), _w);" << endl;
+		out << "\t\treturn;" << endl;
+	}
+	out << "\t}" << endl;
+	out << "\tencode(*_t, _w);" << endl;
+	out << "}" << endl;
+	dynTypes.insert(dynTypes.begin(), const_cast<Type *>(&t));
+	out << "void decode(cppxb::BinaryReader & _r, " << ptrType() << "<" << t.fullPath << "> & _t) {" << endl;
+	out << "\tswitch (_r.varint()) {" << endl;
+	out << "\tcase 0:" << endl;
+	out << "\t\t_t.reset();" << endl;
+	out << "\t\treturn;" << endl;
+	BOOST_FOREACH(Type * dt, dynTypes) {
+		const string dtType = cppType(*dt);
+		out << "\tcase " << dtType << "::TYPE_TAG + 1: {" << endl;
+		out << "\t\t" << ptrType() << "<" << dtType << "> _tmp = " << newObject(dtType) << ";" << endl;
+		out << "\t\tdecode(_r, *_tmp);" << endl;
+		out << "\t\t_t = std::move(_tmp);" << endl;
+		out << "\t\treturn;" << endl;
+		out << "\t}" << endl;
+	}
+	out << "\t}" << endl;
+	out << "\t_r.invalid(\"unexpected type tag\");" << endl;
+	out << "}" << endl;
+}
+
+void Gen::printFieldEncode(const Field & f, const string & value, ofstream & out, const string & indent) const
+{
+	if (f.pType) {
+		out << indent << "encode(" << value << ", _w);" << endl;
+	} else {
+		out << indent << "encodeValue(_w, " << value << ");" << endl;
+	}
+}
+
+void Gen::printFieldDecode(const Field & f, const string & value, ofstream & out, const string & indent) const
+{
+	if (f.pType) {
+		out << indent << "decode(_r, " << value << ");" << endl;
+	} else {
+		out << indent << "decodeValue(_r, " << value << ");" << endl;
+	}
+}
+
+void Gen::printEqualityDecl(const vector<Type> & types, ofstream & out) const
+{
+	BOOST_FOREACH(const Type & t, types) {
+		out << "bool operator==(const " << t.fullPath << " &, const " << t.fullPath << " &);" << endl;
+		out << "bool operator!=(const " << t.fullPath << " &, const " << t.fullPath << " &);" << endl;
+		printEqualityDecl(t.subTypes, out);
+	}
+}
+
+// Values of polymorphic types are equal when they have the same dynamic type
+// and equal fields.
+void Gen::printEqualitySrc(const vector<Type> & types, ofstream & out) const
+{
+	BOOST_FOREACH(const Type & t, types) {
+		printEqualitySrc(t.subTypes, out);
+		out << "bool operator==(const " << t.fullPath << " & a, const " << t.fullPath << " & b) {" << endl;
+		if (isPolymorphic(t)) {
+			vector<Type *> dynTypes;
+			getAllChildTypes(t, dynTypes);
+			out << "\tif (a.typeTag() != b.typeTag()) {" << endl;
+			out << "\t\treturn false;" << endl;
+			out << "\t}" << endl;
+			out << "\tswitch (a.typeTag()) {" << endl;
+			BOOST_FOREACH(Type * dt, dynTypes) {
+				const string dtType = cppType(*dt);
+				out << "\tcase " << dtType << "::TYPE_TAG:" << endl;
+				out << "\t\treturn parser::equal(static_cast<const " << dtType << " &>(a), static_cast<const " << dtType << " &>(b));" << endl;
+			}
+			out << "\t}" << endl;
+		}
+		out << "\treturn parser::equal(a, b);" << endl;
+		out << "}" << endl;
+		out << "bool operator!=(const " << t.fullPath << " & a, const " << t.fullPath << " & b) {" << endl;
+		out << "\treturn !(a == b);" << endl;
+		out << "}" << endl;
+	}
+}
+
+// Field kind specific parts of equal, diff and apply; encode and decode also
+// reach the values of cppxb::encodeValue and decodeValue.
+void Gen::printDiffTemplates(ofstream & out) const
+{
+	const string ptr = ptrType();
+	const string arrayArgs = arrayParam("const ", "a") + ", " + arrayParam("const ", "b");
+	const string optionalArgs = optionalParam("const ", "a") + ", " + optionalParam("const ", "b");
+	const string vectorArgs = vectorParam("const ", "a") + ", " + vectorParam("const ", "b");
+	out << "template<typename T> void encode(const T & v, cppxb::BinaryWriter & w) { encodeValue(w, v); }" << endl;
+	out << "template<typename T> void decode(cppxb::BinaryReader & r, T & v) { decodeValue(r, v); }" << endl;
+	out << "template<typename T> bool equal(const T & a, const T & b) { return a == b; }" << endl;
+	out << "template<typename T> bool equal(" << optionalArgs << ") { return a ? b && equal(*a, *b) : !b; }" << endl;
+	out << "template<typename T> bool equal(const " << ptr << "<T> & a, const " << ptr << "<T> & b) { return a ? b && *a == *b : !b; }"
+	    << endl;
+	out << vectorTemplate() << " bool equal(" << vectorArgs << ") {" << endl;
+	out << "\tif (a.size() != b.size()) {" << endl;
+	out << "\t\treturn false;" << endl;
+	out << "\t}" << endl;
+	out << "\tfor (size_t i = 0; i < a.size(); i++) {" << endl;
+	out << "\t\tif (!equal(a[i], b[i])) {" << endl;
+	out << "\t\t\treturn false;" << endl;
+	out << "\t\t}" << endl;
+	out << "\t}" << endl;
+	out << "\treturn true;" << endl;
+	out << "}" << endl;
+	out << "template<typename T, size_t N> bool equal(" << arrayArgs << ") {" << endl;
+	out << "\tfor (size_t i = 0; i < N; i++) {" << endl;
+	out << "\t\tif (!equal(a[i], b[i])) {" << endl;
+	out << "\t\t\treturn false;" << endl;
+	out << "\t\t}" << endl;
+	out << "\t}" << endl;
+	out << "\treturn true;" << endl;
+	out << "}" << endl;
+	out << "template<typename T> void diff(const T & a, const T & b, cppxb::Diff & d) {" << endl;
+	out << "\tif (!equal(a, b)) {" << endl;
+	out << "\t\tcppxb::BinaryWriter w = d.edit(cppxb::Edit::SET);" << endl;
+	out << "\t\tencode(b, w);" << endl;
+	out << "\t}" << endl;
+	out << "}" << endl;
+	out << "template<typename T> void diff(" << optionalArgs << ", cppxb::Diff & d) {" << endl;
+	out << "\tif (a && b) {" << endl;
+	out << "\t\tconst size_t n = d.size();" << endl;
+	out << "\t\tdiff(*a, *b, d);" << endl;
+	out << "\t\td.present(n);" << endl;
+	out << "\t} else if (a || b) {" << endl;
+	out << "\t\tcppxb::BinaryWriter w = d.edit(cppxb::Edit::SET);" << endl;
+	out << "\t\tw.byte(b ? 1 : 0);" << endl;
+	out << "\t\tif (b) {" << endl;
+	out << "\t\t\tencode(*b, w);" << endl;
+	out << "\t\t}" << endl;
+	out << "\t}" << endl;
+	out << "}" << endl;
+	//items kept at both ends are skipped, the others are compared in pairs, the extra ones removed or inserted
+	out << vectorTemplate() << " void diff(" << vectorArgs << ", cppxb::Diff & d) {" << endl;
+	out << "\tsize_t i = 0, endA = a.size(), endB = b.size();" << endl;
+	out << "\twhile (i < endA && i < endB && equal(a[i], b[i])) {" << endl;
+	out << "\t\ti++;" << endl;
+	out << "\t}" << endl;
+	out << "\twhile (endA > i && endB > i && equal(a[endA - 1], b[endB - 1])) {" << endl;
+	out << "\t\tendA--;" << endl;
+	out << "\t\tendB--;" << endl;
+	out << "\t}" << endl;
+	out << "\tfor (; i < endA && i < endB; i++) {" << endl;
+	out << "\t\td.push(i);" << endl;
+	out << "\t\tdiff(a[i], b[i], d);" << endl;
+	out << "\t\td.pop();" << endl;
+	out << "\t}" << endl;
+	out << "\tfor (size_t k = i; k < endA; k++) {" << endl;
+	out << "\t\td.push(i);" << endl;
+	out << "\t\td.edit(cppxb::Edit::REMOVE);" << endl;
+	out << "\t\td.pop();" << endl;
+	out << "\t}" << endl;
+	out << "\tfor (; i < endB; i++) {" << endl;
+	out << "\t\td.push(i);" << endl;
+	out << "\t\tcppxb::BinaryWriter w = d.edit(cppxb::Edit::INSERT);" << endl;
+	out << "\t\tencode(b[i], w);" << endl;
+	out << "\t\td.pop();" << endl;
+	out << "\t}" << endl;
+	out << "}" << endl;
+	out << "template<typename T, size_t N> void diff(" << arrayArgs << ", cppxb::Diff & d) {" << endl;
+	out << "\tfor (size_t i = 0; i < N; i++) {" << endl;
+	out << "\t\td.push(i);" << endl;
+	out << "\t\tdiff(a[i], b[i], d);" << endl;
+	out << "\t\td.pop();" << endl;
+	out << "\t}" << endl;
+	out << "}" << endl;
+	out << "template<typename T> void apply(T & v, const cppxb::Edit & e, size_t depth) {" << endl;
+	out << "\tcppxb::BinaryReader r = cppxb::setValue(e, depth);" << endl;
+	out << "\tdecode(r, v);" << endl;
+	out << "}" << endl;
+	out << "template<typename T> void apply(" << optionalParam("", "v") << ", const cppxb::Edit & e, size_t depth) {" << endl;
+	out << "\tif (depth < e.path.size() && v) {" << endl;
+	out << "\t\tapply(*v, e, depth);" << endl;
+	out << "\t\treturn;" << endl;
+	out << "\t}" << endl;
+	out << "\tcppxb::BinaryReader r = cppxb::setValue(e, depth);" << endl;
+	out << "\tif (r.byte()) {" << endl;
+	if (options.allocators) {
+		out << "\t\tcppxb::emplace(v);" << endl;
+	} else {
+		out << "\t\tv.emplace();" << endl;
+	}
+	out << "\t\tdecode(r, *v);" << endl;
+	out << "\t} else {" << endl;
+	out << "\t\tv = boost::none;" << endl;
+	out << "\t}" << endl;
+	out << "}" << endl;
+	out << vectorTemplate() << " void apply(" << vectorParam("", "v") << ", const cppxb::Edit & e, size_t depth) {" << endl;
+	out << "\tconst size_t i = cppxb::itemIndex(e, depth, v.size());" << endl;
+	out << "\tif (depth + 1 == e.path.size() && e.kind == cppxb::Edit::INSERT) {" << endl;
+	out << "\t\tv.emplace(v.begin() + i);" << endl;
+	out << "\t\tcppxb::BinaryReader r(e.value);" << endl;
+	out << "\t\tdecode(r, v[i]);" << endl;
+	out << "\t} else if (depth + 1 == e.path.size() && e.kind == cppxb::Edit::REMOVE) {" << endl;
+	out << "\t\tv.erase(v.begin() + i);" << endl;
+	out << "\t} else {" << endl;
+	out << "\t\tapply(v[i], e, depth + 1);" << endl;
+	out << "\t}" << endl;
+	out << "}" << endl;
+	out << "template<typename T, size_t N> void apply(" << arrayParam("", "v") << ", const cppxb::Edit & e, size_t depth) {" << endl;
+	out << "\tapply(v[cppxb::itemIndex(e, depth, N)], e, depth + 1);" << endl;
+	out << "}" << endl;
+}
+
+// Parameter of the generic templates of fixed arrays, of item type T and size N.
+string Gen::arrayParam(const string & qualifiers, const string & name) const
+{
+	return qualifiers + "boost::array<T, N> & " + name;
+}
+
+// Parameter of the generic templates of optional values of type T.
+string Gen::optionalParam(const string & qualifiers, const string & name) const
+{
+	return qualifiers + "boost::optional<T> & " + name;
+}
+
+// Template head of the generic templates of unbounded sequences, declaring
+// the item type T and a second parameter, A for the allocator of std::vector.
+string Gen::vectorTemplate() const
+{
+	return "template<typename T, typename A>";
+}
+
+string Gen::vectorParam(const string & qualifiers, const string & name) const
+{
+	return qualifiers + "std::vector<T, A> & " + name;
+}
+
+// Capacity of the items of a sequence, or of the chars of a string, with -pod.
+int Gen::podCapacity(const Field &, bool) const
+{
+	return 0;
+}
+
+// With -pod, fails when the unbounded sequence f would hold count items,
+// more than its capacity: $M in fail is replaced by the error message.
+void Gen::printCapacityCheck(const Field & f, const string & count, const string & fail, ofstream & out, const string & indent) const
+{
+	if (!options.pod || f.size >= 0) {
+		return;
+	}
+	const string capacity = boost::lexical_cast<string>(podCapacity(f, true));
+	out << indent << "if (" << count << " > " << capacity << ") {" << endl;
+	out << indent << "\t" << boost::replace_all_copy(fail, "$M", "\"more than " + capacity + " " + f.nodeName + " elements\"") << endl;
+	out << indent << "}" << endl;
+}
+
+// Fields are numbered in the order of getAllFields, so a value reached
+// through its base type is diffed and patched with the numbers of its
+// dynamic type.
+void Gen::printTypeDiffSrc(const Type & t, ofstream & out) const
+{
+	vector<Field const *> fields;
+	getAllFields(t, fields);
+	if (fields.empty()) {
+		out << "bool equal(const " << t.fullPath << " &, const " << t.fullPath << " &) {" << endl;
+		out << "\treturn true;" << endl;
+		out << "}" << endl;
+		out << "void diff(const " << t.fullPath << " &, const " << t.fullPath << " &, cppxb::Diff &) {" << endl;
+		out << "}" << endl;
+	} else {
+		out << "bool equal(const " << t.fullPath << " & _a, const " << t.fullPath << " & _b) {" << endl;
+		for (size_t i = 0; i < fields.size(); i++) {
+			out << (i ? "\t       && " : "\treturn ") << "equal(_a." << fields[i]->name << ", _b." << fields[i]->name << ")"
+			    << (i + 1 < fields.size() ? "" : ";") << endl;
+		}
+		out << "}" << endl;
+		out << "void diff(const " << t.fullPath << " & _a, const " << t.fullPath << " & _b, cppxb::Diff & _d) {" << endl;
+		for (size_t i = 0; i < fields.size(); i++) {
+			out << "\t_d.push(" << i << ");" << endl;
+			out << "\tdiff(_a." << fields[i]->name << ", _b." << fields[i]->name << ", _d);" << endl;
+			out << "\t_d.pop();" << endl;
+		}
+		out << "}" << endl;
+	}
+	out << "void apply(" << t.fullPath << " & _type, const cppxb::Edit & _e, size_t _depth) {" << endl;
+	out << "\tif (_depth == _e.path.size()) {" << endl;
+	out << "\t\tcppxb::BinaryReader _r = cppxb::setValue(_e, _depth);" << endl;
+	out << "\t\tdecode(_r, _type);" << endl;
+	out << "\t\treturn;" << endl;
+	out << "\t}" << endl;
+	if (!fields.empty()) {
+		out << "\tswitch (_e.path[_depth]) {" << endl;
+		for (size_t i = 0; i < fields.size(); i++) {
+			out << "\tcase " << i << ":" << endl;
+			out << "\t\tapply(_type." << (options.dirtyTracking ? "edit_" + fields[i]->name + "()" : fields[i]->name) << ", _e, _depth + 1);"
+			    << endl;
+			out << "\t\treturn;" << endl;
+		}
+		out << "\t}" << endl;
+	}
+	out << "\tcppxb::Patch::invalid(\"invalid field number\");" << endl;
+	out << "}" << endl;
+	const string fp = (boost::format("0x%016xull") % fingerprint(t)).str();
+	out << "void diff(const " << t.fullPath << " & _from, const " << t.fullPath << " & _to, cppxb::Patch & _patch) {" << endl;
+	out << "\t_patch.fingerprint = " << fp << ";" << endl;
+	out << "\t_patch.edits.clear();" << endl;
+	out << "\tcppxb::Diff _d(_patch);" << endl;
+	out << "\tdiff(_from, _to, _d);" << endl;
+	out << "}" << endl;
+	out << "void apply(" << t.fullPath << " & _type, const cppxb::Patch & _patch) {" << endl;
+	out << "\t_patch.check(" << fp << ");" << endl;
+	out << "\tBOOST_FOREACH(const cppxb::Edit & _e, _patch.edits) {" << endl;
+	out << "\t\tapply(_type, _e, 0);" << endl;
+	out << "\t}" << endl;
+	out << "}" << endl;
+	if (!isPolymorphic(t)) {
+		return;
+	}
+	vector<Type *> dynTypes;
+	getAllChildTypes(t, dynTypes);
+	const string pType = ptrType() + "<" + t.fullPath + ">";
+	out << "void diff(const " << pType << " & _a, const " << pType << " & _b, cppxb::Diff & _d) {" << endl;
+	out << "\tif (_a && _b && _a->typeTag() == _b->typeTag()) {" << endl;
+	out << "\t\tswitch (_a->typeTag()) {" << endl;
+	BOOST_FOREACH(Type * dt, dynTypes) {
+		const string dtType = cppType(*dt);
+		out << "\t\tcase " << dtType << "::TYPE_TAG:" << endl;
+		out << "\t\t\tdiff(static_cast<const " << dtType << " &>(*_a), static_cast<const " << dtType << " &>(*_b), _d);" << endl;
+		out << "\t\t\treturn;" << endl;
+	}
+	out << "\t\t}" << endl;
+	out << "\t\tdiff(*_a, *_b, _d);" << endl;
+	out << "\t} else if (_a || _b) {" << endl;
+	out << "\t\tcppxb::BinaryWriter _w = _d.edit(cppxb::Edit::SET);" << endl;
+	out << "\t\tencode(_b, _w);" << endl;
+	out << "\t}" << endl;
+	out << "}" << endl;
+	out << "void apply(" << pType << " & _t, const cppxb::Edit & _e, size_t _depth) {" << endl;
+	out << "\tif (_depth == _e.path.size() || !_t) {" << endl;
+	out << "\t\tcppxb::BinaryReader _r = cppxb::setValue(_e, _depth);" << endl;
+	out << "\t\tdecode(_r, _t);" << endl;
+	out << "\t\treturn;" << endl;
+	out << "\t}" << endl;
+	out << "\tswitch (_t->typeTag()) {" << endl;
+	BOOST_FOREACH(Type * dt, dynTypes) {
+		const string dtType = cppType(*dt);
+		out << "\tcase " << dtType << "::TYPE_TAG:" << endl;
+		out << "\t\tapply(static_cast<" << dtType << " &>(*_t), _e, _depth);" << endl;
+		out << "\t\treturn;" << endl;
+	}
+	out << "\t}" << endl;
+	out << "\tapply(*_t, _e, _depth);" << endl;
+	out << "}" << endl;
+}
+
+void Gen::printNameHashSrc(ofstream & out) const
+{
+	out << "inline unsigned nameHash(const char * s, size_t n) {" << endl;
+	out << "\tunsigned h = 2166136261u;" << endl;
+	out << "\tfor (size_t i = 0; i < n; i++) {" << endl;
+	out << "\t\th = (h ^ (unsigned char)s[i]) * 16777619u;" << endl;
+	out << "\t}" << endl;
+	out << "\treturn h & 0xffffffffu;" << endl;
+	out << "}" << endl;
+}
+
+// With -stats, opens the cppxb::stats::Scope counting the function being printed
+// for t, a pull parser giving the offset its element starts at.
+void Gen::printStatsScope(const Type & t, const string & operation, const string & offset, ofstream & out) const
+{
+	if (!options.statistics) {
+		return;
+	}
+	out << "\tstatic const unsigned _statsType = cppxb::stats::typeId(\"" << t.fullPath << "\");" << endl;
+	out << "\tcppxb::stats::Scope _stats(_statsType, cppxb::stats::" << operation << (offset.empty() ? "" : ", " + offset) << ");" << endl;
+}
+
+// Single pass over the children of _pt (and over its <xmlattr> node), the names being
+// dispatched through a switch on their nameHash. Required fields are checked afterwards.
+void Gen::printTypeParseSrc(const Type & t, ofstream & out) const
+{
+	vector<Field const *> fields, attrs, elts;
+	getAllFields(t, fields);
+	BOOST_FOREACH(const Field * f, fields) {
+		(f->isAttr ? attrs : elts).push_back(f);
+	}
+	out << "void parse(const ptree & _pt, " << t.fullPath << " & _type) {" << endl;
+	printStatsScope(t, "PARSE", "", out);
+	if (options.dirtyTracking) {
+		out << "\t_type._touchAll();" << endl;
+	}
+	if (fields.empty()) {
+		out << "}" << endl;
+		return;
+	}
+	BOOST_FOREACH(const Field * f, fields) {
+		if (f->isAttr ? !f->isOptionnal : (f->size == 1 || f->isOptionnal)) {
+			out << "\tbool _has_" << f->name << " = false;" << endl;
+		} else if (f->size > 1) {
+			out << "\tsize_t " << f->name << "_index = 0;" << endl;
+		}
+	}
+	vector<Field const *> vectors;
+	BOOST_FOREACH(const Field * f, elts) {
+		if (f->size < 0 && !f->isOptionnal) {
+			vectors.push_back(f);
+		}
+	}
+	//the children are counted first so that each vector is allocated once
+	if (!vectors.empty()) {
+		BOOST_FOREACH(const Field * f, vectors) {
+			out << "\tsize_t " << f->name << "_count = 0;" << endl;
+		}
+		out << "\tBOOST_FOREACH(ptree::value_type const & _val, _pt) {" << endl;
+		for (size_t i = 0; i < vectors.size(); i++) {
+			out << "\t\t" << (i > 0 ? "} else if" : "if") << " (_val.first == \"" << vectors[i]->nodeName << "\") {" << endl;
+			out << "\t\t\t" << vectors[i]->name << "_count++;" << endl;
+		}
+		out << "\t\t}" << endl;
+		out << "\t}" << endl;
+		BOOST_FOREACH(const Field * f, vectors) {
+			printCapacityCheck(*f, "_type." + f->name + ".size() + " + f->name + "_count",
+			                   "throw boost::property_tree::ptree_bad_data($M, _pt.data());", out, "\t");
+			out << "\t_type." << f->name << ".reserve(_type." << f->name << ".size() + " << f->name << "_count);" << endl;
+		}
+	}
+	map<unsigned, vector<Field const *> > eltsByHash, attrsByHash;
+	BOOST_FOREACH(const Field * f, elts) {
+		eltsByHash[nameHash(f->nodeName)].push_back(f);
+	}
+	BOOST_FOREACH(const Field * f, attrs) {
+		attrsByHash[nameHash(f->nodeName)].push_back(f);
+	}
+	out << "\tBOOST_FOREACH(ptree::value_type const & _val, _pt) {" << endl;
+	out << "\t\tconst string & _name = _val.first;" << endl;
+	out << "\t\tswitch (nameHash(_name.data(), _name.size())) {" << endl;
+	//the <xmlattr> child holding the attributes shares the switch with the elements
+	const unsigned attrsHash = nameHash("<xmlattr>");
+	if (!attrs.empty()) {
+		eltsByHash[attrsHash];
+	}
+	for (map<unsigned, vector<Field const *> >::const_iterator it = eltsByHash.begin(); it != eltsByHash.end(); ++it) {
+		out << "\t\tcase 0x" << hex << it->first << dec << "u:" << endl;
+		BOOST_FOREACH(const Field * f, it->second) {
+			out << "\t\t\tif (_name == \"" << f->nodeName << "\"" << (f->size == 1 || f->isOptionnal ? " && !_has_" + f->name : "") << ") {" << endl;
+			if (f->isOptionnal) {
+				out << "\t\t\t\tparse(boost::optional<const ptree &>(_val.second), _type." << f->name << ");" << endl;
+			} else if (f->size < 0) {
+				out << "\t\t\t\t_type." << f->name << ".emplace_back();" << endl;
+				out << "\t\t\t\tparse(_val.second, _type." << f->name << ".back());" << endl;
+			} else if (f->size > 1) {
+				out << "\t\t\t\tif (" << f->name << "_index < " << f->size << ") {" << endl;
+				out << "\t\t\t\t\tparse(_val.second, _type." << f->name << "[" << f->name << "_index++]);" << endl;
+				out << "\t\t\t\t}" << endl;
+			} else {
+				out << "\t\t\t\tparse(_val.second, _type." << f->name << ");" << endl;
+			}
+			if (f->size == 1 || f->isOptionnal) {
+				out << "\t\t\t\t_has_" << f->name << " = true;" << endl;
+			}
+			out << "\t\t\t\tcontinue;" << endl;
+			out << "\t\t\t}" << endl;
+		}
+		if (!attrs.empty() && it->first == attrsHash) {
+			out << "\t\t\tif (_name == \"<xmlattr>\") {" << endl;
+			out << "\t\t\t\tBOOST_FOREACH(ptree::value_type const & _att, _val.second) {" << endl;
+			out << "\t\t\t\t\tconst string & _attName = _att.first;" << endl;
+			out << "\t\t\t\t\tswitch (nameHash(_attName.data(), _attName.size())) {" << endl;
+			for (map<unsigned, vector<Field const *> >::const_iterator at = attrsByHash.begin(); at != attrsByHash.end(); ++at) {
+				out << "\t\t\t\t\tcase 0x" << hex << at->first << dec << "u:" << endl;
+				BOOST_FOREACH(const Field * f, at->second) {
+					out << "\t\t\t\t\t\tif (_attName == \"" << f->nodeName << "\") {" << endl;
+					if (f->isOptionnal) {
+						out << "\t\t\t\t\t\t\tparse(boost::optional<const ptree &>(_att.second), _type." << f->name << ");" << endl;
+					} else {
+						out << "\t\t\t\t\t\t\tparse(_att.second, _type." << f->name << ");" << endl;
+						out << "\t\t\t\t\t\t\t_has_" << f->name << " = true;" << endl;
+					}
+					out << "\t\t\t\t\t\t\tcontinue;" << endl;
+					out << "\t\t\t\t\t\t}" << endl;
+				}
+				out << "\t\t\t\t\t\tbreak;" << endl;
+			}
+			out << "\t\t\t\t\t}" << endl;
+			out << "\t\t\t\t}" << endl;
+			out << "\t\t\t\tcontinue;" << endl;
+			out << "\t\t\t}" << endl;
+		}
+		out << "\t\t\tbreak;" << endl;
+	}
+	out << "\t\t}" << endl;
+	out << "\t}" << endl;
+	BOOST_FOREACH(const Field * f, fields) {
+		if (f->size == 1 && !f->isOptionnal) {
+			const string path = (f->isAttr ? "<xmlattr>." : "") + f->nodeName;
+			out << "\tif (!_has_" << f->name << ") {" << endl;
+			out << "\t\tthrow boost::property_tree::ptree_bad_path(\"No such node\", ptree::path_type(\"" << path << "\"));" << endl;
+			out << "\t}" << endl;
+		}
+	}
+	out << "}" << endl;
+}
+
+// Hashes the xsi:type value with the generated nameHash and switches on it, checking
+// the name under each case; create is emitted for each type, $T standing for its C++ type.
+void Gen::printXsiTypeSwitch(const Type & t, ofstream & out, const string & create) const
+{
+	vector<Type *> dynTypes(1, const_cast<Type *>(&t));
+	getAllChildTypes(t, dynTypes);
+	map<unsigned, vector<Type *> > byHash;
+	BOOST_FOREACH(Type * dt, dynTypes) {
+		byHash[nameHash(dt->name)].push_back(dt);
+	}
+	out << "\tswitch (nameHash(_baseType.data(), _baseType.size())) {" << endl;
+	for (map<unsigned, vector<Type *> >::const_iterator it = byHash.begin(); it != byHash.end(); ++it) {
+		out << "\tcase 0x" << hex << it->first << dec << "u:" << endl;
+		BOOST_FOREACH(Type * dt, it->second) {
+			const string dtType = cppType(*dt);
+			out << "\t\tif (_baseType == \"" << dt->name << "\") {" << endl;
+			out << boost::replace_all_copy(create, "$T", dtType);
+			out << "\t\t\treturn;" << endl;
+			out << "\t\t}" << endl;
+		}
+		out << "\t\tbreak;" << endl;
+	}
+	out << "\t}" << endl;
+}
+
+void Gen::printEnumSrc(const Enum & e, ofstream & out) const
+{
+	out << "static constexpr std::string_view " << e.name << "strVals[] = {" << endl;
+	BOOST_FOREACH(const string & val, e.values) {
+		out << "\t\"" << val << "\"," << endl;
+	}
+	out << "};" << endl;
+	map<size_t, vector<size_t> > byLength;
+	for (size_t i = 0; i < e.values.size(); i++) {
+		byLength[e.values[i].size()].push_back(i);
+	}
+	out << e.name << " str2" << e.name << "(std::string_view str) {" << endl;
+	out << "\tswitch (str.size()) {" << endl;
+	for (map<size_t, vector<size_t> >::const_iterator it = byLength.begin(); it != byLength.end(); ++it) {
+		out << "\tcase " << it->first << ":" << endl;
+		printEnumSwitch(e, it->second, out, "\t\t");
+		out << "\t\tbreak;" << endl;
+	}
+	out << "\t}" << endl;
+	out << "\tthrow domain_error(\"Invalid Enum Val \" + string(str));" << endl;
+	out << "}" << endl;
+	out << "string " << e.name << "2str(const " << e.name << " & v) {" << endl;
+	out << "\treturn string(" << e.name << "strVals[(unsigned int)v]);" << endl;
+	out << "}" << endl;
+	out << "void writeValue(cppxb::Writer & w, const " << e.name << " & v) {" << endl;
+	out << "\tw.append(" << e.name << "strVals[(unsigned int)v]);" << endl;
+	out << "}" << endl;
+	out << "void encodeValue(cppxb::BinaryWriter & w, const " << e.name << " & v) {" << endl;
+	out << "\tw.varint((unsigned int)v);" << endl;
+	out << "}" << endl;
+	out << "void decodeValue(cppxb::BinaryReader & r, " << e.name << " & v) {" << endl;
+	out << "\tconst unsigned long long i = r.varint();" << endl;
+	out << "\tif (i >= " << e.values.size() << ") {" << endl;
+	out << "\t\tr.invalid(\"invalid " << e.name << " value\");" << endl;
+	out << "\t}" << endl;
+	out << "\tv = (" << e.name << ")i;" << endl;
+	out << "}" << endl;
+}
+
+// values all have the same length: switches on the character telling most of them apart
+// until a single candidate is left, which is then compared in full.
+void Gen::printEnumSwitch(const Enum & e, const vector<size_t> & values, ofstream & out, const string & indent) const
+{
+	const size_t len = e.values[values.front()].size();
+	size_t bestPos = 0;
+	size_t bestCount = 1;
+	for (size_t pos = 0; pos < len && values.size() > 1; pos++) {
+		set<char> chars;
+		BOOST_FOREACH(size_t v, values) {
+			chars.insert(e.values[v][pos]);
+		}
+		if (chars.size() > bestCount) {
+			bestPos = pos;
+			bestCount = chars.size();
+		}
+	}
+	string prefix = e.name + "_";
+	boost::to_upper(prefix);
+	if (bestCount == 1) {
+		BOOST_FOREACH(size_t v, values) {
+			out << indent << "if (str == " << e.name << "strVals[" << v << "]) {" << endl;
+			out << indent << "\treturn " << prefix << e.values[v] << ";" << endl;
+			out << indent << "}" << endl;
 		}
+		return;
 	}
-	return false;
+	map<char, vector<size_t> > byChar;
+	BOOST_FOREACH(size_t v, values) {
+		byChar[e.values[v][bestPos]].push_back(v);
+	}
+	out << indent << "switch (str[" << bestPos << "]) {" << endl;
+	for (map<char, vector<size_t> >::const_iterator it = byChar.begin(); it != byChar.end(); ++it) {
+		const char c = it->first;
+		out << indent << "case " << ((c == '\'' || c == '\\') ? "'\\" + string(1, c) + "'" : "'" + string(1, c) + "'") << ":" << endl;
+		printEnumSwitch(e, it->second, out, indent + "\t");
+		out << indent << "\tbreak;" << endl;
+	}
+	out << indent << "}" << endl;
 }
 
-bool Gen::hasOptional(const Type & t) const
+void Gen::printArenaParse(const vector<Type> & types, ofstream & out) const
 {
-	BOOST_FOREACH(const Field & f, t.fields) {
-		if (f.isOptionnal) {
-			return true;
+	BOOST_FOREACH(const Type & t, types) {
+		out << "void parse(const boost::property_tree::ptree &, cppxb::arena_ptr<" << t.fullPath
+		    << "> &, std::pmr::memory_resource & arena);" << endl;
+		if (options.pullParser) {
+			out << "void parse(cppxb::Reader &, cppxb::arena_ptr<" << t.fullPath << "> &, std::pmr::memory_resource & arena);" << endl;
 		}
 	}
-	BOOST_FOREACH(const Type & st, t.subTypes) {
-		if (hasOptional(st)) {
-			return true;
+}
+
+void Gen::printArenaSrc(const vector<Type> & types, ofstream & out) const
+{
+	BOOST_FOREACH(const Type & t, types) {
+		out << "void parse(const ptree & _pt, cppxb::arena_ptr<" << t.fullPath << "> & _t, std::pmr::memory_resource & _arena) {"
+		    << endl;
+		out << "\tcppxb::ArenaScope _scope(_arena);" << endl;
+		out << "\tparse(_pt, _t);" << endl;
+		out << "}" << endl;
+		if (options.pullParser) {
+			out << "void parse(cppxb::Reader & _r, cppxb::arena_ptr<" << t.fullPath << "> & _t, std::pmr::memory_resource & _arena) {"
+			    << endl;
+			out << "\tcppxb::ArenaScope _scope(_arena);" << endl;
+			out << "\tparse(_r, _t);" << endl;
+			out << "}" << endl;
 		}
 	}
-	return false;
 }
 
-bool Gen::hasVirtual(const Type & t) const
+void Gen::printPullParse(const vector<Type> & types, ofstream & out) const
 {
-	BOOST_FOREACH(const Field & f, t.fields) {
-		if (f.pType && !f.pType->pChildTypes.empty()) {
-			return true;
+	BOOST_FOREACH(const Type & t, types) {
+		out << "void parse(cppxb::Reader &, " << t.fullPath << " &);" << endl;
+		out << "void parse(cppxb::Reader &, " << t.fullPath << " &, const " << t.fullPath << "::mask &);" << endl;
+		if (options.lazyTypes && !t.pParentType) {
+			out << "void parse(cppxb::Reader &, lazy::" << t.fullPath << " &);" << endl;
 		}
-	}
-	BOOST_FOREACH(const Type & st, t.subTypes) {
-		if (hasVirtual(st)) {
-			return true;
+		if (hasRepeatedElements(t)) {
+			out << "void parse_parallel(cppxb::Reader &, " << t.fullPath << " &, unsigned threads = 0);" << endl;
+			if (!options.stringViews) {
+				out << "void parse_parallel(std::string_view, " << t.fullPath << " &, unsigned threads = 0);" << endl;
+			}
 		}
+		out << "void validate(cppxb::Reader &, const " << t.fullPath << " *, cppxb::Validation &);" << endl;
+		if (isPolymorphic(t)) {
+			out << "void parse(cppxb::Reader &, " << ptrType() << "<" << t.fullPath << "> &);" << endl;
+			out << "void validate(cppxb::Reader &, const " << ptrType() << "<" << t.fullPath << "> *, cppxb::Validation &);" << endl;
+		}
+		printPullParse(t.subTypes, out);
 	}
-	return false;
 }
 
-bool Gen::isSubType(const string & n, const Type & t) const
+void Gen::printBatchParse(const vector<Type> & types, ofstream & out) const
 {
-	BOOST_FOREACH(const Type & st, t.subTypes) {
-		if (n.find(st.name) != string::npos) {
-			return true;
-		}
-		if (isSubType(n, st)) {
-			return true;
-		}
+	BOOST_FOREACH(const Type & t, types) {
+		out << "void parse_batch(cppxb::Batch &, const std::string_view * docs, size_t count, std::vector< cppxb::Parsed<"
+		    << t.fullPath << "> > & results);" << endl;
 	}
-	return false;
 }
 
-string Gen::cppType(const Type & t) const
+void Gen::printValidate(const vector<Type> & types, ofstream & out) const
 {
-	string ct = t.fullPath;
-	boost::replace_all(ct, ".", "::");
-	return ct;
+	BOOST_FOREACH(const Type & t, types) {
+		out << "bool validate(std::string_view doc, const " << t.fullPath << " *, cppxb::Validation &);" << endl;
+	}
 }
 
-string Gen::cppType(const Field & f, bool absolute) const
+void Gen::printPullSrc(const InterRep & rep, ofstream & out) const
 {
-	string t = f.type;
-	if (absolute && f.pType) {
-		t = cppType(*f.pType);
+	out << "using cppxb::parseValue;" << endl;
+	BOOST_FOREACH(const Enum & e, rep.enums) {
+		out << "void parseValue(cppxb::Reader & r, std::string_view v, " << e.name << " & e) {" << endl;
+		out << "\tstring & s = r.buffer();" << endl;
+		out << "\tcppxb::decode(v, s);" << endl;
+		out << "\te = str2" << e.name << "(s);" << endl;
+		out << "}" << endl;
+		out << "bool validValue(cppxb::Reader & r, std::string_view v, const " << e.name << " *) {" << endl;
+		out << "	string & s = r.buffer();" << endl;
+		out << "	cppxb::decode(v, s);" << endl;
+		out << "	BOOST_FOREACH(std::string_view val, " << e.name << "strVals) {" << endl;
+		out << "		if (s == val) {" << endl;
+		out << "			return true;" << endl;
+		out << "		}" << endl;
+		out << "	}" << endl;
+		out << "	return false;" << endl;
+		out << "}" << endl;
 	}
-	if (f.type == "string") {
-		t = "" + t;
+	out << "using cppxb::validValue;" << endl;
+	out << "template<typename T> void parse(cppxb::Reader & r, T & t) { parseValue(r, r.text(), t); }" << endl;
+	out << "template<typename T> void validate(cppxb::Reader & r, const T * t, cppxb::Validation & v) {"
+	    << " const std::string_view n = r.name(); const std::string_view s = r.text(); if (!validValue(r, s, t)) { v.invalid(r, s, n); } }"
+	    << endl;
+	out << "template<typename T, typename M> void parse(cppxb::Reader & r, T & t, const M * m) { if (m) { parse(r, t, *m); } else { parse(r, t); } }"
+	    << endl;
+	const string optional = optionalParam("", "t");
+	if (options.allocators) {
+		out << "template<typename T, typename M> void parse(cppxb::Reader & r, " << optional << ", const M * m) { parse(r, cppxb::emplace(t), m); }"
+		    << endl;
+		out << "template<typename T> void parse(cppxb::Reader & r, " << optional << ") { parse(r, cppxb::emplace(t)); }" << endl;
+		out << "template<typename T> void parseValue(cppxb::Reader & r, std::string_view v, " << optional << ") { parseValue(r, v, cppxb::emplace(t)); }"
+		    << endl;
+	} else {
+		out << "template<typename T, typename M> void parse(cppxb::Reader & r, " << optional << ", const M * m) { t.emplace(); parse(r, *t, m); }"
+		    << endl;
+		out << "template<typename T> void parse(cppxb::Reader & r, " << optional << ") { t.emplace(); parse(r, *t); }"
+		    << endl;
+		out << "template<typename T> void parseValue(cppxb::Reader & r, std::string_view v, " << optional << ") { t.emplace(); parseValue(r, v, *t); }"
+		    << endl;
 	}
-	if (f.pType && !f.pType->pChildTypes.empty()) {
-		t = "boost::shared_ptr< " + t + " >";
+	bool polymorphic = false;
+	BOOST_FOREACH(const Type & t, rep.types) {
+		polymorphic = polymorphic || hasVirtual(t);
 	}
-	if (f.isOptionnal) {
-		t = "boost::optional< " + t + " >";
-	} else if (f.size < 0) {
-		t = "vector< " + t + " >";
-	} else if (f.size > 1) {
-		t = "boost::array<" + t + "," + boost::lexical_cast<string>(f.size) + ">";
+	if (polymorphic || options.allocators) {
+		out << "template<typename T> void parse(cppxb::Reader & r, " << ptrType() << "<T> & t) { t = " << newObject("T")
+		    << "; parse(r, *t); }" << endl;
+	}
+	BOOST_FOREACH(const Type & t, rep.types) {
+		printTypePullSrc(t, out);
+	}
+	BOOST_FOREACH(const Type & t, rep.types) {
+		out << "void parse_batch(cppxb::Batch & _batch, const std::string_view * _docs, size_t _count, std::vector< cppxb::Parsed<"
+		    << t.fullPath << "> > & _results) {" << endl;
+		out << "\t_batch.parse(_docs, _count, _results, [](cppxb::Reader & _r, " << t.fullPath << " & _item) { parse(_r, _item); });" << endl;
+		out << "}" << endl;
+		out << "bool validate(std::string_view _doc, const " << t.fullPath << " * _t, cppxb::Validation & _v) {" << endl;
+		out << "	try {" << endl;
+		out << "		cppxb::Reader _r(_doc);" << endl;
+		string roots;
+		for (map<string, string>::const_iterator it = rep.elements.begin(); it != rep.elements.end(); ++it) {
+			if (it->second == t.name) {
+				roots += (roots.empty() ? "" : " && ") + string("_r.name() != \"") + it->first + "\"";
+			}
+		}
+		if (!roots.empty()) {
+			out << "		if (" << roots << ") {" << endl;
+			out << "			_v.unexpected(_r);" << endl;
+			out << "		}" << endl;
+		}
+		out << "		validate(_r, _t, _v);" << endl;
+		out << "		_r.finish();" << endl;
+		out << "	} catch (const cppxb::parse_error & _e) {" << endl;
+		out << "		_v.report(_e.offset(), _e.what());" << endl;
+		out << "	}" << endl;
+		out << "	return _v.valid();" << endl;
+		out << "}" << endl;
 	}
-	return t;
 }
 
-void Gen::getDepends(const vector<Type> & types, set<string> & depends) const
+void Gen::printTypePullSrc(const Type & t, ofstream & out) const
 {
-	BOOST_FOREACH(const Type & t, types) {
-		for (size_t i = 0; i < t.pChildTypes.size(); i++) {
-			depends.insert("\"" + t.pChildTypes[i]->pInterRep->name + ".h\"");
+	BOOST_FOREACH(const Type & st, t.subTypes) {
+		printTypePullSrc(st, out);
+	}
+	out << endl;
+	const string consumed = options.statistics ? "\t_stats.consumed(_r.offset());\n" : "";
+	out << "void parse(cppxb::Reader & _r, " << t.fullPath << " & _type) {" << endl;
+	printStatsScope(t, "PARSE", "_r.tagOffset()", out);
+	printTypePullBody(t, out, PULL_PARSE);
+	out << consumed << "}" << endl;
+	out << "void parse(cppxb::Reader & _r, " << t.fullPath << " & _type, const " << t.fullPath << "::mask & _m) {" << endl;
+	printStatsScope(t, "PARSE", "_r.tagOffset()", out);
+	printTypePullBody(t, out, PULL_MASK);
+	out << consumed << "}" << endl;
+	if (hasRepeatedElements(t)) {
+		out << "void parse_parallel(cppxb::Reader & _r, " << t.fullPath << " & _type, unsigned _threads) {" << endl;
+		printStatsScope(t, "PARSE", "_r.tagOffset()", out);
+		printTypePullBody(t, out, PULL_PARALLEL);
+		out << consumed << "}" << endl;
+		if (!options.stringViews) {
+			out << "void parse_parallel(std::string_view _doc, " << t.fullPath << " & _type, unsigned _threads) {" << endl;
+			out << "\tcppxb::Reader _r(_doc);" << endl;
+			out << "\tparse_parallel(_r, _type, _threads);" << endl;
+			out << "}" << endl;
 		}
-		getDepends(t.subTypes, depends);
+	}
+	if (options.lazyTypes && !t.pParentType) {
+		out << "void parse(cppxb::Reader & _r, lazy::" << t.fullPath << " & _type) {" << endl;
+		out << "\t_type._start(_r);" << endl;
+		printTypePullBody(t, out, PULL_LAZY);
+		out << "}" << endl;
+	}
+	printTypeValidateSrc(t, out);
+	printColumnsPullSrc(t, out);
+
+	if (isPolymorphic(t)) {
+		out << "void parse(cppxb::Reader & _r, " << ptrType() << "<" << t.fullPath << "> & _t) {" << endl;
+		out << "\tconst cppxb::Attribute * _xsiType = _r.attribute(\"xsi:type\");" << endl;
+		out << "\tconst std::string_view _baseType = _xsiType ? _xsiType->value : std::string_view();" << endl;
+		printXsiTypeSwitch(t, out, "\t\t\t" + ptrType() + "<$T> _tmp = " + newObject("$T") + ";\n"
+		                   "\t\t\tparse(_r, *_tmp);\n\t\t\t_t = std::move(_tmp);\n");
+		out << "\t_r.skip();" << endl;
+		out << "}" << endl;
+		out << "void validate(cppxb::Reader & _r, const " << ptrType() << "<" << t.fullPath << "> *, cppxb::Validation & _v) {" << endl;
+		out << "\tconst cppxb::Attribute * _xsiType = _r.attribute(\"xsi:type\");" << endl;
+		out << "\tconst std::string_view _baseType = _xsiType ? _xsiType->value : std::string_view();" << endl;
+		printXsiTypeSwitch(t, out, "\t\t\tvalidate(_r, (const $T *)0, _v);\n");
+		out << "\t_v.invalid(_r, _baseType, \"xsi:type\");" << endl;
+		out << "\t_r.skip();" << endl;
+		out << "}" << endl;
 	}
 }
 
-void Gen::printType(const Type & t, ofstream & out, string indent) const
+// Type of the values of a field, selecting the validate overload of its
+// elements and the validValue overload of its attributes.
+string Gen::validateTag(const Field & f) const
 {
+	Field value = f;
+	value.isOptionnal = false;
+	value.size = 1;
+	return cppType(value, true);
+}
 
-	BOOST_FOREACH(Type * ct, t.pChildTypes) {
-		const string ctType = cppType(*ct);
-		out << indent << "struct " << ctType << ";" << endl;
-		BOOST_FOREACH(Type * cct, ct->pChildTypes) {
-			const string cctType = cppType(*cct);
-			out << indent << "struct " << cctType << ";" << endl;
+// Counts the elements of each field, checking the counts against the
+// occurrence bounds once the end tag is reached; extra elements are reported
+// and skipped.
+void Gen::printTypeValidateSrc(const Type & t, ofstream & out) const
+{
+	vector<Field const *> fields, attrs, elts;
+	getAllFields(t, fields);
+	bool required = false;
+	BOOST_FOREACH(const Field * f, fields) {
+		if (f->isAttr) {
+			attrs.push_back(f);
+		} else {
+			elts.push_back(f);
 		}
+		required = required || f->minOccurs > 0;
 	}
-	out << endl;
-	out << indent << "struct " << t.name << (t.superType.empty() ? "" : " : public " + t.superType ) << " {" << endl;
-	out << endl;
-	BOOST_FOREACH(const Type & st, t.subTypes) {
-		printType(st, out, "\t");
+	out << "void validate(cppxb::Reader & _r, const " << t.fullPath << " *, cppxb::Validation & _v) {" << endl;
+	if (required) {
+		out << "\tconst size_t _at = _r.tagOffset();" << endl;
 	}
-
-	size_t maxTypeLen = 0;
-	BOOST_FOREACH(const Field & f, t.fields) {
-		maxTypeLen = max(maxTypeLen, cppType(f).length());
+	BOOST_FOREACH(const Field * f, attrs) {
+		if (!f->isOptionnal) {
+			out << "\tbool _has_" << f->name << " = false;" << endl;
+		}
 	}
-
-	BOOST_FOREACH(const Field & f, t.fields) {
-		const string fType = cppType(f);
-		out << indent << "\t" << fType << string(maxTypeLen - fType.length(), ' ') << " " << f.name << ";" << endl;
+	BOOST_FOREACH(const Field * f, elts) {
+		if (f->minOccurs > 0 || f->maxOccurs >= 0) {
+			out << "\tsize_t _n_" << f->name << " = 0;" << endl;
+		}
 	}
-	out << endl;
-
-	if (!t.pChildTypes.empty()) {
-		out << indent << "\tvirtual ~" << t.name << "(){}" << endl;
-		out << endl;
+	if (!attrs.empty()) {
+		out << "\tBOOST_FOREACH(const cppxb::Attribute & _a, _r.attributes()) {" << endl;
+		BOOST_FOREACH(const Field * f, attrs) {
+			out << "\t\tif (_a.name == \"" << f->nodeName << "\") {" << endl;
+			out << "\t\t\tif (!validValue(_r, _a.value, (const " << validateTag(*f) << " *)0)) {" << endl;
+			out << "\t\t\t\t_v.invalid(_r, _a.value, _a.name);" << endl;
+			out << "\t\t\t}" << endl;
+			if (!f->isOptionnal) {
+				out << "\t\t\t_has_" << f->name << " = true;" << endl;
+			}
+			out << "\t\t\tcontinue;" << endl;
+			out << "\t\t}" << endl;
+		}
+		out << "\t}" << endl;
 	}
-	BOOST_FOREACH(Type * ct, t.pChildTypes) {
-		const string ctType = cppType(*ct);
-		out << indent << "\t" << ctType << " * as_" << ct->name << "();" << endl;
-		out << indent << "\tconst " << ctType << " * as_" << ct->name << "() const;" << endl;
-		BOOST_FOREACH(Type * cct, ct->pChildTypes) {
-			const string cctType = cppType(*cct);
-			out << indent << "\t" << cctType << " * as_" << cct->name << "();" << endl;
-			out << indent << "\tconst " << cctType << " * as_" << cct->name << "() const;" << endl;
+	out << "\twhile (_r.nextChild()) {" << endl;
+	if (!elts.empty()) {
+		out << "\t\tconst std::string_view _name = _r.name();" << endl;
+		BOOST_FOREACH(const Field * f, elts) {
+			out << "\t\tif (_name == \"" << f->nodeName << "\") {" << endl;
+			if (f->maxOccurs >= 0) {
+				out << "\t\t\tif (++_n_" << f->name << " > " << f->maxOccurs << ") {" << endl;
+				out << "\t\t\t\t_v.tooMany(_r, " << f->maxOccurs << ");" << endl;
+				out << "\t\t\t\t_r.skip();" << endl;
+				out << "\t\t\t\tcontinue;" << endl;
+				out << "\t\t\t}" << endl;
+			} else if (f->minOccurs > 0) {
+				out << "\t\t\t_n_" << f->name << "++;" << endl;
+			}
+			out << "\t\t\tvalidate(_r, (const " << validateTag(*f) << " *)0, _v);" << endl;
+			out << "\t\t\tcontinue;" << endl;
+			out << "\t\t}" << endl;
 		}
 	}
-	out << indent << "};" << endl;
+	out << "\t\t_v.unexpected(_r);" << endl;
+	out << "\t\t_r.skip();" << endl;
+	out << "\t}" << endl;
+	BOOST_FOREACH(const Field * f, attrs) {
+		if (!f->isOptionnal) {
+			out << "\tif (!_has_" << f->name << ") {" << endl;
+			out << "\t\t_v.missing(_at, \"attribute\", \"" << f->nodeName << "\");" << endl;
+			out << "\t}" << endl;
+		}
+	}
+	BOOST_FOREACH(const Field * f, elts) {
+		if (f->minOccurs == 1) {
+			out << "\tif (_n_" << f->name << " == 0) {" << endl;
+			out << "\t\t_v.missing(_at, \"element\", \"" << f->nodeName << "\");" << endl;
+			out << "\t}" << endl;
+		} else if (f->minOccurs > 1) {
+			out << "\tif (_n_" << f->name << " < " << f->minOccurs << ") {" << endl;
+			out << "\t\t_v.tooFew(_at, \"" << f->nodeName << "\", _n_" << f->name << ", " << f->minOccurs << ");" << endl;
+			out << "\t}" << endl;
+		}
+	}
+	out << "}" << endl;
 }
 
-void Gen::printTypeParse(const Type & t, std::ofstream & out, std::string indent) const
+void Gen::printLazyType(const Type & t, ofstream & out, const string & ns) const
 {
-	out << "void parse(const boost::property_tree::ptree &, " << t.fullPath << " &);" << endl;
-	out << "void put(const " << t.fullPath << " &, boost::property_tree::ptree &, const std::string & path=std::string(\""
-	    << t.name << "\"));" << endl;
-	BOOST_FOREACH(const Type & st, t.subTypes) {
-		printTypeParse(st, out);
+	vector<Field const *> fields;
+	getAllFields(t, fields);
+	out << "class " << t.name << " : public cppxb::Lazy {" << endl;
+	out << "public:" << endl;
+	out << "\ttypedef ::" << ns << "::" << t.fullPath << " value_type;" << endl;
+	out << endl;
+	out << "\t" << t.name << "() {}" << endl;
+	out << "\t" << t.name << "(" << t.name << " &&) = default;" << endl;
+	out << "\t" << t.name << " & operator=(" << t.name << " &&) = default;" << endl;
+	out << endl;
+	BOOST_FOREACH(const Field * f, fields) {
+		out << "\tconst decltype(value_type::" << f->name << ") & " << f->name << "() const";
+		if (isLazy(*f)) {
+			out << ";" << endl;
+		} else {
+			out << " { return _value." << f->name << "; }" << endl;
+		}
+	}
+	out << "\t// The whole value, parsing the elements not read yet." << endl;
+	out << "\tconst value_type & value() const;" << endl;
+	out << endl;
+	out << "\t// Filled by parser::parse." << endl;
+	out << "\tmutable value_type _value;" << endl;
+	BOOST_FOREACH(const Field * f, fields) {
+		if (isLazy(*f)) {
+			out << "\tmutable std::vector<std::string_view> _e_" << f->name << ";" << endl;
+		}
 	}
+	out << "};" << endl;
 }
 
-void Gen::printTypeSrc(const Type & t, ofstream & out, const string & ns) const
+void Gen::printLazySrc(const vector<Type> & types, ofstream & out) const
 {
-	BOOST_FOREACH(const Type & st, t.subTypes) {
-		printTypeSrc(st, out, ns + t.name + "::");
-	}
-	out << endl;
-	out << "void parse(const ptree & _pt, " << t.fullPath << " & _type) {" << endl;
-	if (t.pSuperType) {
-		out << "\tparse(_pt, *((" << t.pSuperType->fullPath << "*)&_type));" << endl;
+	BOOST_FOREACH(const Type & t, types) {
+		const string lType = "lazy::" + t.fullPath;
+		vector<Field const *> fields;
+		getAllFields(t, fields);
+		BOOST_FOREACH(const Field * f, fields) {
+			if (!isLazy(*f)) {
+				continue;
+			}
+			out << "const decltype(" << lType << "::value_type::" << f->name << ") & " << lType << "::" << f->name << "() const {" << endl;
+			out << "\tif (!_e_" << f->name << ".empty()) {" << endl;
+			out << "\t\t_decode(_e_" << f->name << ", [this](cppxb::Reader & _r, size_t" << (f->size > 1 ? " _i" : "") << ") { ";
+			if (f->size < 0) {
+				out << "_value." << f->name << ".emplace_back(); parser::parse(_r, _value." << f->name << ".back());";
+			} else if (f->size > 1) {
+				out << "parser::parse(_r, _value." << f->name << "[_i]);";
+			} else {
+				out << "parser::parse(_r, _value." << f->name << ");";
+			}
+			out << " }, [this]() { _value." << f->name << " = decltype(_value." << f->name << ")(); });" << endl;
+			out << "\t}" << endl;
+			out << "\treturn _value." << f->name << ";" << endl;
+			out << "}" << endl;
+		}
+		out << "const " << lType << "::value_type & " << lType << "::value() const {" << endl;
+		BOOST_FOREACH(const Field * f, fields) {
+			if (isLazy(*f)) {
+				out << "\t" << f->name << "();" << endl;
+			}
+		}
+		out << "\treturn _value;" << endl;
+		out << "}" << endl;
 	}
-	vector<Field const *> arrays, vectors;
-	BOOST_FOREACH(const Field & f, t.fields) {
-		if (f.isOptionnal) {
-			const string path = (f.isAttr) ? "<xmlattr>." : "";
-			out << "\tparse( _pt.get_child_optional(\"" << path << f.nodeName << "\") , _type." << f.name << ");" << endl;
-		} else if (f.isAttr) {
-			out << "\tparse( _pt.get_child(\"<xmlattr>." << f.nodeName << "\") , _type." << f.name << ");" << endl;
-		} else if (f.size < 0) {
-			vectors.push_back(&f);
-		} else if (f.size > 1) {
-			arrays.push_back(&f);
+}
+
+void Gen::printTypePullBody(const Type & t, ofstream & out, PullMode mode) const
+{
+	const string value = (mode == PULL_LAZY) ? "_type._value." : "_type.";
+	const bool masked = mode == PULL_MASK;
+	//the element read by a whole parse is the source of the value, a masked parse reads part of it
+	const bool tracked = options.dirtyTracking && (mode == PULL_PARSE || mode == PULL_PARALLEL);
+	vector<Field const *> fields, attrs, elts;
+	getAllFields(t, fields);
+	BOOST_FOREACH(const Field * f, fields) {
+		if (f->isAttr) {
+			attrs.push_back(f);
 		} else {
-			out << "\tparse( _pt.get_child(\"" << f.nodeName << "\") , _type." << f.name << ");" << endl;
+			elts.push_back(f);
 		}
 	}
-	if (!arrays.empty() || !vectors.empty()) {
-		BOOST_FOREACH(const Field * f, arrays) {
+	if (tracked) {
+		out << "\tconst size_t _at = _r.tagOffset();" << endl;
+	} else if (options.dirtyTracking && masked) {
+		out << "\t_type._touchAll();" << endl;
+	}
+	BOOST_FOREACH(const Field * f, fields) {
+		const bool lazy = mode == PULL_LAZY && isLazy(*f);
+		//an optional element is only read once, whatever the value held before
+		if (f->isAttr ? !f->isOptionnal : (f->size == 1 || f->isOptionnal)) {
+			out << "\tbool _has_" << f->name << " = false;" << endl;
+		} else if (f->size > 1) {
 			out << "\tsize_t " << f->name << "_index = 0;" << endl;
+		} else if (isStreamed(*f) && !lazy) {
+			const string vType = cppType(*f->pParentType) + "::visitor";
+			out << "\t" << vType << " * _v_" << f->name << " = _r.visitor<" << vType << ">();" << endl;
+		}
+		if (mode == PULL_PARALLEL && !f->isAttr && f->size < 0 && !usesColumns(*f)) {
+			out << "\tstd::vector<std::string_view> _e_" << f->name << ";" << endl;
 		}
-		out << "\tBOOST_FOREACH(ptree::value_type const & _val, _pt.get_child(\"\")) {" << endl;
-		BOOST_FOREACH(const Field * f, arrays) {
-			const string baseT = f->type;
-			out << "\t\tif (_val.first == \"" << f->nodeName << "\") {" << endl;
-			out << "\t\t\tparse(_val.second , _type." << f->name << "[" << f->name << "_index]);" << endl;
-			out << "\t\t\t" << f->name << "_index++;" << endl;
+	}
+	if (!attrs.empty()) {
+		out << "\tBOOST_FOREACH(const cppxb::Attribute & _a, _r.attributes()) {" << endl;
+		BOOST_FOREACH(const Field * f, attrs) {
+			out << "\t\tif (_a.name == \"" << f->nodeName << "\"" << (masked ? " && _m.has(_m.F_" + f->name + ")" : "") << ") {" << endl;
+			out << "\t\t\tparseValue(_r, _a.value, " << value << f->name << ");" << endl;
+			if (!f->isOptionnal) {
+				out << "\t\t\t_has_" << f->name << " = true;" << endl;
+			}
 			out << "\t\t\tcontinue;" << endl;
 			out << "\t\t}" << endl;
 		}
-		BOOST_FOREACH(const Field * f, vectors) {
-			out << "\t\tif (_val.first == \"" << f->nodeName << "\") {" << endl;
-			out << "\t\t\t" << cppType(*f, true) << "::value_type _tmp;" << endl;
-			out << "\t\t\tparse(_val.second , _tmp);" << endl;
-			out << "\t\t\t_type." << f->name << ".push_back(_tmp);" << endl;
+		out << "\t}" << endl;
+	}
+	if (elts.empty()) {
+		out << "\t_r.skip();" << endl;
+	} else {
+		out << "\twhile (_r.nextChild()) {" << endl;
+		out << "\t\tconst std::string_view _name = _r.name();" << endl;
+		BOOST_FOREACH(const Field * f, elts) {
+			const bool lazy = mode == PULL_LAZY && isLazy(*f);
+			const string record = "_type._e_" + f->name + ".push_back(_r.element());";
+			//selected complex fields are read with their own mask
+			const string sub = (masked && hasMask(*f)) ? ", _m." + f->name : "";
+			out << "\t\tif (_name == \"" << f->nodeName << "\"";
+			if (masked) {
+				out << " && _m.has(_m.F_" << f->name << ")";
+			}
+			if (f->size == 1 || f->isOptionnal) {
+				out << " && !_has_" << f->name;
+			}
+			out << ") {" << endl;
+			if (f->isOptionnal) {
+				out << "\t\t\t" << (lazy ? record : "parse(_r, " + value + f->name + sub + ");") << endl;
+				out << "\t\t\t_has_" << f->name << " = true;" << endl;
+			} else if (isStreamed(*f) && !lazy) {
+				out << "\t\t\tif (_v_" << f->name << ") {" << endl;
+				out << "\t\t\t\t" << cppType(*f, true) << "::value_type _tmp;" << endl;
+				out << "\t\t\t\tparse(_r, _tmp" << sub << ");" << endl;
+				out << "\t\t\t\t_v_" << f->name << "->on_" << f->name << "(_tmp);" << endl;
+				out << "\t\t\t} else {" << endl;
+				if (mode == PULL_PARALLEL) {
+					printCapacityCheck(*f, "_type." + f->name + ".size() + _e_" + f->name + ".size() + 1", "_r.error($M);", out, "\t\t\t\t");
+					out << "\t\t\t\t_e_" << f->name << ".push_back(_r.element());" << endl;
+				} else {
+					printCapacityCheck(*f, value + f->name + ".size() + 1", "_r.error($M);", out, "\t\t\t\t");
+					out << "\t\t\t\t" << value << f->name << ".emplace_back();" << endl;
+					out << "\t\t\t\tparse(_r, " << value << f->name << ".back()" << sub << ");" << endl;
+				}
+				out << "\t\t\t}" << endl;
+			} else if (f->size < 0 && lazy) {
+				out << "\t\t\t" << record << endl;
+			} else if (f->size < 0 && mode == PULL_PARALLEL && !usesColumns(*f)) {
+				printCapacityCheck(*f, "_type." + f->name + ".size() + _e_" + f->name + ".size() + 1", "_r.error($M);", out, "\t\t\t");
+				out << "\t\t\t_e_" << f->name << ".push_back(_r.element());" << endl;
+			} else if (f->size < 0) {
+				printCapacityCheck(*f, value + f->name + ".size() + 1", "_r.error($M);", out, "\t\t\t");
+				out << "\t\t\t" << value << f->name << ".emplace_back();" << endl;
+				out << "\t\t\tparse(_r, " << value << f->name << ".back()" << sub << ");" << endl;
+			} else if (f->size > 1) {
+				out << "\t\t\tif (" << f->name << "_index < " << f->size << ") {" << endl;
+				if (lazy) {
+					out << "\t\t\t\t" << record << endl;
+					out << "\t\t\t\t" << f->name << "_index++;" << endl;
+				} else {
+					out << "\t\t\t\tparse(_r, " << value << f->name << "[" << f->name << "_index++]" << sub << ");" << endl;
+				}
+				out << "\t\t\t} else {" << endl;
+				out << "\t\t\t\t_r.skip();" << endl;
+				out << "\t\t\t}" << endl;
+			} else {
+				out << "\t\t\t" << (lazy ? record : "parse(_r, " + value + f->name + sub + ");") << endl;
+				out << "\t\t\t_has_" << f->name << " = true;" << endl;
+			}
 			out << "\t\t\tcontinue;" << endl;
 			out << "\t\t}" << endl;
 		}
+		out << "\t\t_r.skip();" << endl;
 		out << "\t}" << endl;
 	}
-	out << "}" << endl;
-	out << endl;
-
-	out << "void put(const " << t.fullPath << " & _type, ptree & _pt, const string & _path) {" << endl;
-	out << "\tconst string _prefix = _path.empty() ? \"\" : _path+\".\";" << endl;
-	BOOST_FOREACH(const Field & f, t.fields) {
-		if (f.isOptionnal) {
-			const string path = (f.isAttr) ? "<xmlattr>." : "";
-			out << "\tput(  _type." << f.name << ", _pt, _prefix+\"" << path << f.nodeName << "\" );" << endl;
-		} else if (f.isAttr) {
-			out << "\tput(  _type." << f.name << ", _pt, _prefix+\"<xmlattr>."  << f.nodeName << "\" );" << endl;
-		} else if (f.size < 0) {
-			out << "\tBOOST_FOREACH(const " << cppType(f, true) << "::value_type & _tmp, _type." << f.name << ") {" << endl;
-			out << "\t\tptree & _rPt = _pt.add(_prefix+\"" << f.nodeName << "\", \"\");" << endl;
-			out << "\t\tput(_tmp, _rPt, \"\");" << endl;
-			out << "\t}" << endl;
-		} else if (f.size > 1) {
-			out << "\tfor (size_t _i = 0; _i < " << f.size << "; _i++) {" << endl;
-			out << "\t\tput(_type." << f.name << "[_i], _pt, _prefix+\"" << f.nodeName << "\" );" << endl;
+	BOOST_FOREACH(const Field * f, fields) {
+		if (!f->isOptionnal && f->size == 1) {
+			out << "\tif (" << (masked ? "_m.has(_m.F_" + f->name + ") && " : "") << "!_has_" << f->name << ") {" << endl;
+			out << "\t\t_r.missing(\"" << (f->isAttr ? "<xmlattr>." : "") << f->nodeName << "\");" << endl;
 			out << "\t}" << endl;
-		} else {
-			out << "\tput(  _type." << f.name << ", _pt, _prefix+\""  << f.nodeName << "\" );" << endl;
 		}
 	}
-	if (!t.pChildTypes.empty()) {
-		BOOST_FOREACH(Type * vt, t.pChildTypes) {
-			BOOST_FOREACH(Type * cvt, vt->pChildTypes) {
-				const string cvtType = cppType(*cvt);
-				const string cvarName = "sub_" + cvt->name;
-				out << "\tconst " << cvtType << " * " << cvarName << " = _type.as_" << cvt->name << "();" << endl;
-				out << "\tif (" << cvarName << ") {" << endl;
-				out << "\t\tput( \"" << cvt->name << "\", _pt, _prefix+\"<xmlattr>.xsi:type\");" << endl;
-				out << "\t\tput(*" << cvarName << ", _pt, _path);" << endl;
-				out << "\t\treturn;" << endl;
-				out << "\t}" << endl;
+	if (mode == PULL_PARALLEL) {
+		out << "\tcppxb::Parallel _p(_r, _threads);" << endl;
+		BOOST_FOREACH(const Field * f, elts) {
+			if (f->size < 0 && !usesColumns(*f)) {
+				out << "\t_p.parse(_type." << f->name << ", _e_" << f->name
+				    << ", [](cppxb::Reader & _r, auto & _item) { parse(_r, _item); });" << endl;
 			}
-			const string vtType = cppType(*vt);
-			const string varName = "sub_" + vt->name;
-			out << "\tconst " << vtType << " * " << varName << " = _type.as_" << vt->name << "();" << endl;
-			out << "\tif (" << varName << ") {" << endl;
-			out << "\t\tput( \"" << vt->name << "\", _pt, _prefix+\"<xmlattr>.xsi:type\");" << endl;
-			out << "\t\tput(*" << varName << ", _pt, _path);" << endl;
-			out << "\t\treturn;" << endl;
-			out << "\t}" << endl;
 		}
 	}
-	out << "}" << endl;
-
-	if (!t.pChildTypes.empty()) {
-		out << "void parse(const ptree & _pt, boost::shared_ptr<" << t.name << "> & _t) {" << endl;
-		out << "\tconst string _baseType = _pt.get<string>(\"<xmlattr>.xsi:type\", \"\");" << endl;
-		BOOST_FOREACH(Type * vt, t.pChildTypes) {
-			out << "\tif (_baseType == \"" << vt->name << "\") {" << endl;
-			const string vtType = cppType(*vt);
-			out << "\t\t_t.reset((" << t.name << "*)new " << vtType << "());" << endl;
-			//out << "\t\tparse(_pt, *_t.get());" << endl;
-			out << "\t\tparse(_pt, (" << vtType << "&)*_t.get());" << endl;
-			out << "\t\treturn;" << endl;
-			out << "\t}" << endl;
+	if (tracked) {
+		out << "\t_type._parsed(std::string_view(_r.document() + _at, _r.offset() - _at));" << endl;
+		//the items handed to a visitor are in the source, not in the value
+		BOOST_FOREACH(const Field * f, elts) {
+			if (isStreamed(*f)) {
+				out << "\tif (_v_" << f->name << ") {" << endl;
+				out << "\t\t_type._touch(" << cppType(t) << "::mask::F_" << f->name << ");" << endl;
+				out << "\t}" << endl;
+			}
 		}
-		out << "}" << endl;
 	}
 }
 
@@ -322,6 +2494,33 @@ void Gen::genHeader(const string & outDir, const string & fileName, const InterR
 	}
 	set<string> depends;
 	depends.insert("<string>");
+	depends.insert("<string_view>");
+	if (options.stringViews) {
+		depends.insert("\"cppXbString.h\"");
+	}
+	if (options.allocators) {
+		depends.insert("\"cppXbArena.h\"");
+	}
+	if (options.snapshots) {
+		depends.insert("\"cppXbSnapshot.h\"");
+		depends.insert("<cstdint>");
+	}
+	if (options.lazyTypes) {
+		depends.insert("\"cppXbLazy.h\"");
+		depends.insert("<vector>");
+	}
+	if (options.dirtyTracking) {
+		depends.insert("\"cppXbDirty.h\"");
+	}
+	if (options.statistics) {
+		depends.insert("\"cppXbStats.h\"");
+	}
+	if (hasColumnar(rep.types)) {
+		depends.insert("\"cppXbColumns.h\"");
+	}
+	if (options.pullParser) {
+		depends.insert("<bitset>");
+	}
 	depends.insert("<boost/array.hpp>");
 	BOOST_FOREACH(const Type & t, rep.types) {
 		//if (hasString(t)) {
@@ -336,12 +2535,16 @@ void Gen::genHeader(const string & outDir, const string & fileName, const InterR
 		if (hasOptional(t)) {
 			depends.insert("<boost/optional.hpp>");
 		}
+		if (isPolymorphic(t)) {
+			depends.insert("<boost/shared_ptr.hpp>");
+		}
 	}
 	BOOST_FOREACH(const string & dep, depends) {
 		out << "#include " << dep << endl;
 	}
 	out << "#include <functional>" << endl;
 	out << endl;
+	out << "namespace cppxb { class Writer; class BinaryWriter; class BinaryReader; class Diff; class Patch; struct Edit; }" << endl;
 	out << "namespace " << ns << " {" << endl;
 	out << "using namespace std;" << endl;
 	out << endl;
@@ -360,18 +2563,54 @@ void Gen::genHeader(const string & outDir, const string & fileName, const InterR
 		printType(t, out);
 	}
 	out << endl;
+	if (options.snapshots) {
+		out << "namespace view {" << endl;
+		BOOST_FOREACH(const Type & t, rep.types) {
+			printSnapshotView(t, out);
+			out << endl;
+		}
+		out << "}" << endl;
+	}
+	if (options.lazyTypes) {
+		out << "namespace lazy {" << endl;
+		BOOST_FOREACH(const Type & t, rep.types) {
+			printLazyType(t, out, ns);
+			out << endl;
+		}
+		out << "}" << endl;
+	}
 	BOOST_FOREACH(const Enum & e, rep.enums) {
-		out << e.name << " str2" << e.name << "(const string & str);" << endl;
+		out << e.name << " str2" << e.name << "(std::string_view str);" << endl;
 		out << "string " << e.name << "2str(const " << e.name << " &);" << endl;
+		out << "void writeValue(cppxb::Writer &, const " << e.name << " &);" << endl;
+		out << "void encodeValue(cppxb::BinaryWriter &, const " << e.name << " &);" << endl;
+		out << "void decodeValue(cppxb::BinaryReader &, " << e.name << " &);" << endl;
 	}
+	printEqualityDecl(rep.types, out);
 	out << "}" << endl;
 	out << "namespace boost { namespace property_tree { template<class Key,class Data,class KeyCompare>class basic_ptree; typedef basic_ptree<std::string,std::string,std::less<std::string> > ptree; } }"
 	    << endl;
+	if (options.pullParser) {
+		out << "namespace cppxb { class Reader; class Batch; class Validation; template<typename T> struct Parsed; }" << endl;
+	}
 	out << "namespace " << ns << " {" << endl;
 	out << "namespace parser {" << endl;
 	BOOST_FOREACH(const Type & t, rep.types) {
 		printTypeParse(t, out);
 	}
+	if (options.pullParser) {
+		printPullParse(rep.types, out);
+		printBatchParse(rep.types, out);
+		printValidate(rep.types, out);
+	}
+	if (options.allocators) {
+		printArenaParse(rep.types, out);
+	}
+	if (options.snapshots) {
+		BOOST_FOREACH(const Type & t, rep.types) {
+			printSnapshotParse(t, out);
+		}
+	}
 	out << "}" << endl;
 	out << "}" << endl;
 }
@@ -389,6 +2628,16 @@ void Gen::genSource(const string & outDir, const string & fileName, const InterR
 	out << "#include <boost/foreach.hpp>" << endl;
 	out << "#include <boost/optional.hpp>" << endl;
 	out << "#include <boost/shared_ptr.hpp>" << endl;
+	out << "#include <boost/make_shared.hpp>" << endl;
+	out << "#include \"cppXbConvert.h\"" << endl;
+	out << "#include \"cppXbWriter.h\"" << endl;
+	out << "#include \"cppXbBinary.h\"" << endl;
+	out << "#include \"cppXbPatch.h\"" << endl;
+	if (options.pullParser) {
+		out << "#include \"cppXbReader.h\"" << endl;
+		out << "#include \"cppXbParallel.h\"" << endl;
+		out << "#include \"cppXbValidate.h\"" << endl;
+	}
 	set<string> depends;
 	getDepends(rep.types, depends);
 	BOOST_FOREACH(const string & dep, depends) {
@@ -398,72 +2647,79 @@ void Gen::genSource(const string & outDir, const string & fileName, const InterR
 	out << "using namespace std;" << endl;
 	out << "using boost::property_tree::ptree;" << endl;
 	out << "namespace " << ns << " {" << endl;
-	set<Type *> virtualTypes;
 	BOOST_FOREACH(const Type & t, rep.types) {
 		const string tType = cppType(t);
-		BOOST_FOREACH(Type * ct, t.pChildTypes) {
-			virtualTypes.insert(ct);
-			BOOST_FOREACH(Type * cct, ct->pChildTypes) {
-				virtualTypes.insert(cct);
-				const string cctType = cppType(*cct);
-				out << cctType << " * " << tType << "::as_" << cct->name << "() { return dynamic_cast<" << cctType << "*>(this); }" <<
-				    endl;
-				out << "const " << cctType << " * " << tType << "::as_" << cct->name << "() const { return dynamic_cast<const " <<
-				    cctType << "*>(this); }" << endl;
-			}
+		vector<Type *> childTypes;
+		getAllChildTypes(t, childTypes);
+		//the tags of ct and of its derived types are [TYPE_TAG, TYPE_TAG_END), one unsigned compare checks both bounds
+		BOOST_FOREACH(Type * ct, childTypes) {
 			const string ctType = cppType(*ct);
-			out << ctType << " * " << tType << "::as_" << ct->name << "() { return dynamic_cast<" << ctType << "*>(this); }" <<
-			    endl;
-			out << "const " << ctType << " * " << tType << "::as_" << ct->name << "() const { return dynamic_cast<const " << ctType
-			    << "*>(this); }" << endl;
+			const string test = "typeTag() - " + ctType + "::TYPE_TAG < " + ctType + "::TYPE_TAG_END - " + ctType + "::TYPE_TAG";
+			out << ctType << " * " << tType << "::as_" << ct->name << "() { return " << test << " ? static_cast<" << ctType
+			    << "*>(this) : 0; }" << endl;
+			out << "const " << ctType << " * " << tType << "::as_" << ct->name << "() const { return " << test
+			    << " ? static_cast<const " << ctType << "*>(this) : 0; }" << endl;
+			if (options.snapshots) {
+				out << "view::" << ctType << " view::" << tType << "::as_" << ct->name << "() const { return " << test << " ? view::"
+				    << ctType << "(_base, _at) : view::" << ctType << "(); }" << endl;
+			}
 		}
 	}
-	if (!rep.enums.empty()) {
-		out << "template<size_t N> size_t findEnumVal(const string(& values)[N], const string & str) { size_t t = distance(values, find(values, values + N, str));	if (t >= N) throw domain_error(\"Invalid Enum Val \" + str); return t; }"
-		    << endl;
-	}
 	BOOST_FOREACH(const Enum & e, rep.enums) {
-		out << "static const string " << e.name << "strVals[] = {" << endl;
-		BOOST_FOREACH(const string & val, e.values) {
-			out << "\t\"" << val << "\"," << endl;
-		}
-		out << "};" << endl;
-		out << e.name << " str2" << e.name << "(const string & str) {" << endl;
-		out << "\treturn (" << e.name << ")findEnumVal(" << e.name << "strVals, str);" << endl;
+		printEnumSrc(e, out);
+	}
+	printEqualitySrc(rep.types, out);
+	out << "namespace parser {" << endl;
+	printNameHashSrc(out);
+	printValueParseSrc(out);
+	printValuePutSrc(out);
+	out << "using cppxb::encodeValue;" << endl;
+	out << "using cppxb::decodeValue;" << endl;
+	printDiffTemplates(out);
+	if (options.stringViews) {
+		out << "inline void parse(const ptree & pt, cppxb::xstring & t) {" << endl;
+		out << "\tt = cppxb::xstring(pt.data());" << endl;
 		out << "}" << endl;
-		out << "string " << e.name << "2str(const " << e.name << " & v) {" << endl;
-		out << "\treturn " << e.name << "strVals[(unsigned int)v];" << endl;
+	} else if (options.allocators) {
+		out << "inline void parse(const ptree & pt, std::pmr::string & t) {" << endl;
+		out << "\tt.assign(pt.data());" << endl;
 		out << "}" << endl;
 	}
-	out << "namespace parser {" << endl;
-	out << "template<typename T>" << endl;
-	out << "void parse(const ptree & pt, T & t) {" << endl;
-	out << "\tt = pt.get_value<T>();" << endl;
-	out << "}" << endl;
-	out << "template<typename T>" << endl;
-	out << "void put(const T & t, ptree & pt, const string & path) {" << endl;
-	out << "\tpt.put(path, t);" << endl;
-	out << "}" << endl;
 	BOOST_FOREACH(const Enum & e, rep.enums) {
 		out << "void parse(const ptree & pt, " << e.name << " & e) {" << endl;
-		out << "\te = str2" << e.name << "(pt.get_value<string>());" << endl;
+		out << "\te = str2" << e.name << "(pt.data());" << endl;
 		out << "}" << endl;
 		out << "void put(const " << e.name << " & e, ptree & pt, const string & path) {" << endl;
 		out << "\tpt.put(path, " << e.name << "2str(e));" << endl;
 		out << "}" << endl;
 	}
-	out << "template<typename T> void parse(boost::optional<const ptree &> pt, boost::optional<T> & t) {	if (pt) { T tmp; parse(pt.get(), tmp); t = tmp; } }"
-	    << endl;
-	out << "template<typename T> void parse(const ptree & pt, boost::shared_ptr<T> & t) { T * tmp = new T(); parse(pt, *tmp); t.reset(tmp); }"
-	    << endl;
-	out << "template<typename T> void put(const boost::optional<T> & t, ptree & pt, const string & path) { if (t) { put(t.get(), pt, path); } }"
+	const string optional = optionalParam("", "t");
+	if (options.allocators) {
+		out << "template<typename T> void parse(boost::optional<const ptree &> pt, " << optional << ") {	if (pt) { parse(pt.get(), cppxb::emplace(t)); } }"
+		    << endl;
+	} else {
+		out << "template<typename T> void parse(boost::optional<const ptree &> pt, " << optional << ") {	if (pt) { t.emplace(); parse(pt.get(), *t); } }"
+		    << endl;
+	}
+	out << "template<typename T> void parse(const ptree & pt, " << ptrType() << "<T> & t) { t = " << newObject("T")
+	    << "; parse(pt, *t); }" << endl;
+	out << "template<typename T> void put(" << optionalParam("const ", "t") << ", ptree & pt, const string & path) { if (t) { put(t.get(), pt, path); } }"
 	    << endl;
-	out << "template<typename T> void put(const boost::shared_ptr<T> & t, ptree & pt, const string & path) { if (t.get()) { put(*t.get(), pt, path); } }"
+	out << "template<typename T> void put(const " << ptrType() << "<T> & t, ptree & pt, const string & path) { if (t.get()) { put(*t.get(), pt, path); } }"
 	    << endl;
 	BOOST_FOREACH(const Type & t, rep.types) {
 		printTypeSrc(t, out);
 	}
+	if (options.pullParser) {
+		printPullSrc(rep, out);
+	}
+	if (options.allocators) {
+		printArenaSrc(rep.types, out);
+	}
 	out << endl;
 	out << "}" << endl;
+	if (options.lazyTypes) {
+		printLazySrc(rep.types, out);
+	}
 	out << "}" << endl;
 }
@@ -3,9 +3,45 @@
 #include <string>
 #include <vector>
 
+struct GenOptions {
+
+	bool pullParser;//also generate parsers reading directly from a cppxb::Reader
+
+	bool stringViews;//xs:string fields are cppxb::xstring views into the parsed document
+
+	bool allocators;//std::pmr containers and arena owned polymorphic children
+
+	bool snapshots;//parser::snapshot images and view classes reading them in place
+
+	bool lazyTypes;//lazy::T types whose complex elements are parsed on first access (pull parsers)
+
+	bool dirtyTracking;//types track their changed fields, unchanged values are written back verbatim (pull parsers)
+
+	bool statistics;//parse, put and writeContent count their calls, bytes, time and allocations by type
+
+	std::set<std::string> streamedFields;//"Type.field" repeated fields handed to a visitor by pull parsers
+
+	std::set<std::string> columnTypes;//types whose unbounded sequences are stored by column, as T::columns
+
+	bool pod;//flat types hold their strings, optionals and sequences inline, with fixed capacities (-f)
+
+	std::map<std::string, int> bounds;//"Type.field" capacity with pod: items of a sequence, else chars of a string
+
+	int defaultLength;//capacity with pod of the strings without xs:maxLength, 0 : none
+
+	int defaultOccurs;//capacity with pod of the unbounded sequences, 0 : none
+
+	GenOptions() : pullParser(false), stringViews(false), allocators(false), snapshots(false), lazyTypes(false), dirtyTracking(false), statistics(false),
+		pod(false), defaultLength(0), defaultOccurs(0) {}
+};
 
 class Gen {
 public:
+	explicit Gen(const GenOptions & options = GenOptions());
+	virtual ~Gen() {}
+
+	virtual void genRuntime(const std::string & outDir) const;
+
 	virtual void genHeader(const std::string & outDir,
 	                       const std::string & fileName,
 	                       const InterRep & rep,
@@ -16,16 +52,115 @@ public:
 	                       const InterRep & rep,
 	                       const std::string & ns) const;
 protected:
+	enum PullMode {
+		PULL_PARSE,
+		PULL_PARALLEL,//repeated elements are delimited, then parsed by a cppxb::Parallel
+		PULL_LAZY,//complex elements are delimited into a lazy::T, parsed on first access
+		PULL_MASK//only the fields selected by a T::mask are read, the others are skipped
+	};
+
 	virtual bool isBasicType(const std::string & type) const;
+	virtual bool isPolymorphic(const Type & t) const;
 	virtual bool hasString(const Type & t) const;
 	virtual bool hasVector(const Type & t) const;
 	virtual bool hasOptional(const Type & t) const;
 	virtual bool hasVirtual(const Type & t) const;
+	virtual bool usesAllocator(const Field & f) const;
+	virtual bool isStreamed(const Field & f) const;
+	virtual bool hasStreamed(const Type & t) const;
+	virtual bool hasRepeatedElements(const Type & t) const;
+	virtual bool isLazy(const Field & f) const;
+	virtual bool isColumnar(const Type & t) const;
+	virtual bool hasColumnar(const std::vector<Type> & types) const;
+	virtual bool usesColumns(const Field & f) const;
+	virtual bool hasMask(const Field & f) const;
+	virtual bool hasTypeTag(const Type & t) const;
+	virtual void getTypeTags(const Type & t, unsigned & tag, unsigned & tagEnd) const;
+	virtual void getAllChildTypes(const Type & t, std::vector<Type *> & types) const;
+	virtual unsigned nameHash(const std::string & name) const;
+	virtual unsigned long long fingerprint(const Type & t) const;
+	virtual void describeType(const Type & t, std::set<const Type *> & seen, std::string & desc) const;
 	virtual bool isSubType(const std::string & n, const Type & t) const;
 	virtual std::string cppType(const Type & t) const;
 	virtual std::string cppType(const Field & f, bool absolute = false) const;
+	virtual std::string ptrType() const;
+	virtual std::string newObject(const std::string & type) const;
 	virtual void getDepends(const std::vector<Type> & types, std::set<std::string> & depends) const;
+	virtual void getAllFields(const Type & t, std::vector<Field const *> & fields) const;
+	virtual std::string baseClause(const Type & t) const;
 	virtual void printType(const Type & t, std::ofstream & out, std::string indent = std::string()) const;
+	virtual void printAllocatorSupport(const Type & t, std::ofstream & out, std::string indent = std::string()) const;
+	virtual void printVisitor(const Type & t, std::ofstream & out, std::string indent = std::string()) const;
+	virtual void printMask(const Type & t, std::ofstream & out, std::string indent = std::string()) const;
+	virtual void printDirtyAccessors(const Type & t, std::ofstream & out, std::string indent = std::string()) const;
+	virtual void printColumns(const Type & t, std::ofstream & out, std::string indent = std::string()) const;
+	virtual size_t snapshotSlot(const Field & f, std::string & slot) const;
+	virtual size_t snapshotSize(const Field & f) const;
+	virtual void printSnapshotView(const Type & t, std::ofstream & out, std::string indent = std::string()) const;
+	virtual void printSnapshotParse(const Type & t, std::ofstream & out) const;
+	virtual void printTypeSnapshotSrc(const Type & t, std::ofstream & out) const;
+	virtual void printFieldSnapshot(const Field & f,
+	                                const std::string & value,
+	                                const std::string & at,
+	                                std::ofstream & out,
+	                                const std::string & indent) const;
 	virtual void printTypeSrc(const Type & t, std::ofstream & out, const std::string & ns = std::string()) const;
 	virtual void printTypeParse(const Type & t, std::ofstream & out, std::string indent = std::string()) const;
+	virtual void printValueParseSrc(std::ofstream & out) const;
+	virtual void printValuePutSrc(std::ofstream & out) const;
+	virtual void printTypePutSrc(const Type & t, std::ofstream & out) const;
+	virtual void printTypeWriteSrc(const Type & t, std::ofstream & out) const;
+	virtual void printFieldWrite(const Field & f,
+	                             const std::string & value,
+	                             std::ofstream & out,
+	                             const std::string & indent) const;
+	virtual void printTypeBinarySrc(const Type & t, std::ofstream & out) const;
+	virtual void printFieldEncode(const Field & f,
+	                              const std::string & value,
+	                              std::ofstream & out,
+	                              const std::string & indent) const;
+	virtual void printFieldDecode(const Field & f,
+	                              const std::string & value,
+	                              std::ofstream & out,
+	                              const std::string & indent) const;
+	virtual void printEqualityDecl(const std::vector<Type> & types, std::ofstream & out) const;
+	virtual void printEqualitySrc(const std::vector<Type> & types, std::ofstream & out) const;
+	virtual void printDiffTemplates(std::ofstream & out) const;
+	virtual std::string arrayParam(const std::string & qualifiers, const std::string & name) const;
+	virtual std::string optionalParam(const std::string & qualifiers, const std::string & name) const;
+	virtual std::string vectorTemplate() const;
+	virtual std::string vectorParam(const std::string & qualifiers, const std::string & name) const;
+	virtual int podCapacity(const Field & f, bool items) const;
+	virtual void printCapacityCheck(const Field & f,
+	                                const std::string & count,
+	                                const std::string & fail,
+	                                std::ofstream & out,
+	                                const std::string & indent) const;
+	virtual void printTypeDiffSrc(const Type & t, std::ofstream & out) const;
+	virtual void printColumnsParse(const Type & t, std::ofstream & out) const;
+	virtual void printTypeColumnsSrc(const Type & t, std::ofstream & out) const;
+	virtual void printColumnsPullSrc(const Type & t, std::ofstream & out) const;
+	virtual void printNameHashSrc(std::ofstream & out) const;
+	virtual void printStatsScope(const Type & t, const std::string & operation, const std::string & offset, std::ofstream & out) const;
+	virtual void printTypeParseSrc(const Type & t, std::ofstream & out) const;
+	virtual void printXsiTypeSwitch(const Type & t, std::ofstream & out, const std::string & create) const;
+	virtual void printEnumSrc(const Enum & e, std::ofstream & out) const;
+	virtual void printEnumSwitch(const Enum & e,
+	                             const std::vector<size_t> & values,
+	                             std::ofstream & out,
+	                             const std::string & indent) const;
+	virtual void printArenaParse(const std::vector<Type> & types, std::ofstream & out) const;
+	virtual void printArenaSrc(const std::vector<Type> & types, std::ofstream & out) const;
+	virtual void printPullParse(const std::vector<Type> & types, std::ofstream & out) const;
+	virtual void printBatchParse(const std::vector<Type> & types, std::ofstream & out) const;
+	virtual void printValidate(const std::vector<Type> & types, std::ofstream & out) const;
+	virtual void printPullSrc(const InterRep & rep, std::ofstream & out) const;
+	virtual void printTypePullSrc(const Type & t, std::ofstream & out) const;
+	virtual void printTypePullBody(const Type & t, std::ofstream & out, PullMode mode) const;
+	virtual std::string validateTag(const Field & f) const;
+	virtual void printTypeValidateSrc(const Type & t, std::ofstream & out) const;
+	virtual void printLazyType(const Type & t, std::ofstream & out, const std::string & ns) const;
+	virtual void printLazySrc(const std::vector<Type> & types, std::ofstream & out) const;
+
+	GenOptions options;
 };
@@ -17,6 +17,50 @@ using boost::range::push_back;
 using boost::algorithm::replace_first;
 namespace fs = boost::filesystem;
 
+GenFlat::GenFlat(const GenOptions & options) : Gen(options)
+{
+}
+
+bool GenFlat::isPolymorphic(const Type &) const
+{
+	return false;
+}
+
+bool GenFlat::hasTypeTag(const Type &) const
+{
+	return false;
+}
+
+// The columns hold vectors, pod types keep their sequences inline.
+bool GenFlat::isColumnar(const Type & t) const
+{
+	return !options.pod && Gen::isColumnar(t);
+}
+
+// Capacity of the items of a sequence, or of the chars of a string, from the
+// bounds given to cppXb then the facets of the schema.
+int GenFlat::podCapacity(const Field & f, bool items) const
+{
+	const string key = f.pParentType->fullPath + "." + f.name;
+	map<string, int>::const_iterator itB = options.bounds.find(key);
+	if (itB != options.bounds.end() && items == (f.size < 0)) {
+		return itB->second;
+	}
+	if (items) {
+		if (f.maxOccurs > 0) {
+			return f.maxOccurs;
+		} else if (options.defaultOccurs > 0) {
+			return options.defaultOccurs;
+		}
+		throw runtime_error("Field " + key + " is unbounded, -pod needs -bound " + key + " or -maxOccurs.");
+	}
+	if (f.maxLength > 0) {
+		return f.maxLength;
+	} else if (options.defaultLength > 0) {
+		return options.defaultLength;
+	}
+	throw runtime_error("String " + key + " has no xs:maxLength, -pod needs -bound " + key + " or -maxLength.");
+}
 
 string GenFlat::cppType(const Field & f, bool absolute) const
 {
@@ -24,38 +68,93 @@ string GenFlat::cppType(const Field & f, bool absolute) const
 	if (absolute && f.pType) {
 		t = Gen::cppType(*f.pType);
 	}
-	if (f.type == "string") {
-		t = "" + t;
+	if (f.type == "string" && options.stringViews) {
+		t = "cppxb::xstring";
+	} else if (f.type == "string" && options.allocators) {
+		t = "std::pmr::string";
+	} else if (f.type == "string" && options.pod) {
+		t = "cppxb::fixed_string<" + boost::lexical_cast<string>(podCapacity(f, false)) + ">";
 	}
 	if (f.isOptionnal) {
-		t = "boost::optional< " + t + " >";
+		t = (options.pod ? "cppxb::fixed_optional< " : "boost::optional< ") + t + " >";
+	} else if (usesColumns(f)) {
+		t = t + "::columns";
+	} else if (f.size < 0 && options.pod) {
+		t = "cppxb::fixed_vector< " + t + "[" + boost::lexical_cast<string>(podCapacity(f, true)) + "] >";
 	} else if (f.size < 0) {
-		t = "vector< " + t + " >";
+		t = (options.allocators ? "std::pmr::vector< " : "vector< ") + t + " >";
 	} else if (f.size > 1) {
 		t = t + "[" + boost::lexical_cast<string>(f.size) + "]";
 	}
 	return t;
 }
 
+// Pod types hold the fields of their base types, a single class of the
+// hierarchy having data members keeps them standard layout.
+string GenFlat::baseClause(const Type & t) const
+{
+	return options.pod ? "" : Gen::baseClause(t);
+}
+
+string GenFlat::arrayParam(const string & qualifiers, const string & name) const
+{
+	return qualifiers + "T (& " + name + ")[N]";
+}
+
+string GenFlat::optionalParam(const string & qualifiers, const string & name) const
+{
+	return options.pod ? qualifiers + "cppxb::fixed_optional<T> & " + name : Gen::optionalParam(qualifiers, name);
+}
+
+string GenFlat::vectorTemplate() const
+{
+	return options.pod ? "template<typename T, size_t N>" : Gen::vectorTemplate();
+}
+
+string GenFlat::vectorParam(const string & qualifiers, const string & name) const
+{
+	return options.pod ? qualifiers + "cppxb::fixed_vector<T[N]> & " + name : Gen::vectorParam(qualifiers, name);
+}
+
 void GenFlat::printType(const Type & t, ofstream & out, string indent) const
 {
-	out << indent << "struct " << t.name << (t.superType.empty() ? "" : " : public " + t.superType ) << " {" << endl;
+	out << indent << "struct " << t.name << baseClause(t) << " {" << endl;
 
 	BOOST_FOREACH(const Type & st, t.subTypes) {
 		GenFlat::printType(st, out, "\t");
 	}
 
+	vector<Field const *> fields;
+	if (options.pod) {
+		getAllFields(t, fields);
+	} else {
+		BOOST_FOREACH(const Field & f, t.fields) {
+			fields.push_back(&f);
+		}
+	}
+	//the dimension of a C array follows the field name
 	size_t maxTypeLen = 0;
-	BOOST_FOREACH(const Field & f, t.fields) {
-		maxTypeLen = max(maxTypeLen, cppType(f).length());
+	BOOST_FOREACH(const Field * f, fields) {
+		const string fType = cppType(*f);
+		maxTypeLen = max(maxTypeLen, *fType.rbegin() == ']' ? fType.find('[') : fType.length());
 	}
 
-	BOOST_FOREACH(const Field & f, t.fields) {
-		const string fType = cppType(f);
-		out << indent << "\t" << fType << string(maxTypeLen - fType.length(), ' ') << " " << f.name << ";" << endl;
+	BOOST_FOREACH(const Field * f, fields) {
+		const string fType = cppType(*f);
+		const size_t dim = *fType.rbegin() == ']' ? fType.find('[') : fType.length();
+		out << indent << "\t" << fType.substr(0, dim) << string(maxTypeLen - dim, ' ') << " " << f->name << fType.substr(dim) << ";" << endl;
 	}
+	printAllocatorSupport(t, out, indent);
+	printVisitor(t, out, indent);
+	printMask(t, out, indent);
+	printDirtyAccessors(t, out, indent);
+	printColumns(t, out, indent);
 
 	out << indent << "};" << endl;
+	if (options.pod) {
+		out << indent << "static_assert(std::is_standard_layout<" << t.name << ">::value && std::is_trivially_copyable<" << t.name
+		    << ">::value, \"" << t.name << " is not a pod\");" << endl;
+	}
 	out << indent << endl;
 }
 
@@ -64,49 +163,48 @@ void GenFlat::printTypeSrc(const Type & t, ofstream & out, const std::string & n
 	BOOST_FOREACH(const Type & st, t.subTypes) {
 		GenFlat::printTypeSrc(st, out, ns + t.name + "::");
 	}
-	out << "void parse(const ptree & _pt, " << t.fullPath << " & _type) {" << endl;
-	vector<Field const *> arrays, vectors;
-	BOOST_FOREACH(const Field & f, t.fields) {
-		if (f.isOptionnal) {
-			const string path = (f.isAttr) ? "<xmlattr>." : "";
-			out << "\tparse( _pt.get_child_optional(\"" << path << f.nodeName << "\") , _type." << f.name << ");" << endl;
-		} else if (f.isAttr) {
-			out << "\tparse( _pt.get_child(\"<xmlattr>." << f.nodeName << "\") , _type." << f.name << ");" << endl;
-		} else if (f.size < 0) {
-			vectors.push_back(&f);
-		} else if (f.size > 1) {
-			arrays.push_back(&f);
-		} else {
-			out << "\tparse( _pt.get_child(\"" << f.nodeName << "\") , _type." << f.name << ");" << endl;
-		}
-	}
-	if (!arrays.empty() || !vectors.empty()) {
-		BOOST_FOREACH(const Field * f, arrays) {
-			out << "\tsize_t " << f->name << "_index = 0;" << endl;
-		}
-		out << "\tBOOST_FOREACH(ptree::value_type const & _val, _pt.get_child(\"\")) {" << endl;
-		BOOST_FOREACH(const Field * f, arrays) {
-			const string baseT = f->type;
-			out << "\t\tif (_val.first == \"" << f->nodeName << "\") {" << endl;
-			out << "\t\t\tparse(_val.second , _type." << f->name << "[" << f->name << "_index]);" << endl;
-			out << "\t\t\t" << f->name << "_index++;" << endl;
-			out << "\t\t\tcontinue;" << endl;
-			out << "\t\t}" << endl;
-		}
-		BOOST_FOREACH(const Field * f, vectors) {
-			out << "\t\tif (_val.first == \"" << f->nodeName << "\") {" << endl;
-			out << "\t\t\t" << cppType(*f, true) << "::value_type _tmp;" << endl;
-			out << "\t\t\tparse(_val.second , _tmp);" << endl;
-			out << "\t\t\t_type." << f->name << ".push_back(_tmp);" << endl;
-			out << "\t\t\tcontinue;" << endl;
-			out << "\t\t}" << endl;
-		}
-		out << "\t}" << endl;
+	printTypeParseSrc(t, out);
+
+	printTypePutSrc(t, out);
+	printTypeWriteSrc(t, out);
+	printTypeBinarySrc(t, out);
+	printTypeDiffSrc(t, out);
+	if (options.snapshots) {
+		printTypeSnapshotSrc(t, out);
 	}
-	out << "}" << endl;
+	printTypeColumnsSrc(t, out);
+}
 
-	out << "void put(const " << t.fullPath << " & _type, ptree & _pt) {" << endl;
+// The fixed_strings are read, written and encoded as strings, a value longer
+// than the capacity being an error of the document.
+void GenFlat::printPodValues(ofstream & out) const
+{
+	out << "template<size_t N> void parse(const ptree & pt, cppxb::fixed_string<N> & t) {" << endl;
+	out << "\tif (pt.data().size() > N) {" << endl;
+	out << "\t\tthrow boost::property_tree::ptree_bad_data(\"value longer than \" + std::to_string(N) + \" chars\", pt.data());" << endl;
+	out << "\t}" << endl;
+	out << "\tt = pt.data();" << endl;
+	out << "}" << endl;
+	out << "template<size_t N> void encodeValue(cppxb::BinaryWriter & w, const cppxb::fixed_string<N> & v) {" << endl;
+	out << "\tw.bytes(v.view());" << endl;
+	out << "}" << endl;
+	out << "template<size_t N> void decodeValue(cppxb::BinaryReader & r, cppxb::fixed_string<N> & v) {" << endl;
+	out << "\tconst std::string_view s = r.bytes();" << endl;
+	out << "\tif (s.size() > N) {" << endl;
+	out << "\t\tr.invalid(\"string longer than its capacity\");" << endl;
+	out << "\t}" << endl;
+	out << "\tv = s;" << endl;
 	out << "}" << endl;
+	if (options.pullParser) {
+		out << "template<size_t N> void parseValue(cppxb::Reader & r, std::string_view v, cppxb::fixed_string<N> & t) {" << endl;
+		out << "\tstd::string & s = r.buffer();" << endl;
+		out << "\tcppxb::decode(v, s);" << endl;
+		out << "\tif (s.size() > N) {" << endl;
+		out << "\t\tr.error(\"value longer than \" + std::to_string(N) + \" chars\");" << endl;
+		out << "\t}" << endl;
+		out << "\tt = s;" << endl;
+		out << "}" << endl;
+	}
 }
 
 void GenFlat::genHeader(const std::string & outDir, const string & fileName, const InterRep & rep,
@@ -123,10 +221,39 @@ void GenFlat::genHeader(const std::string & outDir, const string & fileName, con
 		out << "#include \"" << fs::path(dep).stem().string() << ".h\"" << endl;
 	}
 	set<string> depends;
+	depends.insert("<string>");
+	depends.insert("<string_view>");
+	if (options.stringViews) {
+		depends.insert("\"cppXbString.h\"");
+	}
+	if (options.allocators) {
+		depends.insert("\"cppXbArena.h\"");
+	}
+	if (options.snapshots) {
+		depends.insert("\"cppXbSnapshot.h\"");
+		depends.insert("<cstdint>");
+	}
+	if (options.lazyTypes) {
+		depends.insert("\"cppXbLazy.h\"");
+		depends.insert("<vector>");
+	}
+	if (options.dirtyTracking) {
+		depends.insert("\"cppXbDirty.h\"");
+	}
+	if (options.statistics) {
+		depends.insert("\"cppXbStats.h\"");
+	}
+	if (options.pod) {
+		depends.insert("\"cppXbPod.h\"");
+		depends.insert("<type_traits>");
+	}
+	if (hasColumnar(rep.types)) {
+		depends.insert("\"cppXbColumns.h\"");
+	}
+	if (options.pullParser) {
+		depends.insert("<bitset>");
+	}
 	BOOST_FOREACH(const Type & t, rep.types) {
-		if (hasString(t)) {
-			depends.insert("<string>");
-		}
 		if (hasVector(t)) {
 			depends.insert("<vector>");
 		}
@@ -142,6 +269,7 @@ void GenFlat::genHeader(const std::string & outDir, const string & fileName, con
 	}
 	out << "#include <functional>" << endl;
 	out << endl;
+	out << "namespace cppxb { class Writer; class BinaryWriter; class BinaryReader; class Diff; class Patch; struct Edit; }" << endl;
 	out << "namespace " << ns << " {" << endl;
 	out << "using namespace std;" << endl;
 	out << endl;
@@ -160,18 +288,54 @@ void GenFlat::genHeader(const std::string & outDir, const string & fileName, con
 		printType(t, out);
 	}
 	out << endl;
+	if (options.snapshots) {
+		out << "namespace view {" << endl;
+		BOOST_FOREACH(const Type & t, rep.types) {
+			printSnapshotView(t, out);
+			out << endl;
+		}
+		out << "}" << endl;
+	}
+	if (options.lazyTypes) {
+		out << "namespace lazy {" << endl;
+		BOOST_FOREACH(const Type & t, rep.types) {
+			printLazyType(t, out, ns);
+			out << endl;
+		}
+		out << "}" << endl;
+	}
 	BOOST_FOREACH(const Enum & e, rep.enums) {
-		out << e.name << " str2" << e.name << "(const string & str);" << endl;
+		out << e.name << " str2" << e.name << "(std::string_view str);" << endl;
 		out << "string " << e.name << "2str(const " << e.name << " &);" << endl;
+		out << "void writeValue(cppxb::Writer &, const " << e.name << " &);" << endl;
+		out << "void encodeValue(cppxb::BinaryWriter &, const " << e.name << " &);" << endl;
+		out << "void decodeValue(cppxb::BinaryReader &, " << e.name << " &);" << endl;
 	}
+	printEqualityDecl(rep.types, out);
 	out << "}" << endl;
 	out << "namespace boost { namespace property_tree { template<class Key,class Data,class KeyCompare>class basic_ptree; typedef basic_ptree<std::string,std::string,std::less<std::string> > ptree; } }"
 	    << endl;
+	if (options.pullParser) {
+		out << "namespace cppxb { class Reader; class Batch; class Validation; template<typename T> struct Parsed; }" << endl;
+	}
 	out << "namespace " << ns << " {" << endl;
 	out << "namespace parser {" << endl;
 	BOOST_FOREACH(const Type & t, rep.types) {
 		printTypeParse(t, out);
 	}
+	if (options.pullParser) {
+		printPullParse(rep.types, out);
+		printBatchParse(rep.types, out);
+		printValidate(rep.types, out);
+	}
+	if (options.allocators) {
+		printArenaParse(rep.types, out);
+	}
+	if (options.snapshots) {
+		BOOST_FOREACH(const Type & t, rep.types) {
+			printSnapshotParse(t, out);
+		}
+	}
 	out << "}" << endl;
 	out << "}" << endl;
 }
@@ -188,43 +352,76 @@ void GenFlat::genSource(const std::string & outDir, const string & fileName, con
 	out << "#include \"" << fileName << ".h\"" << endl;
 	out << "#include <boost/property_tree/ptree.hpp>" << endl;
 	out << "#include <boost/foreach.hpp>" << endl;
+	out << "#include \"cppXbConvert.h\"" << endl;
+	out << "#include \"cppXbWriter.h\"" << endl;
+	out << "#include \"cppXbBinary.h\"" << endl;
+	out << "#include \"cppXbPatch.h\"" << endl;
+	if (options.pullParser) {
+		out << "#include \"cppXbReader.h\"" << endl;
+		out << "#include \"cppXbParallel.h\"" << endl;
+		out << "#include \"cppXbValidate.h\"" << endl;
+	}
 	out << endl;
 	out << "using namespace std;" << endl;
 	out << "using boost::property_tree::ptree;" << endl;
 	out << "namespace " << ns << " {" << endl;
-	if (!rep.enums.empty()) {
-		out << "template<size_t N> size_t findEnumVal(const string(& values)[N], const string & str) { size_t t = distance(values, find(values, values + N, str));	if (t >= N) throw domain_error(\"Invalid Enum Val \" + str); return t; }"
-		    << endl;
-	}
 	BOOST_FOREACH(const Enum & e, rep.enums) {
-		out << "static const string " << e.name << "strVals[] = {" << endl;
-		BOOST_FOREACH(const string & val, e.values) {
-			out << "\t\"" << val << "\"," << endl;
-		}
-		out << "};" << endl;
-		out << e.name << " str2" << e.name << "(const string & str) {" << endl;
-		out << "\treturn (" << e.name << ")findEnumVal(" << e.name << "strVals, str);" << endl;
+		printEnumSrc(e, out);
+	}
+	printEqualitySrc(rep.types, out);
+	out << "namespace parser {" << endl;
+	printNameHashSrc(out);
+	printValueParseSrc(out);
+	printValuePutSrc(out);
+	out << "using cppxb::encodeValue;" << endl;
+	out << "using cppxb::decodeValue;" << endl;
+	//before the templates calling them, which find them only by this lookup
+	if (options.pod) {
+		printPodValues(out);
+	}
+	printDiffTemplates(out);
+	if (options.stringViews) {
+		out << "inline void parse(const ptree & pt, cppxb::xstring & t) {" << endl;
+		out << "\tt = cppxb::xstring(pt.data());" << endl;
 		out << "}" << endl;
-		out << "string " << e.name << "2str(const " << e.name << " & v) {" << endl;
-		out << "\treturn " << e.name << "strVals[(unsigned int)v];" << endl;
+	} else if (options.allocators) {
+		out << "inline void parse(const ptree & pt, std::pmr::string & t) {" << endl;
+		out << "\tt.assign(pt.data());" << endl;
 		out << "}" << endl;
 	}
-	out << "namespace parser {" << endl;
-	out << "template<typename T>" << endl;
-	out << "void parse(const ptree & pt, T & t) {" << endl;
-	out << "\t t = pt.get_value<T>();" << endl;
-	out << "}" << endl;
 	BOOST_FOREACH(const Enum & e, rep.enums) {
 		out << "void parse(const ptree & pt, " << e.name << " & e) {" << endl;
-		out << "\te = str2" << e.name << "(pt.get_value<string>());" << endl;
+		out << "\te = str2" << e.name << "(pt.data());" << endl;
+		out << "}" << endl;
+		out << "void put(const " << e.name << " & e, ptree & pt, const string & path) {" << endl;
+		out << "\tpt.put(path, " << e.name << "2str(e));" << endl;
 		out << "}" << endl;
 	}
-	out << "template<typename T> void parse(boost::optional<const ptree &> pt, boost::optional<T> & t) {	if (pt) { T tmp; parse(pt.get(), tmp); t = tmp; } }"
+	const string optional = optionalParam("", "t");
+	if (options.allocators) {
+		out << "template<typename T> void parse(boost::optional<const ptree &> pt, " << optional << ") {	if (pt) { parse(pt.get(), cppxb::emplace(t)); } }"
+		    << endl;
+		out << "template<typename T> void parse(const ptree & pt, cppxb::arena_ptr<T> & t) { t.reset(cppxb::make<T>()); parse(pt, *t); }"
+		    << endl;
+	} else {
+		out << "template<typename T> void parse(boost::optional<const ptree &> pt, " << optional << ") {	if (pt) { t.emplace(); parse(pt.get(), *t); } }"
+		    << endl;
+	}
+	out << "template<typename T> void put(" << optionalParam("const ", "t") << ", ptree & pt, const string & path) { if (t) { put(t.get(), pt, path); } }"
 	    << endl;
 	BOOST_FOREACH(const Type & t, rep.types) {
 		printTypeSrc(t, out);
 	}
+	if (options.pullParser) {
+		printPullSrc(rep, out);
+	}
+	if (options.allocators) {
+		printArenaSrc(rep.types, out);
+	}
 	out << endl;
 	out << "}" << endl;
+	if (options.lazyTypes) {
+		printLazySrc(rep.types, out);
+	}
 	out << "}" << endl;
 }
\ No newline at end of file
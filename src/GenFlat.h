@@ -6,6 +6,8 @@
 
 class GenFlat : public Gen {
 public:
+	explicit GenFlat(const GenOptions & options = GenOptions());
+
 	virtual void genHeader(const std::string & outDir,
 	                       const std::string & fileName,
 	                       const InterRep & rep,
@@ -17,8 +19,18 @@ public:
 	                       const std::string & ns) const;
 protected:
 
+	virtual bool isPolymorphic(const Type & t) const;
+	virtual bool hasTypeTag(const Type & t) const;
+	virtual bool isColumnar(const Type & t) const;
+	virtual int podCapacity(const Field & f, bool items) const;
 	virtual std::string cppType(const Field & f, bool absolute = false) const;
+	virtual std::string baseClause(const Type & t) const;
+	virtual std::string arrayParam(const std::string & qualifiers, const std::string & name) const;
+	virtual std::string optionalParam(const std::string & qualifiers, const std::string & name) const;
+	virtual std::string vectorTemplate() const;
+	virtual std::string vectorParam(const std::string & qualifiers, const std::string & name) const;
 
 	virtual void printType(const Type & t, std::ofstream & out, std::string indent = std::string()) const;
 	virtual void printTypeSrc(const Type & t, std::ofstream & out, const std::string & ns = std::string()) const;
+	virtual void printPodValues(std::ofstream & out) const;
 };
\ No newline at end of file
@@ -25,7 +25,11 @@ struct Field {
 
 	bool isAttr;
 	int  size;// [< 0 : dynamic arrays][> 1 : fixed arrays]
+	int  minOccurs;
+	int  maxOccurs;// < 0 : unbounded
+	int  maxLength;// xs:maxLength or xs:length of a string, 0 : unbounded
 	bool isOptionnal;
+	bool isStreamed;// items are handed to a visitor instead of being stored (pull parsers)
 
 	Type * pType;
 	Type * pParentType;
@@ -55,6 +59,7 @@ struct Type {
 	Type * pParentType;//for subTypes
 	Type * pSuperType;
 	std::vector<Type *> pChildTypes; //types derivated from this
+	bool columns;//unbounded sequences of this type are stored by column (cppxb:columns="true")
 	InterRep * pInterRep;
 };
 
@@ -63,6 +68,8 @@ struct InterRep {
 	std::set<std::string> dependencies;
 	std::vector<Type> types;
 	std::vector<Enum> enums;
+	std::map<std::string, std::string> elements;//top-level element name -> type name
+	std::map<std::string, Field> simpleTypes;//restricted simple types without enumeration: type and maxLength
 
 	std::map<std::string, Type *> typesByNames;
 	std::map<std::string, Enum *> enumsByName;
@@ -12,30 +12,28 @@ using namespace std;
 namespace bpt = boost::property_tree;
 namespace fs = boost::filesystem;
 using bpt::ptree;
-string xsdNS = "xs:";
-string xsdSchema, xsdAttr, xsdComplexType, xsdComplexContent, xsdSequence, xsdElement, xsdExtension, xsdEnum, xsdSimpleType, xsdRestriction, xsdInclude;
-
-void setXSDNameSpace(const std::string & ns)
+XsdNames::XsdNames(const string & ns)
+	: ns(ns),
+	  schema(ns + "schema"),
+	  attribute(ns + "attribute"),
+	  complexType(ns + "complexType"),
+	  complexContent(ns + "complexContent"),
+	  sequence(ns + "sequence"),
+	  element(ns + "element"),
+	  extension(ns + "extension"),
+	  enumeration(ns + "enumeration"),
+	  simpleType(ns + "simpleType"),
+	  restriction(ns + "restriction"),
+	  length(ns + "length"),
+	  maxLength(ns + "maxLength"),
+	  include(ns + "include")
 {
-	xsdNS = ns;
-	xsdSchema         = ns + "schema";
-	xsdAttr           = ns + "attribute";
-	xsdComplexType    = ns + "complexType";
-	xsdComplexContent = ns + "complexContent";
-	xsdSequence       = ns + "sequence";
-	xsdElement        = ns + "element";
-	xsdExtension      = ns + "extension";
-	xsdEnum           = ns + "enumeration";
-	xsdSimpleType     = ns + "simpleType";
-	xsdRestriction    = ns + "restriction";
-	xsdInclude        = ns + "include";
 }
 
-
-string parseType(const string & type)
+string parseType(const string & type, const XsdNames & xs)
 {
-	if (type.find(xsdNS) == 0) {
-		const string baseType = type.substr(3);
+	if (type.find(xs.ns) == 0) {
+		const string baseType = type.substr(xs.ns.size());
 		if (baseType == "boolean") {
 			return "bool";
 		}
@@ -50,33 +48,65 @@ string parseType(const string & type)
 	return type;
 }
 
-Field parseAttribute(const ptree & a)
+// Base type and xs:maxLength (or xs:length) of a simple type restriction, the
+// other facets being ignored.
+void parseRestriction(const ptree & r, Field & f, const XsdNames & xs)
+{
+	f.type = parseType(r.get<string>("<xmlattr>.base"), xs);
+	f.maxLength = 0;
+	BOOST_FOREACH(ptree::value_type const & facet, r) {
+		if (facet.first == xs.maxLength || facet.first == xs.length) {
+			f.maxLength = facet.second.get<int>("<xmlattr>.value");
+		}
+	}
+}
+
+// Type of an attribute or element, given by its type attribute or by an
+// anonymous simple type restriction.
+void parseFieldType(const ptree & a, Field & f, const XsdNames & xs, const string & type)
+{
+	f.maxLength = 0;
+	f.type = parseType(a.get<string>("<xmlattr>.type", type), xs);
+	if (f.type.empty()) {
+		if (boost::optional<const ptree &> r = a.get_child_optional(xs.simpleType + "." + xs.restriction)) {
+			parseRestriction(*r, f, xs);
+		}
+	}
+}
+
+Field parseAttribute(const ptree & a, const XsdNames & xs)
 {
 	Field f;
 	f.nodeName = a.get<string>("<xmlattr>.name");
 	f.name = f.nodeName;
-	f.type = parseType(a.get<string>("<xmlattr>.type"));
+	parseFieldType(a, f, xs, string());
+	if (f.type.empty()) {
+		throw runtime_error("attribute " + f.name + " has no type");
+	}
 	if (f.name == f.type) {
 		f.name = f.name + "_val";
 	}
 	f.isAttr = true;
+	f.isStreamed = false;
 	f.size = 1;
 	const string opt = a.get<string>("<xmlattr>.use", "optional");
 	f.isOptionnal = (opt == "optional");
+	f.minOccurs = f.isOptionnal ? 0 : 1;
+	f.maxOccurs = 1;
 	if (f.isOptionnal) {
 		f.defVal = a.get<string>("<xmlattr>.default", "");
 	}
 	return f;
 }
 
-Field parseElement(const ptree & a, const string & type = string())
+Field parseElement(const ptree & a, const XsdNames & xs, const string & type = string())
 {
 	const string maxOccurs = a.get<string>("<xmlattr>.maxOccurs", "1");
 	const string minOccurs = a.get<string>("<xmlattr>.minOccurs", "1");
 	Field f;
 	f.nodeName = a.get<string>("<xmlattr>.name");
 	f.name = f.nodeName;
-	f.type = parseType(a.get<string>("<xmlattr>.type", type));
+	parseFieldType(a, f, xs, type);
 	if (f.type.empty()) {
 		throw runtime_error("element " + f.name + " has no type");
 	}
@@ -85,6 +115,9 @@ Field parseElement(const ptree & a, const string & type = string())
 	}
 	f.isAttr = false;
 	f.isOptionnal = false;
+	f.isStreamed = a.get<string>("<xmlattr>.cppxb:stream", "false") == "true";
+	f.minOccurs = boost::lexical_cast<int>(minOccurs);
+	f.maxOccurs = (maxOccurs == "unbounded") ? -1 : boost::lexical_cast<int>(maxOccurs);
 	if (maxOccurs == "1" && minOccurs == "1") {
 		f.size = 1;
 	} else if (maxOccurs == minOccurs) {
@@ -98,31 +131,32 @@ Field parseElement(const ptree & a, const string & type = string())
 	return f;
 }
 
-Type parseType(const ptree & n);
-void parseContent(const ptree & node, Type & t)
+Type parseType(const ptree & n, const XsdNames & xs);
+void parseContent(const ptree & node, Type & t, const XsdNames & xs)
 {
 	BOOST_FOREACH(ptree::value_type const & att, node.get_child("")) {
-		if (att.first == xsdAttr){
-			t.fields.push_back(parseAttribute(att.second));
-		} else if (att.first == xsdComplexContent) {
+		if (att.first == xs.attribute){
+			t.fields.push_back(parseAttribute(att.second, xs));
+		} else if (att.first == xs.complexContent) {
 			BOOST_FOREACH(ptree::value_type const & ext, att.second.get_child("")) {
-				if (ext.first == xsdExtension) {
+				if (ext.first == xs.extension) {
 					t.superType = ext.second.get<string>("<xmlattr>.base");
-					parseContent(ext.second, t);
+					parseContent(ext.second, t, xs);
 				}
 			}
-		} else if (att.first == xsdSequence) {
+		} else if (att.first == xs.sequence) {
 			BOOST_FOREACH(ptree::value_type const & elt, att.second.get_child("")) {
-				if (elt.first == xsdElement) {
-					if (elt.second.size() == 1) {
-						t.fields.push_back(parseElement(elt.second));
+				if (elt.first == xs.element) {
+					if (!elt.second.get_child_optional(xs.complexType)) {
+						t.fields.push_back(parseElement(elt.second, xs));
 					} else {
-						const ptree & nSubT = elt.second.get_child(xsdComplexType);
+						const ptree & nSubT = elt.second.get_child(xs.complexType);
 						Type subT;
 						subT.name = elt.second.get<string>("<xmlattr>.name") + "_t";
-						parseContent(nSubT, subT);
+						subT.columns = false;
+						parseContent(nSubT, subT, xs);
 						t.subTypes.push_back(subT);
-						t.fields.push_back(parseElement(elt.second, subT.name));
+						t.fields.push_back(parseElement(elt.second, xs, subT.name));
 					}
 				}
 			}
@@ -130,20 +164,21 @@ void parseContent(const ptree & node, Type & t)
 	}
 }
 
-Type parseType(const ptree & n)
+Type parseType(const ptree & n, const XsdNames & xs)
 {
 	Type t;
 	t.name = n.get<string>("<xmlattr>.name");
-	parseContent(n, t);
+	t.columns = n.get<string>("<xmlattr>.cppxb:columns", "false") == "true";
+	parseContent(n, t, xs);
 	return t;
 }
 
-Enum parseEnum(const string & name, const ptree & n)
+Enum parseEnum(const string & name, const ptree & n, const XsdNames & xs)
 {
 	Enum e;
 	e.name = name;
 	BOOST_FOREACH(ptree::value_type const & val, n.get_child("")) {
-		if (val.first == xsdEnum) {
+		if (val.first == xs.enumeration) {
 			e.values.push_back(val.second.get<string>("<xmlattr>.value"));
 		}
 	}
@@ -199,21 +234,27 @@ void printType(const Type & t)
 	}
 }
 
-InterRep parseFile(const string & filePath)
+InterRep parseFile(const string & filePath, const XsdNames & xs)
 {
-	setXSDNameSpace(xsdNS);
 	InterRep rep;
 	rep.name = fs::path(filePath).stem().string();
 	ptree pt;
 	bpt::xml_parser::read_xml(filePath, pt);
 
-	BOOST_FOREACH(ptree::value_type const & n, pt.get_child(xsdSchema)) {
-		if (n.first == xsdComplexType) {
-			rep.types.push_back(parseType(n.second));
-		} else if (n.first == xsdSimpleType) {
+	BOOST_FOREACH(ptree::value_type const & n, pt.get_child(xs.schema)) {
+		if (n.first == xs.complexType) {
+			rep.types.push_back(parseType(n.second, xs));
+		} else if (n.first == xs.simpleType) {
 			const string typeName = n.second.get<string>("<xmlattr>.name");
-			rep.enums.push_back(parseEnum(typeName, n.second.get_child(xsdRestriction)));
-		} else if (n.first == xsdInclude) {
+			const ptree & restriction = n.second.get_child(xs.restriction);
+			if (restriction.count(xs.enumeration) > 0) {
+				rep.enums.push_back(parseEnum(typeName, restriction, xs));
+			} else {
+				parseRestriction(restriction, rep.simpleTypes[typeName], xs);
+			}
+		} else if (n.first == xs.element) {
+			rep.elements[n.second.get<string>("<xmlattr>.name")] = parseType(n.second.get<string>("<xmlattr>.type", ""), xs);
+		} else if (n.first == xs.include) {
 			fs::path depPath(n.second.get<string>("<xmlattr>.schemaLocation"));
 			string parentPath = depPath.parent_path().string();
 			if (!parentPath.empty()) {
@@ -281,6 +322,20 @@ void link(vector<InterRep> & reps)
 			t->pSuperType = 0;
 		}
 	}
+	//fields of a restricted simple type take its base type and length
+	map<string, Field> simpleTypes;
+	BOOST_FOREACH(InterRep & rep, reps) {
+		simpleTypes.insert(rep.simpleTypes.begin(), rep.simpleTypes.end());
+	}
+	BOOST_FOREACH(Type * t, allTypes) {
+		BOOST_FOREACH(Field & f, t->fields) {
+			map<string, Field>::const_iterator itS = simpleTypes.find(f.type);
+			if (itS != simpleTypes.end()) {
+				f.type = itS->second.type;
+				f.maxLength = f.maxLength ? f.maxLength : itS->second.maxLength;
+			}
+		}
+	}
 	BOOST_FOREACH(Type * t, allTypes) {
 		BOOST_FOREACH(Field & f, t->fields) {
 			f.pEnum = 0;
@@ -291,11 +346,16 @@ void link(vector<InterRep> & reps)
 				itT = t->pInterRep->typesByNames.find(f.type);
 				if (itT != t->pInterRep->typesByNames.end()) {
 					f.pType = itT->second;
+				} else if (allBaseTypes.find(f.type) != allBaseTypes.end()) {
+					//type from an included schema
+					f.pType = allBaseTypes[f.type];
 				} else {
 					f.pType = 0;
 					map<string, Enum *>::iterator itE = t->pInterRep->enumsByName.find(f.type);
 					if (itE != t->pInterRep->enumsByName.end()) {
 						f.pEnum = itE->second;
+					} else if (allEnums.find(f.type) != allEnums.end()) {
+						f.pEnum = allEnums[f.type];
 					}
 				}
 			}
@@ -4,9 +4,17 @@
 #include <vector>
 #include "InterRep.h"
 
-void setXSDNameSpace(const std::string &);
+// Names of the xsd elements, ns being the prefix of the XML Schema namespace.
+struct XsdNames {
+	std::string ns;
+	std::string schema, attribute, complexType, complexContent, sequence, element, extension, enumeration, simpleType,
+	    restriction, length, maxLength, include;
 
-InterRep parseFile(const std::string & filePath);
+	explicit XsdNames(const std::string & ns = "xs:");
+};
+
+// Only reads its parameters, files can be parsed by several threads at once.
+InterRep parseFile(const std::string & filePath, const XsdNames & xs = XsdNames());
 
 void link(std::vector<InterRep> & reps);
 
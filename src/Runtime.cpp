@@ -0,0 +1,17 @@
+#include "Runtime.h"
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+void genRuntimeFile(const string & outDir, const string & fileName, const char * content)
+{
+	const string filePath = outDir + "/" + fileName;
+	cout << "Writing file : " << filePath << endl;
+	ofstream out(filePath.c_str());
+	if (out.bad()) {
+		throw runtime_error("Cannot write to : " + filePath);
+	}
+	out << content;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+// Support headers copied verbatim next to the generated headers.
+extern const char * const cppXbReaderH;
+extern const char * const cppXbScanH;
+extern const char * const cppXbStringH;
+extern const char * const cppXbArenaH;
+extern const char * const cppXbConvertH;
+extern const char * const cppXbWriterH;
+extern const char * const cppXbBinaryH;
+extern const char * const cppXbPatchH;
+extern const char * const cppXbColumnsH;
+extern const char * const cppXbFileH;
+extern const char * const cppXbSnapshotH;
+extern const char * const cppXbParallelH;
+extern const char * const cppXbLazyH;
+extern const char * const cppXbDirtyH;
+extern const char * const cppXbStatsH;
+extern const char * const cppXbPodH;
+extern const char * const cppXbValidateH;
+
+void genRuntimeFile(const std::string & outDir, const std::string & fileName, const char * content);
@@ -0,0 +1,125 @@
+#include "Runtime.h"
+
+const char * const cppXbArenaH = R"cppXb(#pragma once
+// cppXb arena runtime, generated by cppXb.
+//
+// In allocator mode (-pmr) every generated type is allocator aware: it takes
+// a cppxb::allocator_type and hands it to the strings, vectors and child
+// objects it holds. The parse overloads taking a std::pmr::memory_resource
+// allocate the whole object graph from that resource. With a
+// std::pmr::monotonic_buffer_resource the document is then released at once
+// by releasing the resource; arena_ptr never deletes, so the objects of the
+// graph must not be used past that point.
+#define CPPXB_ARENA 1
+
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <boost/optional.hpp>
+
+namespace cppxb {
+
+typedef std::pmr::polymorphic_allocator<char> allocator_type;
+
+inline std::pmr::memory_resource *& currentResourceSlot()
+{
+	thread_local std::pmr::memory_resource * resource = 0;
+	return resource;
+}
+
+// Resource used by the generated parsers for polymorphic children and
+// optional values, the default resource outside of an ArenaScope.
+inline std::pmr::memory_resource * currentResource()
+{
+	std::pmr::memory_resource * resource = currentResourceSlot();
+	return resource ? resource : std::pmr::get_default_resource();
+}
+
+// Makes arena the current resource of the calling thread while alive.
+class ArenaScope {
+public:
+	explicit ArenaScope(std::pmr::memory_resource & arena) : _previous(currentResourceSlot())
+	{
+		currentResourceSlot() = &arena;
+	}
+
+	~ArenaScope()
+	{
+		currentResourceSlot() = _previous;
+	}
+
+private:
+	ArenaScope(const ArenaScope &);
+	ArenaScope & operator=(const ArenaScope &);
+
+	std::pmr::memory_resource * _previous;
+};
+
+// Non-owning pointer to an object allocated from an arena.
+template<typename T>
+class arena_ptr {
+public:
+	arena_ptr() : _p(0) {}
+
+	explicit arena_ptr(T * p) : _p(p) {}
+
+	template<typename U>
+	arena_ptr(const arena_ptr<U> & other) : _p(other.get()) {}
+
+	T * get() const
+	{
+		return _p;
+	}
+
+	T & operator*() const
+	{
+		return *_p;
+	}
+
+	T * operator->() const
+	{
+		return _p;
+	}
+
+	explicit operator bool() const
+	{
+		return _p != 0;
+	}
+
+	void reset(T * p = 0)
+	{
+		_p = p;
+	}
+
+private:
+	T * _p;
+};
+
+// Allocates a T from the current resource, giving it the matching allocator
+// when T is allocator aware.
+template<typename T>
+T * make()
+{
+	std::pmr::memory_resource * resource = currentResource();
+	void * p = resource->allocate(sizeof(T), alignof(T));
+	if constexpr (std::uses_allocator<T, allocator_type>::value) {
+		return new (p) T(allocator_type(resource));
+	} else {
+		return new (p) T();
+	}
+}
+
+// Constructs the value of t in place with the current resource.
+template<typename T>
+T & emplace(boost::optional<T> & t)
+{
+	if constexpr (std::uses_allocator<T, allocator_type>::value) {
+		t.emplace(allocator_type(currentResource()));
+	} else {
+		t.emplace();
+	}
+	return *t;
+}
+
+}
+)cppXb";
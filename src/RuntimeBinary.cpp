@@ -0,0 +1,284 @@
+#include "Runtime.h"
+
+const char * const cppXbBinaryH = R"cppXb(#pragma once
+// cppXb binary runtime, generated by cppXb.
+//
+// Compact encoding of the generated types, used by parser::encode and
+// parser::decode:
+// - integers are varints (zigzag for signed types), booleans one byte,
+//   xs:double and xs:float their little endian IEEE 754 representation,
+// - strings are a varint length followed by the decoded characters,
+// - the optional fields of a value are announced by presence bits written
+//   before its fields, repeated fields by a varint count,
+// - polymorphic values start with the TYPE_TAG of their dynamic type plus
+//   one, 0 standing for a null pointer.
+// An encoded document starts with a magic number and the fingerprint of the
+// schema of its root type; decoding data written from a different schema is
+// rejected. Decoded xstring values point into the decoded data, which must
+// then outlive them.
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include "cppXbString.h"
+
+namespace cppxb {
+
+class BinaryWriter {
+public:
+	explicit BinaryWriter(std::string & out) : _out(out) {}
+
+	void header(unsigned long long fingerprint)
+	{
+		_out.append(magic, sizeof(magic));
+		fixed(fingerprint);
+	}
+
+	void byte(unsigned char v)
+	{
+		_out += (char)v;
+	}
+
+	void varint(unsigned long long v)
+	{
+		while (v >= 0x80) {
+			_out += (char)(v | 0x80);
+			v >>= 7;
+		}
+		_out += (char)v;
+	}
+
+	void svarint(long long v)
+	{
+		varint(((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63));
+	}
+
+	void bytes(std::string_view v)
+	{
+		varint(v.size());
+		_out.append(v.data(), v.size());
+	}
+
+	void raw(const unsigned char * p, size_t n)
+	{
+		_out.append((const char *)p, n);
+	}
+
+	// Little endian copy of the bits of v.
+	template<typename T>
+	void fixed(T v)
+	{
+		typedef typename std::conditional<sizeof(T) == 8, unsigned long long, unsigned int>::type bits_type;
+		static_assert(sizeof(T) == sizeof(bits_type), "unsupported fixed size type");
+		bits_type bits;
+		std::memcpy(&bits, &v, sizeof(T));
+		for (size_t i = 0; i < sizeof(T); i++) {
+			_out += (char)(bits >> (8 * i));
+		}
+	}
+
+	// Scratch string for values which have to be converted before being written.
+	std::string & scratch()
+	{
+		return _scratch;
+	}
+
+	static constexpr char magic[4] = { 'c', 'X', 'b', '\1' };
+
+private:
+	BinaryWriter(const BinaryWriter &);
+	BinaryWriter & operator=(const BinaryWriter &);
+
+	std::string & _out;
+	std::string _scratch;
+};
+
+class BinaryReader {
+public:
+	explicit BinaryReader(std::string_view data) : _p(data.data()), _end(data.data() + data.size()) {}
+
+	void header(unsigned long long fingerprint)
+	{
+		if (std::string_view(raw(sizeof(BinaryWriter::magic)), sizeof(BinaryWriter::magic))
+		    != std::string_view(BinaryWriter::magic, sizeof(BinaryWriter::magic))) {
+			invalid("not a cppXb binary document");
+		}
+		if (fixed<unsigned long long>() != fingerprint) {
+			invalid("schema fingerprint mismatch");
+		}
+	}
+
+	unsigned char byte()
+	{
+		return *(const unsigned char *)raw(1);
+	}
+
+	unsigned long long varint()
+	{
+		unsigned long long v = 0;
+		for (unsigned shift = 0; shift < 64; shift += 7) {
+			const unsigned char c = byte();
+			v |= (unsigned long long)(c & 0x7f) << shift;
+			if (!(c & 0x80)) {
+				return v;
+			}
+		}
+		invalid("varint too long");
+	}
+
+	long long svarint()
+	{
+		const unsigned long long v = varint();
+		return (long long)(v >> 1) ^ -(long long)(v & 1);
+	}
+
+	std::string_view bytes()
+	{
+		const unsigned long long n = varint();
+		if (n > (unsigned long long)(_end - _p)) {
+			invalid("truncated data");
+		}
+		return std::string_view(raw(n), n);
+	}
+
+	// Item count of a repeated field.
+	size_t count()
+	{
+		const unsigned long long n = varint();
+		if (n > std::numeric_limits<size_t>::max() / 2) {
+			invalid("invalid count");
+		}
+		return n;
+	}
+
+	const char * raw(size_t n)
+	{
+		if (n > (size_t)(_end - _p)) {
+			invalid("truncated data");
+		}
+		const char * p = _p;
+		_p += n;
+		return p;
+	}
+
+	template<typename T>
+	T fixed()
+	{
+		typedef typename std::conditional<sizeof(T) == 8, unsigned long long, unsigned int>::type bits_type;
+		const unsigned char * p = (const unsigned char *)raw(sizeof(T));
+		bits_type bits = 0;
+		for (size_t i = 0; i < sizeof(T); i++) {
+			bits |= (bits_type)p[i] << (8 * i);
+		}
+		T v;
+		std::memcpy(&v, &bits, sizeof(T));
+		return v;
+	}
+
+	size_t remaining() const
+	{
+		return _end - _p;
+	}
+
+	bool atEnd() const
+	{
+		return _p == _end;
+	}
+
+	[[noreturn]] void invalid(const char * what) const
+	{
+		throw std::runtime_error(std::string("cppxb::BinaryReader: ") + what);
+	}
+
+private:
+	const char * _p;
+	const char * _end;
+};
+
+inline void encodeValue(BinaryWriter & w, bool v)
+{
+	w.byte(v ? 1 : 0);
+}
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type encodeValue(BinaryWriter & w, T v)
+{
+	if (std::is_signed<T>::value) {
+		w.svarint(v);
+	} else {
+		w.varint(v);
+	}
+}
+
+template<typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type encodeValue(BinaryWriter & w, T v)
+{
+	w.fixed(v);
+}
+
+template<typename A>
+void encodeValue(BinaryWriter & w, const std::basic_string<char, std::char_traits<char>, A> & v)
+{
+	w.bytes(std::string_view(v.data(), v.size()));
+}
+
+inline void encodeValue(BinaryWriter & w, const xstring & v)
+{
+	if (!v.escaped()) {
+		w.bytes(v.raw());
+	} else {
+		v.str(w.scratch());
+		w.bytes(w.scratch());
+	}
+}
+
+inline void decodeValue(BinaryReader & r, bool & v)
+{
+	const unsigned char c = r.byte();
+	if (c > 1) {
+		r.invalid("invalid boolean");
+	}
+	v = c != 0;
+}
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type decodeValue(BinaryReader & r, T & v)
+{
+	if (std::is_signed<T>::value) {
+		const long long s = r.svarint();
+		if (s < (long long)std::numeric_limits<T>::min() || s > (long long)std::numeric_limits<T>::max()) {
+			r.invalid("integer out of range");
+		}
+		v = (T)s;
+	} else {
+		const unsigned long long u = r.varint();
+		if (u > (unsigned long long)std::numeric_limits<T>::max()) {
+			r.invalid("integer out of range");
+		}
+		v = (T)u;
+	}
+}
+
+template<typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type decodeValue(BinaryReader & r, T & v)
+{
+	v = r.fixed<T>();
+}
+
+template<typename A>
+void decodeValue(BinaryReader & r, std::basic_string<char, std::char_traits<char>, A> & v)
+{
+	const std::string_view s = r.bytes();
+	v.assign(s.data(), s.size());
+}
+
+inline void decodeValue(BinaryReader & r, xstring & v)
+{
+	v = xstring(r.bytes());
+}
+
+}
+)cppXb";
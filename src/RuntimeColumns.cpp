@@ -0,0 +1,71 @@
+#include "Runtime.h"
+
+const char * const cppXbColumnsH = R"cppXb(#pragma once
+// cppXb columns runtime, generated by cppXb.
+//
+// An unbounded sequence of a type marked columnar (-columns T or
+// cppxb:columns="true") is a T::columns rather than a vector of T: one
+// contiguous vector per field, plus a vector<bool> presence bitmap per
+// optional field, so that a loop over one field reads it alone. The items
+// are reached as T::columns::row proxies, whose members are references to
+// the fields of the item, and const_row for reading; row = value and
+// row.value() convert from and to T. The pull parsers fill the columns
+// directly, the other functions go through a T per item.
+//
+// The value of an optional field whose presence bit is clear is
+// unspecified.
+#include <cstddef>
+#include <iterator>
+
+#define CPPXB_COLUMNS 1
+
+namespace cppxb {
+
+// Iterator over the rows of the columns C, Row being its row or const_row.
+template<typename C, typename Row>
+class RowIterator {
+public:
+	typedef std::input_iterator_tag iterator_category;
+	typedef typename C::value_type value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef void pointer;
+	typedef Row reference;
+
+	RowIterator() : _c(0), _i(0) {}
+	RowIterator(C * c, size_t i) : _c(c), _i(i) {}
+
+	Row operator*() const
+	{
+		return (*_c)[_i];
+	}
+
+	RowIterator & operator++()
+	{
+		_i++;
+		return *this;
+	}
+
+	RowIterator operator++(int)
+	{
+		RowIterator it(*this);
+		_i++;
+		return it;
+	}
+
+	bool operator==(const RowIterator & o) const
+	{
+		return _i == o._i;
+	}
+
+	bool operator!=(const RowIterator & o) const
+	{
+		return _i != o._i;
+	}
+
+private:
+	C * _c;
+	size_t _i;
+};
+
+}
+)cppXb";
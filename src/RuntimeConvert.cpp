@@ -0,0 +1,106 @@
+#include "Runtime.h"
+
+const char * const cppXbConvertH = R"cppXb(#pragma once
+// cppXb conversion runtime, generated by cppXb.
+//
+// Locale independent conversions of attribute and element values to the
+// numeric and boolean field types, following the XSD lexical spaces:
+// - xs:boolean is one of true, false, 1 or 0,
+// - integers are an optional sign followed by digits and must fit the field
+//   type (xs:byte, xs:int, xs:long...),
+// - xs:double and xs:float are decimal or scientific numbers, INF, +INF, -INF
+//   or NaN; hexadecimal forms and inf/nan spellings are rejected, and so are
+//   finite values out of the range of the field type.
+// Leading and trailing white space is ignored (whiteSpace="collapse"). The
+// functions return false when the value is not in the lexical space.
+#include <charconv>
+#include <limits>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+namespace cppxb {
+
+inline bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+inline std::string_view trim(std::string_view v)
+{
+	while (!v.empty() && isSpace(v.front())) {
+		v.remove_prefix(1);
+	}
+	while (!v.empty() && isSpace(v.back())) {
+		v.remove_suffix(1);
+	}
+	return v;
+}
+
+inline bool convert(std::string_view v, bool & t)
+{
+	v = trim(v);
+	if (v == "true" || v == "1") {
+		t = true;
+	} else if (v == "false" || v == "0") {
+		t = false;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value, bool>::type convert(std::string_view v, T & t)
+{
+	v = trim(v);
+	if (v.size() > 1 && v.front() == '+' && v[1] != '-') {
+		v.remove_prefix(1);
+	}
+	if (v.empty()) {
+		return false;
+	}
+	T value;
+	const std::from_chars_result r = std::from_chars(v.data(), v.data() + v.size(), value);
+	if (r.ec != std::errc() || r.ptr != v.data() + v.size()) {
+		return false;
+	}
+	t = value;
+	return true;
+}
+
+template<typename T>
+typename std::enable_if<std::is_floating_point<T>::value, bool>::type convert(std::string_view v, T & t)
+{
+	v = trim(v);
+	if (v == "NaN") {
+		t = std::numeric_limits<T>::quiet_NaN();
+		return true;
+	}
+	if (v == "INF" || v == "+INF") {
+		t = std::numeric_limits<T>::infinity();
+		return true;
+	}
+	if (v == "-INF") {
+		t = -std::numeric_limits<T>::infinity();
+		return true;
+	}
+	if (v.size() > 1 && v.front() == '+' && v[1] != '-') {
+		v.remove_prefix(1);
+	}
+	//from_chars also takes inf, infinity and nan in any case
+	const size_t first = (!v.empty() && v.front() == '-') ? 1 : 0;
+	if (v.size() <= first || !((v[first] >= '0' && v[first] <= '9') || v[first] == '.')) {
+		return false;
+	}
+	T value;
+	const std::from_chars_result r = std::from_chars(v.data(), v.data() + v.size(), value, std::chars_format::general);
+	if (r.ec != std::errc() || r.ptr != v.data() + v.size()) {
+		return false;
+	}
+	t = value;
+	return true;
+}
+
+}
+)cppXb";
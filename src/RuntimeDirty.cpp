@@ -0,0 +1,76 @@
+#include "Runtime.h"
+
+const char * const cppXbDirtyH = R"cppXb(#pragma once
+// cppXb dirty tracking runtime, generated by cppXb.
+//
+// With -dirty the generated types derive from cppxb::Tracked. The pull
+// parsers record the element each value was read from, and the setters
+// (set_x) and mutable accessors (edit_x) mark the fields they change, one bit
+// per field numbered as in T::mask. A nested value is reached through the
+// edit_ accessors of its parents, which mark their own fields on the way, so
+// a change is seen by every value above it. parser::write copies the source
+// element of a value that has not changed verbatim, and only encodes again
+// the values along the paths to the changes.
+//
+// Fields assigned directly, rather than through the accessors, are not seen:
+// call _touchAll() after changing a value that way. The parsed document must
+// outlive the values written.
+#include <string_view>
+
+#define CPPXB_DIRTY 1
+
+namespace cppxb {
+
+class Tracked {
+public:
+	Tracked() : _dirty(0) {}
+
+	// Whether the value is its source element: read by a pull parser and not
+	// changed since.
+	bool _clean() const
+	{
+		return _dirty == 0 && !_element.empty();
+	}
+
+	// Whether field, a T::mask::field, was changed since the value was parsed.
+	bool _changed(unsigned field) const
+	{
+		return (_dirty & bit(field)) != 0;
+	}
+
+	// Element the value was read from, empty when it was not read by a pull
+	// parser.
+	std::string_view _source() const
+	{
+		return _element;
+	}
+
+	void _parsed(std::string_view element)
+	{
+		_element = element;
+		_dirty = 0;
+	}
+
+	void _touch(unsigned field)
+	{
+		_dirty |= bit(field);
+	}
+
+	void _touchAll()
+	{
+		_dirty = ~0ull;
+	}
+
+private:
+	// fields past the 63rd share the last bit
+	static unsigned long long bit(unsigned field)
+	{
+		return 1ull << (field < 63 ? field : 63);
+	}
+
+	std::string_view _element;
+	unsigned long long _dirty;
+};
+
+}
+)cppXb";
@@ -0,0 +1,96 @@
+#include "Runtime.h"
+
+const char * const cppXbFileH = R"cppXb(#pragma once
+// cppXb file runtime, generated by cppXb.
+//
+// cppxb::MappedFile gives the documents read by cppxb::Reader and the
+// snapshots read by the generated views as a single block of memory.
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CPPXB_MMAP 1
+#endif
+
+namespace cppxb {
+
+// Read-only content of a whole file, memory mapped where the platform allows.
+class MappedFile {
+public:
+	explicit MappedFile(const std::string & path) : _data(0), _size(0)
+	{
+#ifdef CPPXB_MMAP
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		struct stat st;
+		if (fd < 0 || ::fstat(fd, &st) != 0) {
+			if (fd >= 0) {
+				::close(fd);
+			}
+			throw std::runtime_error("Cannot open " + path);
+		}
+		_size = st.st_size;
+		if (_size > 0) {
+			void * p = ::mmap(0, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p == MAP_FAILED) {
+				::close(fd);
+				throw std::runtime_error("Cannot map " + path);
+			}
+			_data = (const char *)p;
+		}
+		::close(fd);
+#else
+		std::ifstream in(path.c_str(), std::ios::binary);
+		if (!in) {
+			throw std::runtime_error("Cannot open " + path);
+		}
+		std::ostringstream content;
+		content << in.rdbuf();
+		_content = content.str();
+		_data = _content.data();
+		_size = _content.size();
+#endif
+	}
+
+	~MappedFile()
+	{
+#ifdef CPPXB_MMAP
+		if (_data) {
+			::munmap((void *)_data, _size);
+		}
+#endif
+	}
+
+	const char * data() const
+	{
+		return _data;
+	}
+
+	size_t size() const
+	{
+		return _size;
+	}
+
+	std::string_view view() const
+	{
+		return std::string_view(_data, _size);
+	}
+
+private:
+	MappedFile(const MappedFile &);
+	MappedFile & operator=(const MappedFile &);
+
+	const char * _data;
+	size_t _size;
+#ifndef CPPXB_MMAP
+	std::string _content;
+#endif
+};
+
+}
+)cppXb";
@@ -0,0 +1,71 @@
+#include "Runtime.h"
+
+const char * const cppXbLazyH = R"cppXb(#pragma once
+// cppXb lazy parsing runtime, generated by cppXb.
+//
+// In lazy mode (-lazy) parser::parse(cppxb::Reader &, lazy::T &) reads the
+// attributes and simple elements of T and only delimits its complex
+// elements, skipping their markup without reading it. The accessor of a
+// complex field parses the elements recorded for it the first time it is
+// called, value() parses all of them and gives the complete T.
+//
+// A lazy value points into the parsed document, which must outlive it.
+// Accessors are const but parse on first use: a lazy value must not be read
+// from several threads at once, and an invalid element makes the accessor
+// throw cppxb::parse_error, with its offset in the whole document.
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "cppXbReader.h"
+
+#define CPPXB_LAZY 1
+
+namespace cppxb {
+
+// Base of the generated lazy types.
+class Lazy {
+public:
+	Lazy() : _doc(0) {}
+
+	Lazy(Lazy &&) = default;
+	Lazy & operator=(Lazy &&) = default;
+
+	// Starts a new parse with the reader positioned on the element.
+	void _start(const Reader & r)
+	{
+		_doc = r.document();
+	}
+
+protected:
+	// Parses the elements recorded for a field once, parseItem reading the
+	// i-th one from a reader positioned on it. The elements are forgotten
+	// once all of them are parsed: when one is invalid, clear empties the
+	// field and the next call throws again.
+	template<typename F, typename C>
+	void _decode(std::vector<std::string_view> & elements, F parseItem, C clear) const
+	{
+		if (!_reader) {
+			_reader.reset(new Reader());
+		}
+		try {
+			for (size_t i = 0; i < elements.size(); i++) {
+				_reader->reset(_doc, elements[i]);
+				parseItem(*_reader, i);
+			}
+		} catch (...) {
+			clear();
+			throw;
+		}
+		std::vector<std::string_view>().swap(elements);
+	}
+
+private:
+	Lazy(const Lazy &);
+	Lazy & operator=(const Lazy &);
+
+	const char * _doc;
+	mutable std::unique_ptr<Reader> _reader;//parses the recorded elements, keeping the copies made for them
+};
+
+}
+)cppXb";
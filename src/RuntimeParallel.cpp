@@ -0,0 +1,315 @@
+#include "Runtime.h"
+
+const char * const cppXbParallelH = R"cppXb(#pragma once
+// cppXb parallel parsing runtime, generated by cppXb.
+//
+// Generated parser::parse_parallel(cppxb::Reader &, T &, threads) functions
+// read the element the reader is positioned on like parser::parse, except for
+// the items of T's repeated fields: their markup is only delimited, which
+// skips it without reading attributes or converting values. The items are
+// then parsed by up to threads threads (0 for one per core), each writing
+// into the item's own place in the vector so document order is kept without
+// merging partial results.
+//
+// Visitors registered on the reader are handed to the workers: a repeated
+// field of T with a visitor is parsed on the calling thread, the visitors of
+// nested streamed fields may be called concurrently. With -pmr the memory
+// resource of the parsed value is shared by the workers and must be thread
+// safe, like the default one. A parse error stops the workers; the error of
+// the first failing item in document order is thrown.
+//
+// Generated parser::parse_batch(cppxb::Batch &, docs, count, results)
+// functions parse many independent documents of the same root type on the
+// threads of a cppxb::Batch. The threads and their readers live as long as the
+// batch, so their buffers are reused from one document and one call to the
+// next. Each thread starts on its own share of the documents and steals half
+// of the remaining share of another thread once done. A document which fails
+// to parse gets its error in its result, the others are still parsed;
+// registered visitors are not used, streamed fields are stored. With -view
+// the parsed values point into the documents and into copies owned by the
+// batch, valid until its next call.
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "cppXbReader.h"
+
+namespace cppxb {
+
+class Parallel {
+public:
+	Parallel(Reader & r, unsigned threads) : _r(r), _threads(threads)
+	{
+		if (_threads == 0) {
+			_threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+	}
+
+	// Appends the items whose markup is in elements to items, parseItem
+	// reading one item from a reader positioned on its element.
+	template<typename V, typename F>
+	void parse(V & items, const std::vector<std::string_view> & elements, F parseItem)
+	{
+		if (elements.empty()) {
+			return;
+		}
+		const size_t first = items.size();
+		items.resize(first + elements.size());
+		const size_t workers = std::min<size_t>(_threads, (elements.size() + batch - 1) / batch);
+		std::vector<Reader> readers(workers);
+		std::atomic<size_t> next(0);
+		std::atomic<bool> failed(false);
+		std::mutex errorLock;
+		size_t errorItem = elements.size();
+		std::exception_ptr error;
+		auto work = [&](Reader & reader) {
+			while (!failed.load(std::memory_order_relaxed)) {
+				const size_t begin = next.fetch_add(batch);
+				if (begin >= elements.size()) {
+					return;
+				}
+				const size_t end = std::min(begin + batch, elements.size());
+				for (size_t i = begin; i < end; i++) {
+					try {
+						reader.reset(_r, elements[i]);
+						parseItem(reader, items[first + i]);
+					} catch (...) {
+						std::lock_guard<std::mutex> lock(errorLock);
+						if (i < errorItem) {
+							errorItem = i;
+							error = std::current_exception();
+						}
+						failed = true;
+						return;
+					}
+				}
+			}
+		};
+		std::vector<std::thread> threads;
+		threads.reserve(workers);
+		for (size_t i = 1; i < workers; i++) {
+			threads.push_back(std::thread(work, std::ref(readers[i])));
+		}
+		work(readers[0]);
+		for (size_t i = 0; i < threads.size(); i++) {
+			threads[i].join();
+		}
+		for (size_t i = 0; i < readers.size(); i++) {
+			_r.adopt(readers[i]);
+		}
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+private:
+	// Items claimed at once by a worker.
+	static const size_t batch = 64;
+
+	Parallel(const Parallel &);
+	Parallel & operator=(const Parallel &);
+
+	Reader & _r;
+	unsigned _threads;
+};
+
+// Result of one document of a batch.
+template<typename T>
+struct Parsed {
+	T value;
+	std::string error;//empty when the document was parsed
+	size_t offset;//where the reader stopped on error
+
+	Parsed() : offset(0) {}
+
+	explicit operator bool() const
+	{
+		return error.empty();
+	}
+};
+
+class Batch {
+public:
+	// Runs batches on threads threads (0 for one per core), the calling
+	// thread being one of them.
+	explicit Batch(unsigned threads = 0) : _job(0), _generation(0), _running(0), _stop(false)
+	{
+		if (threads == 0) {
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		for (unsigned i = 0; i < threads; i++) {
+			_workers.push_back(std::unique_ptr<Worker>(new Worker()));
+		}
+		for (unsigned i = 1; i < threads; i++) {
+			_workers[i]->thread = std::thread(&Batch::serve, this, i);
+		}
+	}
+
+	~Batch()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			_stop = true;
+		}
+		_wake.notify_all();
+		for (size_t i = 1; i < _workers.size(); i++) {
+			_workers[i]->thread.join();
+		}
+	}
+
+	unsigned threads() const
+	{
+		return (unsigned)_workers.size();
+	}
+
+	// Parses docs[0..count) into results[0..count), parseDoc reading one
+	// value from a reader positioned on the root element of a document.
+	template<typename T, typename F>
+	void parse(const std::string_view * docs, size_t count, std::vector<Parsed<T> > & results, F parseDoc)
+	{
+		results.resize(count);
+		const std::function<void(Reader &, size_t)> job = [&](Reader & reader, size_t i) {
+			Parsed<T> & result = results[i];
+			result.value = T();
+			result.error.clear();
+			result.offset = 0;
+			try {
+				reader.reset(docs[i].data(), docs[i].data() + docs[i].size());
+				parseDoc(reader, result.value);
+			} catch (const parse_error & e) {
+				result.error = e.what();
+				result.offset = e.offset();
+			} catch (const std::exception & e) {
+				result.error = e.what();
+				result.offset = reader.offset();
+			}
+		};
+		run(count, job);
+	}
+
+private:
+	struct Worker {
+		Reader reader;
+		Reader kept;//holds the copies made by reader for the documents of the current batch
+		std::mutex lock;//guards next and end
+		size_t next;
+		size_t end;
+		std::thread thread;
+
+		Worker() : next(0), end(0) {}
+	};
+
+	Batch(const Batch &);
+	Batch & operator=(const Batch &);
+
+	void run(size_t count, const std::function<void(Reader &, size_t)> & job)
+	{
+		const size_t n = _workers.size();
+		for (size_t i = 0; i < n; i++) {
+			Worker & w = *_workers[i];
+			std::lock_guard<std::mutex> lock(w.lock);
+			w.next = count * i / n;
+			w.end = count * (i + 1) / n;
+			w.kept = Reader();
+		}
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			_job = &job;
+			_running = n - 1;
+			_generation++;
+		}
+		_wake.notify_all();
+		work(0);
+		std::unique_lock<std::mutex> lock(_lock);
+		_done.wait(lock, [this]() { return _running == 0; });
+		_job = 0;
+	}
+
+	void serve(size_t w)
+	{
+		size_t generation = 0;
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> lock(_lock);
+				_wake.wait(lock, [&]() { return _stop || _generation != generation; });
+				if (_stop) {
+					return;
+				}
+				generation = _generation;
+			}
+			work(w);
+			{
+				std::lock_guard<std::mutex> lock(_lock);
+				_running--;
+			}
+			_done.notify_one();
+		}
+	}
+
+	void work(size_t w)
+	{
+		Worker & worker = *_workers[w];
+		size_t i;
+		while (next(w, i) || steal(w, i)) {
+			(*_job)(worker.reader, i);
+			worker.kept.adopt(worker.reader);
+		}
+	}
+
+	bool next(size_t w, size_t & i)
+	{
+		Worker & worker = *_workers[w];
+		std::lock_guard<std::mutex> lock(worker.lock);
+		if (worker.next == worker.end) {
+			return false;
+		}
+		i = worker.next++;
+		return true;
+	}
+
+	// Takes the second half of the documents left to another worker, i
+	// being the first of them.
+	bool steal(size_t w, size_t & i)
+	{
+		const size_t n = _workers.size();
+		for (size_t k = 1; k < n; k++) {
+			Worker & victim = *_workers[(w + k) % n];
+			size_t begin, end;
+			{
+				std::lock_guard<std::mutex> lock(victim.lock);
+				const size_t left = victim.end - victim.next;
+				if (left == 0) {
+					continue;
+				}
+				end = victim.end;
+				begin = victim.end = victim.next + left / 2;
+			}
+			Worker & worker = *_workers[w];
+			std::lock_guard<std::mutex> lock(worker.lock);
+			i = begin;
+			worker.next = begin + 1;
+			worker.end = end;
+			return true;
+		}
+		return false;
+	}
+
+	std::vector<std::unique_ptr<Worker> > _workers;
+	const std::function<void(Reader &, size_t)> * _job;
+	std::mutex _lock;//guards _job, _generation, _running and _stop
+	std::condition_variable _wake;
+	std::condition_variable _done;
+	size_t _generation;
+	size_t _running;
+	bool _stop;
+};
+
+}
+)cppXb";
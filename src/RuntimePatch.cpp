@@ -0,0 +1,180 @@
+#include "Runtime.h"
+
+const char * const cppXbPatchH = R"cppXb(#pragma once
+// cppXb patch runtime, generated by cppXb.
+//
+// parser::diff(from, to, patch) compares two values of a generated type and
+// records in patch the edits turning from into to, parser::apply(value,
+// patch) performs them. An edit reaches the value it changes through a path
+// of field numbers (the position of the field in its type, base type fields
+// first) and item indexes, and either sets it, inserts an item in a repeated
+// field or removes one. Values are in the binary encoding of cppXbBinary.h,
+// so a set edit on a polymorphic value carries its dynamic type and replaces
+// it when the type changes.
+//
+// Repeated fields are compared item by item once their common first and last
+// items are skipped, so inserting or removing items in the middle of a
+// vector gives as many edits. The indexes of an edit refer to the vector as
+// left by the previous edits. With -view the strings set by apply point into
+// the patch, which must outlive the value.
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "cppXbBinary.h"
+
+namespace cppxb {
+
+struct Edit {
+	enum Kind {
+		SET,//value replaces the value at path
+		INSERT,//value is inserted before the item at path
+		REMOVE//the item at path is removed
+	};
+
+	Kind kind;
+	std::vector<unsigned> path;
+	std::string value;
+};
+
+class Patch {
+public:
+	Patch() : fingerprint(0) {}
+
+	bool empty() const
+	{
+		return edits.empty();
+	}
+
+	// Compact form of the patch, to send it.
+	void encode(std::string & out) const
+	{
+		BinaryWriter w(out);
+		w.fixed(fingerprint);
+		w.varint(edits.size());
+		for (size_t i = 0; i < edits.size(); i++) {
+			const Edit & e = edits[i];
+			w.byte((unsigned char)e.kind);
+			w.varint(e.path.size());
+			for (size_t k = 0; k < e.path.size(); k++) {
+				w.varint(e.path[k]);
+			}
+			w.bytes(e.value);
+		}
+	}
+
+	void decode(std::string_view data)
+	{
+		BinaryReader r(data);
+		fingerprint = r.fixed<unsigned long long>();
+		edits.resize(r.count());
+		for (size_t i = 0; i < edits.size(); i++) {
+			Edit & e = edits[i];
+			const unsigned char kind = r.byte();
+			if (kind > Edit::REMOVE) {
+				invalid("unknown edit");
+			}
+			e.kind = (Edit::Kind)kind;
+			e.path.resize(r.count());
+			for (size_t k = 0; k < e.path.size(); k++) {
+				e.path[k] = (unsigned)r.varint();
+			}
+			e.value = r.bytes();
+		}
+		if (!r.atEnd()) {
+			invalid("trailing data");
+		}
+	}
+
+	// Checks the patch applies to the type with the given fingerprint.
+	void check(unsigned long long fp) const
+	{
+		if (fp != fingerprint) {
+			invalid("schema fingerprint mismatch");
+		}
+	}
+
+	[[noreturn]] static void invalid(const char * what)
+	{
+		throw std::runtime_error(std::string("cppxb::Patch: ") + what);
+	}
+
+	unsigned long long fingerprint;//of the root type, see parser::encode
+	std::vector<Edit> edits;
+};
+
+// Collects the edits found by the generated diff functions, the path of the
+// compared values being built as they go down.
+class Diff {
+public:
+	explicit Diff(Patch & patch) : _patch(patch) {}
+
+	void push(size_t step)
+	{
+		_path.push_back((unsigned)step);
+	}
+
+	void pop()
+	{
+		_path.pop_back();
+	}
+
+	// Adds an edit at the current path, returning the writer of its value.
+	BinaryWriter edit(Edit::Kind kind)
+	{
+		_patch.edits.push_back(Edit());
+		Edit & e = _patch.edits.back();
+		e.kind = kind;
+		e.path = _path;
+		return BinaryWriter(e.value);
+	}
+
+	// Number of edits recorded so far.
+	size_t size() const
+	{
+		return _patch.edits.size();
+	}
+
+	// Prefixes with the presence byte of an optional value the edit setting
+	// the value at the current path, if one was recorded from the first-th:
+	// a set edit at the path of an optional always carries that byte.
+	void present(size_t first)
+	{
+		if (_patch.edits.size() > first && _patch.edits.back().path == _path) {
+			_patch.edits.back().value.insert(0, 1, '\x01');
+		}
+	}
+
+private:
+	Diff(const Diff &);
+	Diff & operator=(const Diff &);
+
+	Patch & _patch;
+	std::vector<unsigned> _path;
+};
+
+// Reader of the value set by e, which must end at depth.
+inline BinaryReader setValue(const Edit & e, size_t depth)
+{
+	if (depth != e.path.size() || e.kind != Edit::SET) {
+		Patch::invalid("invalid path");
+	}
+	return BinaryReader(e.value);
+}
+
+// Index at depth in the path of e of an item among size.
+inline size_t itemIndex(const Edit & e, size_t depth, size_t size)
+{
+	if (depth >= e.path.size()) {
+		Patch::invalid("invalid path");
+	}
+	const size_t i = e.path[depth];
+	const bool insert = e.kind == Edit::INSERT && depth + 1 == e.path.size();
+	if (i > size || (i == size && !insert)) {
+		Patch::invalid("item index out of range");
+	}
+	return i;
+}
+
+}
+)cppXb";
@@ -0,0 +1,389 @@
+#include "Runtime.h"
+
+const char * const cppXbPodH = R"cppXb(#pragma once
+// cppXb fixed capacity runtime, generated by cppXb.
+//
+// With -f -pod the flat types hold their strings, optional values and
+// unbounded sequences inline, as cppxb::fixed_string<N>, fixed_optional<T>
+// and fixed_vector<T[N]>, sized by the xs:maxLength and maxOccurs of the
+// schema or by the bounds given to cppXb. The generated types are then
+// standard layout and trivially copyable: a value can be copied with memcpy,
+// put into shared memory or a ring buffer, and read by another process built
+// from the same headers. They are value initialized, so two equal values
+// built the same way have the same bytes.
+//
+// Storing more than the capacity throws std::length_error. The generated
+// parsers check the capacities first, a document holding too long a string
+// or too many items being rejected like any other invalid document.
+#include <boost/none.hpp>
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#define CPPXB_POD 1
+
+namespace cppxb {
+
+// String of at most N chars, kept null terminated.
+template<size_t N>
+class fixed_string {
+public:
+	typedef char value_type;
+	typedef size_t size_type;
+
+	fixed_string() : _size(0), _data() {}
+
+	fixed_string(std::string_view s) : _size(0), _data()
+	{
+		assign(s.data(), s.size());
+	}
+
+	fixed_string(const char * s) : _size(0), _data()
+	{
+		assign(s, std::strlen(s));
+	}
+
+	fixed_string & operator=(std::string_view s)
+	{
+		return assign(s.data(), s.size());
+	}
+
+	fixed_string & operator=(const char * s)
+	{
+		return assign(s, std::strlen(s));
+	}
+
+	fixed_string & operator=(const std::string & s)
+	{
+		return assign(s.data(), s.size());
+	}
+
+	fixed_string & assign(const char * s, size_t n)
+	{
+		if (n > N) {
+			throw std::length_error("string of " + std::to_string(n) + " chars longer than its capacity of " + std::to_string(N));
+		}
+		std::memmove(_data, s, n);
+		std::memset(_data + n, 0, N + 1 - n);
+		_size = (unsigned)n;
+		return *this;
+	}
+
+	static constexpr size_t capacity()
+	{
+		return N;
+	}
+
+	size_t size() const
+	{
+		return _size;
+	}
+
+	bool empty() const
+	{
+		return _size == 0;
+	}
+
+	const char * data() const
+	{
+		return _data;
+	}
+
+	const char * c_str() const
+	{
+		return _data;
+	}
+
+	void clear()
+	{
+		assign("", 0);
+	}
+
+	std::string_view view() const
+	{
+		return std::string_view(_data, _size);
+	}
+
+	operator std::string_view() const
+	{
+		return view();
+	}
+
+	std::string str() const
+	{
+		return std::string(_data, _size);
+	}
+
+private:
+	unsigned _size;
+	char _data[N + 1];
+};
+
+template<size_t N>
+bool operator==(const fixed_string<N> & a, const fixed_string<N> & b)
+{
+	return a.view() == b.view();
+}
+
+template<size_t N>
+bool operator!=(const fixed_string<N> & a, const fixed_string<N> & b)
+{
+	return a.view() != b.view();
+}
+
+template<size_t N>
+bool operator<(const fixed_string<N> & a, const fixed_string<N> & b)
+{
+	return a.view() < b.view();
+}
+
+template<size_t N>
+std::ostream & operator<<(std::ostream & out, const fixed_string<N> & s)
+{
+	return out << s.view();
+}
+
+// Optional value stored in place, like boost::optional.
+template<typename T>
+class fixed_optional {
+public:
+	typedef T value_type;
+
+	fixed_optional() : _has(false), _value() {}
+
+	fixed_optional(boost::none_t) : _has(false), _value() {}
+
+	fixed_optional(const T & v) : _has(true), _value(v) {}
+
+	fixed_optional & operator=(boost::none_t)
+	{
+		reset();
+		return *this;
+	}
+
+	fixed_optional & operator=(const T & v)
+	{
+		_value = v;
+		_has = true;
+		return *this;
+	}
+
+	T & emplace()
+	{
+		_value = T();
+		_has = true;
+		return _value;
+	}
+
+	void reset()
+	{
+		_value = T();
+		_has = false;
+	}
+
+	bool has_value() const
+	{
+		return _has;
+	}
+
+	explicit operator bool() const
+	{
+		return _has;
+	}
+
+	T & get()
+	{
+		return _value;
+	}
+
+	const T & get() const
+	{
+		return _value;
+	}
+
+	T & operator*()
+	{
+		return _value;
+	}
+
+	const T & operator*() const
+	{
+		return _value;
+	}
+
+	T * operator->()
+	{
+		return &_value;
+	}
+
+	const T * operator->() const
+	{
+		return &_value;
+	}
+
+private:
+	bool _has;
+	T _value;
+};
+
+template<typename A>
+class fixed_vector;
+
+// Sequence of at most N items of T stored in place, with the members of
+// std::vector used by the generated code. The items past size() are value
+// initialized.
+template<typename T, size_t N>
+class fixed_vector<T[N]> {
+public:
+	typedef T value_type;
+	typedef size_t size_type;
+	typedef T & reference;
+	typedef const T & const_reference;
+	typedef T * iterator;
+	typedef const T * const_iterator;
+
+	fixed_vector() : _size(0), _items() {}
+
+	static constexpr size_t capacity()
+	{
+		return N;
+	}
+
+	size_t size() const
+	{
+		return _size;
+	}
+
+	bool empty() const
+	{
+		return _size == 0;
+	}
+
+	// The capacity is fixed, reserve only checks it is not exceeded by n.
+	void reserve(size_t n)
+	{
+		if (n > N) {
+			full(n);
+		}
+	}
+
+	void resize(size_t n)
+	{
+		if (n > N) {
+			full(n);
+		}
+		for (size_t i = _size; i > n; i--) {
+			_items[i - 1] = T();
+		}
+		_size = (unsigned)n;
+	}
+
+	void clear()
+	{
+		resize(0);
+	}
+
+	T & emplace_back()
+	{
+		if (_size == N) {
+			full(_size + 1);
+		}
+		return _items[_size++];
+	}
+
+	void push_back(const T & v)
+	{
+		emplace_back() = v;
+	}
+
+	void pop_back()
+	{
+		_items[--_size] = T();
+	}
+
+	iterator emplace(const_iterator pos)
+	{
+		const size_t i = pos - _items;
+		emplace_back();
+		for (size_t k = _size - 1; k > i; k--) {
+			_items[k] = _items[k - 1];
+		}
+		_items[i] = T();
+		return _items + i;
+	}
+
+	iterator erase(const_iterator pos)
+	{
+		const size_t i = pos - _items;
+		for (size_t k = i; k + 1 < _size; k++) {
+			_items[k] = _items[k + 1];
+		}
+		pop_back();
+		return _items + i;
+	}
+
+	T & operator[](size_t i)
+	{
+		return _items[i];
+	}
+
+	const T & operator[](size_t i) const
+	{
+		return _items[i];
+	}
+
+	T & back()
+	{
+		return _items[_size - 1];
+	}
+
+	const T & back() const
+	{
+		return _items[_size - 1];
+	}
+
+	T * data()
+	{
+		return _items;
+	}
+
+	const T * data() const
+	{
+		return _items;
+	}
+
+	iterator begin()
+	{
+		return _items;
+	}
+
+	iterator end()
+	{
+		return _items + _size;
+	}
+
+	const_iterator begin() const
+	{
+		return _items;
+	}
+
+	const_iterator end() const
+	{
+		return _items + _size;
+	}
+
+private:
+	static void full(size_t n)
+	{
+		throw std::length_error(std::to_string(n) + " items exceed the capacity of " + std::to_string(N));
+	}
+
+	unsigned _size;
+	T _items[N];
+};
+
+}
+)cppXb";
@@ -0,0 +1,550 @@
+#include "Runtime.h"
+
+const char * const cppXbReaderH = R"cppXb(#pragma once
+// cppXb pull parser runtime, generated by cppXb.
+//
+// cppxb::Reader walks an XML document held in memory without building any
+// intermediate tree. Generated parser::parse(cppxb::Reader &, T &) functions
+// are called with the reader positioned on the start tag of T's element and
+// return once its end tag has been consumed. An end tag not closing the
+// element it ends throws parse_error like any other malformed markup.
+//
+// Names, attribute values and text handed out as std::string_view point into
+// the caller's buffer (or into the reader's scratch buffer for text split by
+// comments or CDATA sections) and are only valid until the next call on the
+// reader. Entities are not decoded in these views, see cppxb::decode.
+//
+// Repeated fields generated in streaming mode (-stream or cppxb:stream="true")
+// hand each parsed item to the T::visitor registered with setVisitor instead
+// of storing it, the item is destroyed once the visitor returns.
+//
+// parser::parse(cppxb::Reader &, T &, const T::mask &) only reads the fields
+// set in the mask, one bit per field (T::mask::F_<field>). A selected complex
+// field reads the fields of its own mask, given by the mask member of the same
+// name, all of them when that member is null.
+#include <string>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <cstring>
+#include <locale>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include "cppXbString.h"
+#include "cppXbConvert.h"
+#include "cppXbFile.h"
+#include "cppXbScan.h"
+
+namespace cppxb {
+
+// Unique address per visitor type, used to find registered visitors.
+template<typename V>
+const void * visitorKey()
+{
+	static const char key = 0;
+	return &key;
+}
+
+class parse_error : public std::runtime_error {
+public:
+	parse_error(const std::string & msg, size_t offset)
+		: std::runtime_error(msg + " (at offset " + std::to_string(offset) + ")"), _offset(offset) {}
+	size_t offset() const { return _offset; }
+private:
+	size_t _offset;
+};
+
+struct Attribute {
+	std::string_view name;
+	std::string_view value;
+};
+
+class Reader {
+public:
+	// Reader positioned on nothing, to be reset before use.
+	Reader() : _begin(0), _p(0), _end(0), _tag(0), _empty(true) {}
+
+	Reader(const char * begin, const char * end)
+	{
+		reset(begin, end);
+	}
+
+	explicit Reader(std::string_view doc)
+	{
+		reset(doc.data(), doc.data() + doc.size());
+	}
+
+	// Positions the reader on the root element of [begin, end). The
+	// attribute and scratch storage is kept so a reader can be reused.
+	void reset(const char * begin, const char * end)
+	{
+		_begin = _p = begin;
+		_end = end;
+		_empty = false;
+		_open.clear();
+		_open.reserve(16);//enough for most documents not to allocate while parsing
+		_kept.clear();
+		_adopted.clear();
+		if (_end - _p >= 3 && std::memcmp(_p, "\xEF\xBB\xBF", 3) == 0) {
+			_p += 3;
+		}
+		for (;;) {
+			_p = scan::skip<scan::Space>(_p, _end);
+			if (_p >= _end || *_p != '<') {
+				error("root element expected");
+			}
+			if (!skipMarkup()) {
+				startTag();
+				return;
+			}
+		}
+	}
+
+	// Positions the reader on an element of the document starting at doc,
+	// as returned by element(). Offsets stay relative to that document and
+	// the copies kept for previous elements are not released.
+	void reset(const char * doc, std::string_view element)
+	{
+		_begin = doc;
+		_p = element.data();
+		_end = element.data() + element.size();
+		_empty = false;
+		_open.clear();
+		_open.reserve(16);
+		startTag();
+	}
+
+	// Same for an element of the document of doc, using its visitors.
+	void reset(const Reader & doc, std::string_view element)
+	{
+		_visitors = doc._visitors;
+		reset(doc._begin, element);
+	}
+
+	// Start of the document being read.
+	const char * document() const
+	{
+		return _begin;
+	}
+
+	// Name of the element the reader is positioned on.
+	std::string_view name() const
+	{
+		return _name;
+	}
+
+	const std::vector<Attribute> & attributes() const
+	{
+		return _attrs;
+	}
+
+	const Attribute * attribute(std::string_view name) const
+	{
+		for (size_t i = 0; i < _attrs.size(); i++) {
+			if (_attrs[i].name == name) {
+				return &_attrs[i];
+			}
+		}
+		return 0;
+	}
+
+	// Moves to the next child element of the current one. Returns false
+	// once the end tag of the current element has been consumed.
+	bool nextChild()
+	{
+		if (_empty) {
+			_empty = false;
+			return false;
+		}
+		for (;;) {
+			seekTag();
+			if (_p[1] == '/') {
+				endTag();
+				return false;
+			}
+			if (!skipMarkup()) {
+				startTag();
+				return true;
+			}
+		}
+	}
+
+	// Returns the raw text content of the current element and consumes it
+	// up to its end tag. Child elements are skipped.
+	std::string_view text()
+	{
+		if (_empty) {
+			_empty = false;
+			return std::string_view();
+		}
+		const char * start = _p;
+		seekTag();
+		if (_p[1] == '/') {
+			const std::string_view content(start, _p - start);
+			endTag();
+			return content;
+		}
+		_scratch.assign(start, _p);
+		for (;;) {
+			if (_p[1] == '/') {
+				endTag();
+				return _scratch;
+			}
+			if (_end - _p >= 9 && std::memcmp(_p, "<![CDATA[", 9) == 0) {
+				const char * data = _p + 9;
+				seek("]]>");
+				for (const char * c = data; c < _p; c++) {
+					if (*c == '<') {
+						_scratch += "&lt;";
+					} else if (*c == '&') {
+						_scratch += "&amp;";
+					} else {
+						_scratch += *c;
+					}
+				}
+				_p += 3;
+			} else if (!skipMarkup()) {
+				startTag();
+				skip();
+			}
+			start = _p;
+			seekTag();
+			_scratch.append(start, _p);
+		}
+	}
+
+	// Skips the content of the current element up to its end tag.
+	void skip()
+	{
+		if (_empty) {
+			_empty = false;
+			return;
+		}
+		size_t depth = 1;
+		while (depth > 0) {
+			seekTag();
+			if (_p[1] == '/') {
+				endTag();
+				depth--;
+			} else if (!skipMarkup() && !skipStartTag()) {
+				depth++;
+			}
+		}
+	}
+
+	// Checks that only whitespace, comments and processing instructions
+	// follow the root element, once it has been read.
+	void finish()
+	{
+		for (;;) {
+			_p = scan::skip<scan::Space>(_p, _end);
+			if (_p >= _end) {
+				return;
+			}
+			if (_end - _p < 2 || *_p != '<' || (_p[1] != '?' && (_end - _p < 4 || std::memcmp(_p, "<!--", 4) != 0))) {
+				error("content after the root element");
+			}
+			skipMarkup();
+		}
+	}
+
+	// Skips the current element up to its end tag, returning its markup
+	// from the start of its start tag.
+	std::string_view element()
+	{
+		const char * start = _tag;
+		skip();
+		return std::string_view(start, _p - start);
+	}
+
+	size_t offset() const
+	{
+		return _p - _begin;
+	}
+
+	// Offset of the start tag of the element the reader is positioned on.
+	size_t tagOffset() const
+	{
+		return _tag - _begin;
+	}
+
+	[[noreturn]] void error(const std::string & msg) const
+	{
+		throw parse_error(msg, offset());
+	}
+
+	[[noreturn]] void missing(const char * nodeName) const
+	{
+		error(std::string("No such node (") + nodeName + ")");
+	}
+
+	// Returns v when it points into the document, otherwise a copy owned by
+	// the reader and valid until it is reset or destroyed.
+	std::string_view keep(std::string_view v)
+	{
+		if (v.data() >= _begin && v.data() + v.size() <= _end) {
+			return v;
+		}
+		_kept.push_back(std::string(v));
+		return _kept.back();
+	}
+
+	// Takes over the copies kept by other, so what they were handed out for
+	// can outlive it.
+	void adopt(Reader & other)
+	{
+		if (!other._kept.empty()) {
+			_adopted.push_back(std::deque<std::string>());
+			_adopted.back().swap(other._kept);
+		}
+	}
+
+	template<typename V>
+	void setVisitor(V * v)
+	{
+		for (size_t i = 0; i < _visitors.size(); i++) {
+			if (_visitors[i].first == visitorKey<V>()) {
+				_visitors[i].second = v;
+				return;
+			}
+		}
+		_visitors.push_back(std::make_pair(visitorKey<V>(), (void *)v));
+	}
+
+	template<typename V>
+	V * visitor() const
+	{
+		for (size_t i = 0; i < _visitors.size(); i++) {
+			if (_visitors[i].first == visitorKey<V>()) {
+				return (V *)_visitors[i].second;
+			}
+		}
+		return 0;
+	}
+
+	// Conversion buffer for generated and runtime value parsers.
+	std::string & buffer()
+	{
+		return _buffer;
+	}
+
+private:
+	void seek(char c)
+	{
+		const char * found = (const char *)std::memchr(_p, c, _end - _p);
+		if (!found) {
+			_p = _end;
+			error("unexpected end of document");
+		}
+		_p = found;
+	}
+
+	// Moves to the next markup, making sure its second character can be read.
+	void seekTag()
+	{
+		seek('<');
+		if (_end - _p < 2) {
+			error("unexpected end of document");
+		}
+	}
+
+	void seek(const char * pattern)
+	{
+		const size_t len = std::strlen(pattern);
+		for (;;) {
+			seek(pattern[0]);
+			if ((size_t)(_end - _p) >= len && std::memcmp(_p, pattern, len) == 0) {
+				return;
+			}
+			_p++;
+		}
+	}
+
+	// Skips comments, processing instructions, CDATA sections and
+	// declarations starting at _p.
+	bool skipMarkup()
+	{
+		if (_end - _p < 2) {
+			error("unexpected end of document");
+		}
+		if (_p[1] == '?') {
+			seek("?>");
+			_p += 2;
+			return true;
+		}
+		if (_p[1] != '!') {
+			return false;
+		}
+		if (_end - _p >= 4 && std::memcmp(_p, "<!--", 4) == 0) {
+			seek("-->");
+			_p += 3;
+		} else if (_end - _p >= 9 && std::memcmp(_p, "<![CDATA[", 9) == 0) {
+			seek("]]>");
+			_p += 3;
+		} else {
+			int depth = 0;
+			for (_p++; _p < _end; _p++) {
+				if (*_p == '[') {
+					depth++;
+				} else if (*_p == ']') {
+					depth--;
+				} else if (*_p == '>' && depth <= 0) {
+					break;
+				}
+			}
+			seek('>');
+			_p++;
+		}
+		return true;
+	}
+
+	void startTag()
+	{
+		_tag = _p;
+		const char * start = ++_p;
+		_p = scan::find<scan::NameEnd>(_p, _end);
+		_name = std::string_view(start, _p - start);
+		checkName(_name);
+		_attrs.clear();
+		for (;;) {
+			_p = scan::skip<scan::Space>(_p, _end);
+			if (_p >= _end) {
+				error("unexpected end of document");
+			}
+			if (*_p == '>') {
+				_p++;
+				_empty = false;
+				_open.push_back(_name);
+				return;
+			}
+			if (*_p == '/') {
+				seek('>');
+				_p++;
+				_empty = true;
+				return;
+			}
+			Attribute a;
+			start = _p;
+			_p = scan::find<scan::NameEnd>(_p, _end);
+			a.name = std::string_view(start, _p - start);
+			_p = scan::skip<scan::Space>(_p, _end);
+			if (_p >= _end || *_p != '=') {
+				error("'=' expected after attribute " + std::string(a.name));
+			}
+			_p = scan::skip<scan::Space>(_p + 1, _end);
+			if (_p >= _end || (*_p != '"' && *_p != '\'')) {
+				error("quote expected for attribute " + std::string(a.name));
+			}
+			const char quote = *_p++;
+			start = _p;
+			seek(quote);
+			a.value = std::string_view(start, _p - start);
+			_p++;
+			_attrs.push_back(a);
+		}
+	}
+
+	// Element names start with a letter, '_', ':' or a multibyte character.
+	void checkName(std::string_view name)
+	{
+		const unsigned char c = name.empty() ? 0 : name[0];
+		if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':' || c >= 0x80)) {
+			_p = name.data();
+			error("element name expected");
+		}
+	}
+
+	// Skips a start tag without reading its attributes, returns true for
+	// empty elements.
+	bool skipStartTag()
+	{
+		const char * start = _p + 1;
+		_p = scan::find<scan::NameEnd>(start, _end);
+		const std::string_view name(start, _p - start);
+		checkName(name);
+		for (_p = scan::find<scan::TagMarkup>(_p, _end); _p < _end; _p = scan::find<scan::TagMarkup>(_p + 1, _end)) {
+			if (*_p == '>') {
+				_p++;
+				if (_p[-2] == '/') {
+					return true;
+				}
+				_open.push_back(name);
+				return false;
+			}
+			seek(*_p++);
+		}
+		error("unexpected end of document");
+	}
+
+	// Consumes the end tag at _p, which must close the last open element.
+	void endTag()
+	{
+		const char * start = _p + 2;
+		_p = scan::find<scan::NameEnd>(start, _end);
+		if (_open.empty() || _open.back() != std::string_view(start, _p - start)) {
+			_p = start;
+			error("mismatched end tag");
+		}
+		_open.pop_back();
+		_p = scan::skip<scan::Space>(_p, _end);
+		if (_p >= _end || *_p != '>') {
+			error("'>' expected in end tag");
+		}
+		_p++;
+	}
+
+	const char * _begin;
+	const char * _p;
+	const char * _end;
+	const char * _tag;
+	bool _empty;
+	std::string_view _name;
+	std::vector<Attribute> _attrs;
+	std::vector<std::string_view> _open;//names of the elements whose end tag is still to come
+	std::string _scratch;
+	std::string _buffer;
+	std::vector<std::pair<const void *, void *> > _visitors;
+	std::deque<std::string> _kept;
+	std::deque<std::deque<std::string> > _adopted;
+};
+
+inline void parseValue(Reader &, std::string_view v, std::string & t)
+{
+	decode(v, t);
+}
+
+inline void parseValue(Reader & r, std::string_view v, std::pmr::string & t)
+{
+	std::string & s = r.buffer();
+	decode(v, s);
+	t.assign(s);
+}
+
+inline void parseValue(Reader & r, std::string_view v, xstring & t)
+{
+	t = xstring::raw(r.keep(v));
+}
+
+template<typename T>
+void parseValue(Reader & r, std::string_view v, T & t)
+{
+	if constexpr (std::is_arithmetic<T>::value) {
+		if (!convert(v, t)) {
+			r.error("invalid value '" + std::string(v) + "'");
+		}
+	} else {
+		std::string & s = r.buffer();
+		decode(v, s);
+		std::istringstream iss(s);
+		iss.imbue(std::locale::classic());
+		iss >> t;
+		if (iss.fail() || !(iss >> std::ws).eof()) {
+			r.error("invalid value '" + s + "'");
+		}
+	}
+}
+
+}
+)cppXb";
@@ -0,0 +1,185 @@
+#include "Runtime.h"
+
+const char * const cppXbScanH = R"cppXb(#pragma once
+// cppXb scanning runtime, generated by cppXb.
+//
+// Character class searches used by cppxb::Reader to delimit names, runs of
+// whitespace and start tags. On x86 they classify 16 (SSE2) or 32 (AVX2)
+// bytes per step, AVX2 being used when the processor supports it; elsewhere,
+// and for the last bytes of a buffer, they test one character at a time.
+// cppxb::scan::level selects the implementation, e.g. to compare them.
+#include <cstddef>
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#include <immintrin.h>
+#define CPPXB_SCAN_X86 1
+#endif
+
+namespace cppxb {
+namespace scan {
+
+enum Level { SCALAR, SSE2, AVX2 };
+
+// Best implementation supported by the processor.
+inline Level detect()
+{
+#ifdef CPPXB_SCAN_X86
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") ? AVX2 : SSE2;
+#else
+	return SCALAR;
+#endif
+}
+
+// Implementation used by find and skip.
+inline Level level = detect();
+
+#ifdef CPPXB_SCAN_X86
+inline __m128i eq(__m128i v, char c)
+{
+	return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+}
+
+__attribute__((target("avx2"))) inline __m256i eq(__m256i v, char c)
+{
+	return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+}
+#endif
+
+// Character classes: test gives whether a character, or each byte of a
+// vector, belongs to the class (| being the vector or of GCC and clang).
+struct Space {
+	static bool test(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+#ifdef CPPXB_SCAN_X86
+	static __m128i test(__m128i v)
+	{
+		return eq(v, ' ') | eq(v, '\t') | eq(v, '\n') | eq(v, '\r');
+	}
+	__attribute__((target("avx2"))) static __m256i test(__m256i v)
+	{
+		return eq(v, ' ') | eq(v, '\t') | eq(v, '\n') | eq(v, '\r');
+	}
+#endif
+};
+
+// Characters ending an element or attribute name.
+struct NameEnd {
+	static bool test(char c)
+	{
+		return Space::test(c) || c == '>' || c == '/' || c == '=';
+	}
+#ifdef CPPXB_SCAN_X86
+	static __m128i test(__m128i v)
+	{
+		return Space::test(v) | eq(v, '>') | eq(v, '/') | eq(v, '=');
+	}
+	__attribute__((target("avx2"))) static __m256i test(__m256i v)
+	{
+		return Space::test(v) | eq(v, '>') | eq(v, '/') | eq(v, '=');
+	}
+#endif
+};
+
+// Characters to stop at when skipping a start tag: quotes and its end.
+struct TagMarkup {
+	static bool test(char c)
+	{
+		return c == '"' || c == '\'' || c == '>';
+	}
+#ifdef CPPXB_SCAN_X86
+	static __m128i test(__m128i v)
+	{
+		return eq(v, '"') | eq(v, '\'') | eq(v, '>');
+	}
+	__attribute__((target("avx2"))) static __m256i test(__m256i v)
+	{
+		return eq(v, '"') | eq(v, '\'') | eq(v, '>');
+	}
+#endif
+};
+
+// First character of [p, end) which is (In) or is not (!In) in class C,
+// end when there is none.
+template<typename C, bool In>
+const char * findScalar(const char * p, const char * end)
+{
+	while (p < end && C::test(*p) != In) {
+		p++;
+	}
+	return p;
+}
+
+#ifdef CPPXB_SCAN_X86
+template<typename C, bool In>
+const char * findSse2(const char * p, const char * end)
+{
+	for (; end - p >= 16; p += 16) {
+		unsigned bits = _mm_movemask_epi8(C::test(_mm_loadu_si128((const __m128i *)p)));
+		if (!In) {
+			bits = ~bits & 0xffff;
+		}
+		if (bits) {
+			return p + __builtin_ctz(bits);
+		}
+	}
+	return findScalar<C, In>(p, end);
+}
+
+template<typename C, bool In>
+__attribute__((target("avx2"))) const char * findAvx2(const char * p, const char * end)
+{
+	for (; end - p >= 32; p += 32) {
+		unsigned bits = _mm256_movemask_epi8(C::test(_mm256_loadu_si256((const __m256i *)p)));
+		if (!In) {
+			bits = ~bits;
+		}
+		if (bits) {
+			return p + __builtin_ctz(bits);
+		}
+	}
+	return findSse2<C, In>(p, end);
+}
+#endif
+
+template<typename C, bool In>
+const char * search(const char * p, const char * end)
+{
+	// names and runs of whitespace are short, the first characters are
+	// tested before loading a vector
+	for (int i = 0; i < 4; i++, p++) {
+		if (p == end || C::test(*p) == In) {
+			return p;
+		}
+	}
+#ifdef CPPXB_SCAN_X86
+	switch (level) {
+	case AVX2:
+		return findAvx2<C, In>(p, end);
+	case SSE2:
+		return findSse2<C, In>(p, end);
+	default:
+		break;
+	}
+#endif
+	return findScalar<C, In>(p, end);
+}
+
+// First character of [p, end) in class C.
+template<typename C>
+const char * find(const char * p, const char * end)
+{
+	return search<C, true>(p, end);
+}
+
+// First character of [p, end) not in class C.
+template<typename C>
+const char * skip(const char * p, const char * end)
+{
+	return search<C, false>(p, end);
+}
+
+}
+}
+)cppXb";
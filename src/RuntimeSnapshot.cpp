@@ -0,0 +1,327 @@
+#include "Runtime.h"
+
+const char * const cppXbSnapshotH = R"cppXb(#pragma once
+// cppXb snapshot runtime, generated by cppXb.
+//
+// In snapshot mode (-snapshot) parser::snapshot(const T &, std::string &)
+// lays a value out as fixed size records referring to each other by offset,
+// and the generated view::T classes read the fields of such an image in
+// place: opening a snapshot maps the file, nothing is parsed or allocated and
+// only the pages holding the fields actually read are loaded.
+//
+// A record holds the fields of its type (base type fields first) in slots of
+// a size known at generation time:
+// - numbers, booleans and enums are stored by value,
+// - strings as the offset and length of their decoded characters,
+// - complex values and polymorphic pointers as the offset of their record,
+//   0 standing for none; records of polymorphic types start with their tag,
+// - optional values are preceded by a presence byte,
+// - repeated fields as the offset and count of an array of slots, fixed
+//   arrays as their slots.
+// Values are in the byte order of the machine which wrote the snapshot. The
+// image starts with a magic number, the fingerprint of the schema of its root
+// type and the offset of the root record; the views trust the rest of the
+// image, which must come from parser::snapshot.
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <boost/optional.hpp>
+#include "cppXbString.h"
+#include "cppXbFile.h"
+
+#define CPPXB_SNAPSHOT 1
+
+namespace cppxb {
+
+class SnapshotWriter {
+public:
+	// Starts the image of a value of the type with the given fingerprint.
+	SnapshotWriter(std::string & out, unsigned long long fingerprint) : _out(out)
+	{
+		_start = _out.size();
+		_out.append(magic, sizeof(magic));
+		store<std::uint64_t>(allocate(sizeof(std::uint64_t)), fingerprint);
+		allocate(sizeof(std::uint64_t));
+	}
+
+	// Appends n zeroed bytes, returning their offset in the image.
+	size_t allocate(size_t n)
+	{
+		const size_t at = _out.size() - _start;
+		_out.append(n, '\0');
+		return at;
+	}
+
+	template<typename S>
+	void store(size_t at, S v)
+	{
+		std::memcpy(&_out[_start + at], &v, sizeof(S));
+	}
+
+	void string(size_t at, std::string_view v)
+	{
+		const size_t chars = allocate(v.size());
+		std::memcpy(&_out[_start + chars], v.data(), v.size());
+		store<std::uint64_t>(at, chars);
+		store<std::uint64_t>(at + sizeof(std::uint64_t), v.size());
+	}
+
+	void string(size_t at, const char * v)
+	{
+		string(at, std::string_view(v));
+	}
+
+	template<typename A>
+	void string(size_t at, const std::basic_string<char, std::char_traits<char>, A> & v)
+	{
+		string(at, std::string_view(v.data(), v.size()));
+	}
+
+	void string(size_t at, const xstring & v)
+	{
+		if (!v.escaped()) {
+			string(at, v.raw());
+		} else {
+			v.str(_scratch);
+			string(at, std::string_view(_scratch));
+		}
+	}
+
+	void root(size_t at)
+	{
+		store<std::uint64_t>(sizeof(magic) + sizeof(std::uint64_t), at);
+	}
+
+	static constexpr char magic[8] = { 'c', 'X', 'b', 'S', 'n', 'a', 'p', '\1' };
+
+private:
+	SnapshotWriter(const SnapshotWriter &);
+	SnapshotWriter & operator=(const SnapshotWriter &);
+
+	std::string & _out;
+	std::string _scratch;
+	size_t _start;
+};
+
+// Snapshot image, mapped from a file or held by the caller.
+class Snapshot {
+public:
+	explicit Snapshot(const std::string & path) : _file(new MappedFile(path)), _data(_file->view()) {}
+
+	explicit Snapshot(std::string_view data) : _file(0), _data(data) {}
+
+	~Snapshot()
+	{
+		delete _file;
+	}
+
+	const char * data() const
+	{
+		return _data.data();
+	}
+
+	// Offset of the root record, checking the image holds a value of the
+	// type with the given fingerprint.
+	size_t root(unsigned long long fingerprint) const
+	{
+		const size_t header = sizeof(SnapshotWriter::magic) + 2 * sizeof(std::uint64_t);
+		if (_data.size() < header
+		    || std::memcmp(_data.data(), SnapshotWriter::magic, sizeof(SnapshotWriter::magic)) != 0) {
+			throw std::runtime_error("cppxb::Snapshot: not a cppXb snapshot");
+		}
+		std::uint64_t fp, at;
+		std::memcpy(&fp, _data.data() + sizeof(SnapshotWriter::magic), sizeof(fp));
+		std::memcpy(&at, _data.data() + sizeof(SnapshotWriter::magic) + sizeof(fp), sizeof(at));
+		if (fp != fingerprint) {
+			throw std::runtime_error("cppxb::Snapshot: schema fingerprint mismatch");
+		}
+		if (at < header || at >= _data.size()) {
+			throw std::runtime_error("cppxb::Snapshot: invalid root offset");
+		}
+		return at;
+	}
+
+private:
+	Snapshot(const Snapshot &);
+	Snapshot & operator=(const Snapshot &);
+
+	MappedFile * _file;
+	std::string_view _data;
+};
+
+// Slot kinds: get reads the value of the slot at offset at of the image,
+// put writes it. size is the size of the slot.
+template<typename S, typename V>
+struct SnapshotValue {
+	typedef V value_type;
+	static const size_t size = sizeof(S);
+
+	static V get(const char * base, size_t at)
+	{
+		S s;
+		std::memcpy(&s, base + at, sizeof(S));
+		return (V)s;
+	}
+
+	static void put(SnapshotWriter & w, size_t at, const V & v)
+	{
+		w.store<S>(at, (S)v);
+	}
+};
+
+struct SnapshotString {
+	typedef std::string_view value_type;
+	static const size_t size = 2 * sizeof(std::uint64_t);
+
+	static std::string_view get(const char * base, size_t at)
+	{
+		std::uint64_t chars, n;
+		std::memcpy(&chars, base + at, sizeof(chars));
+		std::memcpy(&n, base + at + sizeof(chars), sizeof(n));
+		return std::string_view(base + chars, n);
+	}
+
+	template<typename T>
+	static void put(SnapshotWriter & w, size_t at, const T & v)
+	{
+		w.string(at, v);
+	}
+};
+
+// Record of a complex value, written by the generated parser::snapshot.
+template<typename V>
+struct SnapshotRecord {
+	typedef V value_type;
+	static const size_t size = sizeof(std::uint64_t);
+
+	static V get(const char * base, size_t at)
+	{
+		std::uint64_t record;
+		std::memcpy(&record, base + at, sizeof(record));
+		return record ? V(base, record) : V();
+	}
+};
+
+// Read-only sequence of count slots of kind Slot.
+template<typename Slot>
+class SnapshotRange {
+public:
+	typedef typename Slot::value_type value_type;
+
+	class const_iterator {
+	public:
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef typename Slot::value_type value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const value_type * pointer;
+		typedef value_type reference;
+
+		const_iterator() : _base(0), _at(0) {}
+		const_iterator(const char * base, size_t at) : _base(base), _at(at) {}
+
+		value_type operator*() const { return Slot::get(_base, _at); }
+		value_type operator[](difference_type i) const { return Slot::get(_base, _at + i * Slot::size); }
+		const_iterator & operator++() { _at += Slot::size; return *this; }
+		const_iterator operator++(int) { const_iterator it = *this; _at += Slot::size; return it; }
+		const_iterator & operator--() { _at -= Slot::size; return *this; }
+		const_iterator operator--(int) { const_iterator it = *this; _at -= Slot::size; return it; }
+		const_iterator & operator+=(difference_type n) { _at += n * Slot::size; return *this; }
+		const_iterator & operator-=(difference_type n) { _at -= n * Slot::size; return *this; }
+		const_iterator operator+(difference_type n) const { return const_iterator(_base, _at + n * Slot::size); }
+		const_iterator operator-(difference_type n) const { return const_iterator(_base, _at - n * Slot::size); }
+		difference_type operator-(const_iterator o) const { return ((difference_type)_at - (difference_type)o._at) / (difference_type)Slot::size; }
+		bool operator==(const_iterator o) const { return _at == o._at; }
+		bool operator!=(const_iterator o) const { return _at != o._at; }
+		bool operator<(const_iterator o) const { return _at < o._at; }
+
+	private:
+		const char * _base;
+		size_t _at;
+	};
+
+	SnapshotRange(const char * base, size_t at, size_t count) : _base(base), _at(at), _count(count) {}
+
+	size_t size() const
+	{
+		return _count;
+	}
+
+	bool empty() const
+	{
+		return _count == 0;
+	}
+
+	value_type operator[](size_t i) const
+	{
+		return Slot::get(_base, _at + i * Slot::size);
+	}
+
+	const_iterator begin() const
+	{
+		return const_iterator(_base, _at);
+	}
+
+	const_iterator end() const
+	{
+		return const_iterator(_base, _at + _count * Slot::size);
+	}
+
+private:
+	const char * _base;
+	size_t _at;
+	size_t _count;
+};
+
+// Base of the generated views: the image and the offset of a record, a
+// default constructed view standing for a missing value.
+class SnapshotView {
+public:
+	SnapshotView() : _base(0), _at(0) {}
+
+	SnapshotView(const char * base, size_t at) : _base(base), _at(at) {}
+
+	explicit operator bool() const
+	{
+		return _base != 0;
+	}
+
+protected:
+	template<typename Slot>
+	typename Slot::value_type _slot(size_t offset) const
+	{
+		return Slot::get(_base, _at + offset);
+	}
+
+	template<typename Slot>
+	boost::optional<typename Slot::value_type> _optional(size_t offset) const
+	{
+		if (!_base[_at + offset]) {
+			return boost::none;
+		}
+		return Slot::get(_base, _at + offset + 1);
+	}
+
+	template<typename Slot>
+	SnapshotRange<Slot> _range(size_t offset) const
+	{
+		std::uint64_t items, count;
+		std::memcpy(&items, _base + _at + offset, sizeof(items));
+		std::memcpy(&count, _base + _at + offset + sizeof(items), sizeof(count));
+		return SnapshotRange<Slot>(_base, items, count);
+	}
+
+	template<typename Slot>
+	SnapshotRange<Slot> _array(size_t offset, size_t count) const
+	{
+		return SnapshotRange<Slot>(_base, _at + offset, count);
+	}
+
+	const char * _base;
+	size_t _at;
+};
+
+}
+)cppXb";
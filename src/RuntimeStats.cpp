@@ -0,0 +1,393 @@
+#include "Runtime.h"
+
+const char * const cppXbStatsH = R"cppXb(#pragma once
+// cppXb statistics runtime, generated by cppXb.
+//
+// With -stats the generated parse, put and writeContent functions count, per
+// type, their calls, the bytes they read (pull parsers), the nanoseconds spent
+// in them, with and without the nested values counted themselves, and the heap
+// allocations made meanwhile. A polymorphic value is counted for its dynamic
+// type, a value written back verbatim (-dirty) is not. Each thread counts in
+// its own slots, which cppxb::stats::collect() adds up on demand; dump() and
+// dumpJson() print the result and reset() clears it. A reset made while other
+// threads parse may keep part of their counts.
+//
+// The allocations are those the program's operator new reports through
+// cppxb::stats::countAllocation(): define CPPXB_STATS_NEW before including
+// this header in one translation unit to get such an operator new, or call it
+// from the program's own.
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#define CPPXB_STATS 1
+
+namespace cppxb {
+namespace stats {
+
+enum Operation {
+	PARSE,
+	SERIALIZE,
+	OPERATIONS
+};
+
+inline const char * operationName(Operation op)
+{
+	return op == PARSE ? "parse" : "serialize";
+}
+
+struct Counters {
+	unsigned long long calls = 0;
+	unsigned long long bytes = 0;
+	unsigned long long nanoseconds = 0;
+	unsigned long long selfNanoseconds = 0;
+	unsigned long long allocations = 0;
+};
+
+struct TypeStats {
+	std::string type;//Type::fullPath
+	Counters operations[OPERATIONS];
+};
+
+class Scope;
+
+namespace detail {
+
+// Counters of a type and operation in a thread, only written by the thread:
+// the relaxed atomics let collect() read them from the others.
+struct Slot {
+	std::atomic<unsigned long long> calls{0};
+	std::atomic<unsigned long long> bytes{0};
+	std::atomic<unsigned long long> nanoseconds{0};
+	std::atomic<unsigned long long> selfNanoseconds{0};
+	std::atomic<unsigned long long> allocations{0};
+};
+
+inline void add(std::atomic<unsigned long long> & a, unsigned long long v)
+{
+	a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+
+inline void addTo(Counters & c, const Slot & s)
+{
+	c.calls += s.calls.load(std::memory_order_relaxed);
+	c.bytes += s.bytes.load(std::memory_order_relaxed);
+	c.nanoseconds += s.nanoseconds.load(std::memory_order_relaxed);
+	c.selfNanoseconds += s.selfNanoseconds.load(std::memory_order_relaxed);
+	c.allocations += s.allocations.load(std::memory_order_relaxed);
+}
+
+inline void clear(Slot & s)
+{
+	s.calls.store(0, std::memory_order_relaxed);
+	s.bytes.store(0, std::memory_order_relaxed);
+	s.nanoseconds.store(0, std::memory_order_relaxed);
+	s.selfNanoseconds.store(0, std::memory_order_relaxed);
+	s.allocations.store(0, std::memory_order_relaxed);
+}
+
+// Slots of a thread, in chunks allocated on the first count of their types, so
+// that collect() never sees them move.
+class Table {
+public:
+	static const unsigned chunkTypes = 64;
+	static const unsigned maxChunks = 1024;
+
+	Table()
+	{
+		for (unsigned c = 0; c < maxChunks; c++) {
+			_chunks[c].store(0, std::memory_order_relaxed);
+		}
+	}
+
+	~Table()
+	{
+		for (unsigned c = 0; c < maxChunks; c++) {
+			delete _chunks[c].load(std::memory_order_relaxed);
+		}
+	}
+
+	Slot & slot(unsigned type, Operation op)
+	{
+		std::atomic<Chunk *> & chunk = _chunks[type / chunkTypes % maxChunks];
+		Chunk * c = chunk.load(std::memory_order_acquire);
+		if (!c) {
+			c = new Chunk();
+			chunk.store(c, std::memory_order_release);
+		}
+		return c->slots[type % chunkTypes][op];
+	}
+
+	void addTo(std::vector<TypeStats> & stats) const
+	{
+		for (size_t t = 0; t < stats.size(); t++) {
+			if (const Chunk * c = _chunks[t / chunkTypes % maxChunks].load(std::memory_order_acquire)) {
+				for (unsigned op = 0; op < OPERATIONS; op++) {
+					detail::addTo(stats[t].operations[op], c->slots[t % chunkTypes][op]);
+				}
+			}
+		}
+	}
+
+	void clear()
+	{
+		for (unsigned c = 0; c < maxChunks; c++) {
+			if (Chunk * chunk = _chunks[c].load(std::memory_order_acquire)) {
+				for (unsigned t = 0; t < chunkTypes; t++) {
+					for (unsigned op = 0; op < OPERATIONS; op++) {
+						detail::clear(chunk->slots[t][op]);
+					}
+				}
+			}
+		}
+	}
+
+private:
+	struct Chunk {
+		Slot slots[chunkTypes][OPERATIONS];
+	};
+
+	Table(const Table &);
+	Table & operator=(const Table &);
+
+	std::atomic<Chunk *> _chunks[maxChunks];
+};
+
+// Type names, tables of the running threads and counts of the ended ones.
+struct Registry {
+	std::mutex mutex;
+	std::vector<std::string> types;
+	std::vector<Table *> tables;
+	std::vector<TypeStats> ended;
+};
+
+// Never destroyed, threads may end after the static destructors.
+inline Registry & registry()
+{
+	static Registry * r = new Registry();
+	return *r;
+}
+
+class ThreadTable : public Table {
+public:
+	ThreadTable()
+	{
+		Registry & r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		r.tables.push_back(this);
+	}
+
+	~ThreadTable()
+	{
+		Registry & r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		r.ended.resize(r.types.size());
+		addTo(r.ended);
+		for (size_t i = 0; i < r.tables.size(); i++) {
+			if (r.tables[i] == this) {
+				r.tables.erase(r.tables.begin() + i);
+				break;
+			}
+		}
+	}
+};
+
+inline Table & table()
+{
+	thread_local ThreadTable t;
+	return t;
+}
+
+inline thread_local Scope * current = 0;
+
+inline thread_local unsigned long long allocations = 0;
+
+}
+
+// Index of the counters of type, a Type::fullPath, the same for every call.
+inline unsigned typeId(const char * type)
+{
+	detail::Registry & r = detail::registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	for (size_t i = 0; i < r.types.size(); i++) {
+		if (r.types[i] == type) {
+			return (unsigned)i;
+		}
+	}
+	r.types.push_back(type);
+	return (unsigned)r.types.size() - 1;
+}
+
+inline void countAllocation()
+{
+	detail::allocations++;
+}
+
+// Counts one call of a generated function, from its construction to its
+// destruction.
+class Scope {
+public:
+	Scope(unsigned type, Operation op, size_t offset = 0)
+		: _slot(detail::table().slot(type, op)), _parent(detail::current), _offset(offset), _nested(0),
+		  _allocations(detail::allocations), _start(std::chrono::steady_clock::now())
+	{
+		detail::current = this;
+	}
+
+	~Scope()
+	{
+		const unsigned long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count();
+		detail::add(_slot.calls, 1);
+		detail::add(_slot.nanoseconds, ns);
+		detail::add(_slot.selfNanoseconds, ns > _nested ? ns - _nested : 0);
+		detail::add(_slot.allocations, detail::allocations - _allocations);
+		if (_parent) {
+			_parent->_nested += ns;
+		}
+		detail::current = _parent;
+	}
+
+	// The parse started at the offset given to the constructor ends at offset.
+	void consumed(size_t offset)
+	{
+		detail::add(_slot.bytes, offset - _offset);
+	}
+
+private:
+	Scope(const Scope &);
+	Scope & operator=(const Scope &);
+
+	detail::Slot & _slot;
+	Scope * _parent;
+	size_t _offset;
+	unsigned long long _nested;
+	unsigned long long _allocations;
+	std::chrono::steady_clock::time_point _start;
+};
+
+// Counts of all the threads, by type in the order of their first count.
+inline std::vector<TypeStats> collect()
+{
+	detail::Registry & r = detail::registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	std::vector<TypeStats> stats(r.types.size());
+	for (size_t t = 0; t < stats.size(); t++) {
+		stats[t].type = r.types[t];
+		if (t < r.ended.size()) {
+			stats[t].operations[PARSE] = r.ended[t].operations[PARSE];
+			stats[t].operations[SERIALIZE] = r.ended[t].operations[SERIALIZE];
+		}
+	}
+	for (size_t i = 0; i < r.tables.size(); i++) {
+		r.tables[i]->addTo(stats);
+	}
+	return stats;
+}
+
+inline void reset()
+{
+	detail::Registry & r = detail::registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	r.ended.clear();
+	for (size_t i = 0; i < r.tables.size(); i++) {
+		r.tables[i]->clear();
+	}
+}
+
+// One line per counted type and operation, times in milliseconds.
+inline void dump(std::ostream & out)
+{
+	const std::vector<TypeStats> stats = collect();
+	int width = 4;
+	for (size_t t = 0; t < stats.size(); t++) {
+		width = stats[t].type.size() > (size_t)width ? (int)stats[t].type.size() : width;
+	}
+	char line[512];
+	std::snprintf(line, sizeof(line), "%-*s %-9s %12s %14s %12s %12s %12s\n", width, "type", "operation", "calls", "bytes", "total ms",
+	              "self ms", "allocations");
+	out << line;
+	for (size_t t = 0; t < stats.size(); t++) {
+		for (unsigned op = 0; op < OPERATIONS; op++) {
+			const Counters & c = stats[t].operations[op];
+			if (c.calls == 0) {
+				continue;
+			}
+			std::snprintf(line, sizeof(line), "%-*s %-9s %12llu %14llu %12.3f %12.3f %12llu\n", width, stats[t].type.c_str(),
+			              operationName((Operation)op), c.calls, c.bytes, c.nanoseconds / 1e6, c.selfNanoseconds / 1e6, c.allocations);
+			out << line;
+		}
+	}
+}
+
+// {"types":[{"type":..., "operation":"parse"|"serialize", "calls":..., "bytes":...,
+// "nanoseconds":..., "selfNanoseconds":..., "allocations":...}, ...]}
+inline void dumpJson(std::ostream & out)
+{
+	const std::vector<TypeStats> stats = collect();
+	out << "{\"types\":[";
+	bool first = true;
+	for (size_t t = 0; t < stats.size(); t++) {
+		for (unsigned op = 0; op < OPERATIONS; op++) {
+			const Counters & c = stats[t].operations[op];
+			if (c.calls == 0) {
+				continue;
+			}
+			out << (first ? "\n" : ",\n") << "{\"type\":\"" << stats[t].type << "\",\"operation\":\"" << operationName((Operation)op)
+			    << "\",\"calls\":" << c.calls << ",\"bytes\":" << c.bytes << ",\"nanoseconds\":" << c.nanoseconds
+			    << ",\"selfNanoseconds\":" << c.selfNanoseconds << ",\"allocations\":" << c.allocations << "}";
+			first = false;
+		}
+	}
+	out << "\n]}\n";
+}
+
+}
+}
+
+#ifdef CPPXB_STATS_NEW
+void * operator new(std::size_t n)
+{
+	cppxb::stats::countAllocation();
+	if (void * p = std::malloc(n ? n : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void * operator new(std::size_t n, std::align_val_t al)
+{
+	cppxb::stats::countAllocation();
+	const std::size_t a = (std::size_t)al;
+	if (void * p = std::aligned_alloc(a, (n + a - 1) / a * a)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void * p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void * p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void * p, std::align_val_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void * p, std::size_t, std::align_val_t) noexcept
+{
+	std::free(p);
+}
+#endif
+)cppXb";
@@ -0,0 +1,169 @@
+#include "Runtime.h"
+
+const char * const cppXbStringH = R"cppXb(#pragma once
+// cppXb string runtime, generated by cppXb.
+//
+// cppxb::xstring is the field type of xs:string values in view mode (-view).
+// It does not own its characters: it points into the document buffer given
+// to cppxb::Reader, into the ptree the value was parsed from, or into a
+// string supplied by the caller. That storage must stay alive and unchanged
+// for as long as the xstring is used. Text the reader had to reassemble
+// (split by comments or CDATA sections) is kept by the reader itself, so the
+// reader must then outlive the value as well.
+//
+// The raw characters still contain the entities of the document; they are
+// only decoded by str(), and only when the value actually contains one.
+#include <string>
+#include <string_view>
+#include <cstdlib>
+#include <ostream>
+
+namespace cppxb {
+
+inline void appendUtf8(unsigned long cp, std::string & out)
+{
+	if (cp < 0x80) {
+		out += (char)cp;
+	} else if (cp < 0x800) {
+		out += (char)(0xC0 | (cp >> 6));
+		out += (char)(0x80 | (cp & 0x3F));
+	} else if (cp < 0x10000) {
+		out += (char)(0xE0 | (cp >> 12));
+		out += (char)(0x80 | ((cp >> 6) & 0x3F));
+		out += (char)(0x80 | (cp & 0x3F));
+	} else {
+		out += (char)(0xF0 | (cp >> 18));
+		out += (char)(0x80 | ((cp >> 12) & 0x3F));
+		out += (char)(0x80 | ((cp >> 6) & 0x3F));
+		out += (char)(0x80 | (cp & 0x3F));
+	}
+}
+
+// Replaces the predefined and character entities of raw into out.
+inline void decode(std::string_view raw, std::string & out)
+{
+	size_t amp = raw.find('&');
+	if (amp == std::string_view::npos) {
+		out.assign(raw.data(), raw.size());
+		return;
+	}
+	out.assign(raw.data(), amp);
+	while (amp < raw.size()) {
+		const size_t semi = raw.find(';', amp);
+		if (semi == std::string_view::npos) {
+			out.append(raw.data() + amp, raw.size() - amp);
+			return;
+		}
+		const std::string_view ent = raw.substr(amp + 1, semi - amp - 1);
+		if (ent == "lt") {
+			out += '<';
+		} else if (ent == "gt") {
+			out += '>';
+		} else if (ent == "amp") {
+			out += '&';
+		} else if (ent == "quot") {
+			out += '"';
+		} else if (ent == "apos") {
+			out += '\'';
+		} else if (ent.size() > 1 && ent[0] == '#') {
+			const bool hex = ent[1] == 'x';
+			const std::string digits(ent.substr(hex ? 2 : 1));
+			appendUtf8(std::strtoul(digits.c_str(), 0, hex ? 16 : 10), out);
+		} else {
+			out.append(raw.data() + amp, semi + 1 - amp);
+		}
+		const size_t next = raw.find('&', semi + 1);
+		const size_t stop = (next == std::string_view::npos) ? raw.size() : next;
+		out.append(raw.data() + semi + 1, stop - semi - 1);
+		amp = stop;
+	}
+}
+
+class xstring {
+public:
+	xstring() : _escaped(false) {}
+
+	// Refers to an already decoded string.
+	xstring(std::string_view value) : _raw(value), _escaped(false) {}
+
+	xstring(const char * value) : _raw(value), _escaped(false) {}
+
+	xstring(const std::string & value) : _raw(value), _escaped(false) {}
+
+	// Refers to raw document text which may contain entities.
+	static xstring raw(std::string_view text)
+	{
+		xstring s;
+		s._raw = text;
+		s._escaped = text.find('&') != std::string_view::npos;
+		return s;
+	}
+
+	// Characters as found in the document.
+	std::string_view raw() const
+	{
+		return _raw;
+	}
+
+	// True when the value holds entities, str() then has to decode them.
+	bool escaped() const
+	{
+		return _escaped;
+	}
+
+	bool empty() const
+	{
+		return _raw.empty();
+	}
+
+	std::string str() const
+	{
+		std::string s;
+		str(s);
+		return s;
+	}
+
+	void str(std::string & out) const
+	{
+		if (_escaped) {
+			decode(_raw, out);
+		} else {
+			out.assign(_raw.data(), _raw.size());
+		}
+	}
+
+	bool operator==(std::string_view other) const
+	{
+		return _escaped ? str() == other : _raw == other;
+	}
+
+	bool operator!=(std::string_view other) const
+	{
+		return !(*this == other);
+	}
+
+	bool operator==(const xstring & other) const
+	{
+		return (_escaped || other._escaped) ? str() == other.str() : _raw == other._raw;
+	}
+
+	bool operator!=(const xstring & other) const
+	{
+		return !(*this == other);
+	}
+
+private:
+	std::string_view _raw;
+	bool _escaped;
+};
+
+inline std::ostream & operator<<(std::ostream & out, const xstring & s)
+{
+	if (s.escaped()) {
+		return out << s.str();
+	}
+	return out << s.raw();
+}
+
+}
+)cppXb";
@@ -0,0 +1,123 @@
+#include "Runtime.h"
+
+const char * const cppXbValidateH = R"cppXb(#pragma once
+// cppXb validation runtime, generated by cppXb.
+//
+// Generated parser::validate(std::string_view doc, const T *, cppxb::Validation &)
+// functions check a document against the schema of T in a single pass of a
+// cppxb::Reader, without building any value: required attributes and
+// elements, element occurrences (minOccurs and maxOccurs), enumeration values
+// and the lexical form of numbers and booleans. Elements the schema does not
+// allow where they are are violations, as is a root element other than the
+// top-level elements the schema declares with type T, when it declares any.
+// Every violation is recorded with its offset in the document and validation
+// goes on, except for malformed markup, mismatched end tags included, and
+// content other than comments and processing instructions after the root
+// element, which end it. The memory used does not depend on the
+// document: the reader's buffers are reused and the validation keeps the first
+// violations only, counting the others.
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "cppXbConvert.h"
+#include "cppXbReader.h"
+
+namespace cppxb {
+
+struct Violation {
+	size_t offset;
+	std::string message;
+};
+
+class Validation {
+public:
+	// Keeps the first limit violations.
+	explicit Validation(size_t limit = 100) : _limit(limit), _count(0) {}
+
+	bool valid() const
+	{
+		return _count == 0;
+	}
+
+	// Number of violations found, including those not kept.
+	size_t count() const
+	{
+		return _count;
+	}
+
+	const std::vector<Violation> & violations() const
+	{
+		return _violations;
+	}
+
+	void clear()
+	{
+		_violations.clear();
+		_count = 0;
+	}
+
+	void report(size_t offset, const std::string & message)
+	{
+		if (_violations.size() < _limit) {
+			_violations.push_back(Violation());
+			_violations.back().offset = offset;
+			_violations.back().message = message;
+		}
+		_count++;
+	}
+
+	// A required attribute or element is missing from the element at offset.
+	void missing(size_t offset, const char * kind, const char * name)
+	{
+		report(offset, std::string("missing ") + kind + " " + name);
+	}
+
+	// The element at offset holds count name elements, fewer than min.
+	void tooFew(size_t offset, const char * name, size_t count, size_t min)
+	{
+		report(offset, std::to_string(count) + " " + name + " elements, at least " + std::to_string(min) + " expected");
+	}
+
+	// The element r is positioned on is one more than max.
+	void tooMany(const Reader & r, size_t max)
+	{
+		report(r.tagOffset(), "more than " + std::to_string(max) + " " + std::string(r.name()) + " elements");
+	}
+
+	// The element r is positioned on is not allowed there.
+	void unexpected(const Reader & r)
+	{
+		report(r.tagOffset(), "unexpected element " + std::string(r.name()));
+	}
+
+	// value, an attribute value or the text of the current element of r, is
+	// not valid for name.
+	void invalid(const Reader & r, std::string_view value, std::string_view name)
+	{
+		const bool inDocument = value.data() >= r.document() && value.data() <= r.document() + r.offset();
+		report(inDocument ? value.data() - r.document() : r.tagOffset(),
+		       "invalid value '" + std::string(value) + "' for " + std::string(name));
+	}
+
+private:
+	size_t _limit;
+	size_t _count;
+	std::vector<Violation> _violations;
+};
+
+// Whether v is a valid lexical form of T: numbers and booleans must convert,
+// strings are always valid. The generated overloads check enumerations.
+template<typename T>
+bool validValue(Reader &, std::string_view v, const T *)
+{
+	if constexpr (std::is_arithmetic<T>::value) {
+		T t;
+		return convert(v, t);
+	} else {
+		return true;
+	}
+}
+
+}
+)cppXb";
@@ -0,0 +1,290 @@
+#include "Runtime.h"
+
+const char * const cppXbWriterH = R"cppXb(#pragma once
+// cppXb writer runtime, generated by cppXb.
+//
+// cppxb::Writer streams XML into a std::string, a std::ostream or a file
+// descriptor. Generated parser::write(const T &, cppxb::Writer &, name)
+// functions emit one element each, attributes first; values are escaped so
+// the output reads back through the generated parsers. Output to a stream or
+// a file descriptor goes through an internal buffer, flushed when it is full,
+// by flush() and by the destructor.
+//
+// The root element gets the XML declaration and the xmlns:xsi declaration
+// used by the xsi:type attributes of polymorphic values.
+#include <string>
+#include <string_view>
+#include <ostream>
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+#include "cppXbString.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+namespace cppxb {
+
+class Writer {
+public:
+	explicit Writer(std::string & out) : _out(&out), _stream(0), _fd(-1), _depth(0), _open(false), _inAttribute(false) {}
+
+	explicit Writer(std::ostream & out) : _out(&_buffer), _stream(&out), _fd(-1), _depth(0), _open(false), _inAttribute(false)
+	{
+		_buffer.reserve(bufferSize);
+	}
+
+	explicit Writer(int fd) : _out(&_buffer), _stream(0), _fd(fd), _depth(0), _open(false), _inAttribute(false)
+	{
+		_buffer.reserve(bufferSize);
+	}
+
+	~Writer()
+	{
+		try {
+			flush();
+		} catch (...) {
+		}
+	}
+
+	void start(std::string_view name)
+	{
+		closeStart();
+		if (_depth == 0) {
+			append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+		}
+		append("<");
+		append(name);
+		if (_depth == 0) {
+			append(" xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\"");
+		}
+		_open = true;
+		_depth++;
+	}
+
+	void end(std::string_view name)
+	{
+		_depth--;
+		if (_open) {
+			append("/>");
+			_open = false;
+		} else {
+			append("</");
+			append(name);
+			append(">");
+		}
+		if (_depth == 0) {
+			append("\n");
+			flush();
+		} else if (_out->size() >= bufferSize) {
+			flushBuffer();
+		}
+	}
+
+	template<typename T>
+	void attribute(std::string_view name, const T & value)
+	{
+		if (!_open) {
+			throw std::logic_error("cppxb::Writer: attribute " + std::string(name) + " written after content");
+		}
+		append(" ");
+		append(name);
+		append("=\"");
+		_inAttribute = true;
+		writeValue(*this, value);
+		_inAttribute = false;
+		append("\"");
+	}
+
+	// Element holding a single value as text.
+	template<typename T>
+	void element(std::string_view name, const T & value)
+	{
+		start(name);
+		closeStart();
+		writeValue(*this, value);
+		end(name);
+	}
+
+	// Appends element, the markup of a whole element taken from a document,
+	// when it is named name; returns false otherwise.
+	bool copy(std::string_view element, std::string_view name)
+	{
+		if (element.size() < name.size() + 3 || element.compare(1, name.size(), name) != 0) {
+			return false;
+		}
+		const char next = element[name.size() + 1];
+		if (next != '>' && next != '/' && next != ' ' && next != '\t' && next != '\n' && next != '\r') {
+			return false;
+		}
+		closeStart();
+		if (_depth == 0) {
+			append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+		}
+		append(element);
+		if (_depth == 0) {
+			append("\n");
+			flush();
+		} else if (_out->size() >= bufferSize) {
+			flushBuffer();
+		}
+		return true;
+	}
+
+	// Appends characters which are already valid XML.
+	void append(std::string_view raw)
+	{
+		_out->append(raw.data(), raw.size());
+	}
+
+	// Appends text, escaping what would not read back as is.
+	void escape(std::string_view text)
+	{
+		size_t done = 0;
+		for (size_t i = 0; i < text.size(); i++) {
+			const char * entity = 0;
+			switch (text[i]) {
+			case '&': entity = "&amp;"; break;
+			case '<': entity = "&lt;"; break;
+			case '>': entity = "&gt;"; break;
+			case '"': entity = "&quot;"; break;
+			case '\r': entity = "&#13;"; break;
+			case '\n': entity = _inAttribute ? "&#10;" : 0; break;
+			case '\t': entity = _inAttribute ? "&#9;" : 0; break;
+			}
+			if (entity) {
+				_out->append(text.data() + done, i - done);
+				_out->append(entity);
+				done = i + 1;
+			}
+		}
+		_out->append(text.data() + done, text.size() - done);
+	}
+
+	// Scratch string for values which have to be converted before being written.
+	std::string & scratch()
+	{
+		return _scratch;
+	}
+
+	void flush()
+	{
+		if (_out == &_buffer) {
+			flushBuffer();
+		}
+		if (_stream) {
+			_stream->flush();
+		}
+	}
+
+private:
+	static const size_t bufferSize = 64 * 1024;
+
+	Writer(const Writer &);
+	Writer & operator=(const Writer &);
+
+	void closeStart()
+	{
+		if (_open) {
+			append(">");
+			_open = false;
+		}
+	}
+
+	void flushBuffer()
+	{
+		if (_out != &_buffer || _buffer.empty()) {
+			return;
+		}
+		if (_stream) {
+			_stream->write(_buffer.data(), _buffer.size());
+			if (!*_stream) {
+				throw std::runtime_error("cppxb::Writer: cannot write to stream");
+			}
+		} else {
+			size_t done = 0;
+			while (done < _buffer.size()) {
+#if defined(__unix__) || defined(__APPLE__)
+				const ssize_t n = ::write(_fd, _buffer.data() + done, _buffer.size() - done);
+#else
+				const int n = ::_write(_fd, _buffer.data() + done, (unsigned int)(_buffer.size() - done));
+#endif
+				if (n <= 0) {
+					throw std::runtime_error("cppxb::Writer: cannot write to file descriptor");
+				}
+				done += n;
+			}
+		}
+		_buffer.clear();
+	}
+
+	std::string * _out;
+	std::ostream * _stream;
+	int _fd;
+	std::string _buffer;
+	std::string _scratch;
+	int _depth;
+	bool _open;
+	bool _inAttribute;
+};
+
+inline void writeValue(Writer & w, std::string_view v)
+{
+	w.escape(v);
+}
+
+inline void writeValue(Writer & w, const char * v)
+{
+	w.escape(v);
+}
+
+template<typename A>
+void writeValue(Writer & w, const std::basic_string<char, std::char_traits<char>, A> & v)
+{
+	w.escape(std::string_view(v.data(), v.size()));
+}
+
+inline void writeValue(Writer & w, const xstring & v)
+{
+	if (!v.escaped()) {
+		w.escape(v.raw());
+	} else {
+		v.str(w.scratch());
+		w.escape(w.scratch());
+	}
+}
+
+inline void writeValue(Writer & w, bool v)
+{
+	w.append(v ? "true" : "false");
+}
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type writeValue(Writer & w, T v)
+{
+	char buf[32];
+	const std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), v);
+	w.append(std::string_view(buf, r.ptr - buf));
+}
+
+// Shortest form reading back to the same value, INF, -INF and NaN as in XSD.
+template<typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type writeValue(Writer & w, T v)
+{
+	if (std::isnan(v)) {
+		w.append("NaN");
+	} else if (std::isinf(v)) {
+		w.append(v < 0 ? "-INF" : "INF");
+	} else {
+		char buf[64];
+		const std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), v);
+		w.append(std::string_view(buf, r.ptr - buf));
+	}
+}
+
+}
+)cppXb";
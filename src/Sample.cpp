@@ -0,0 +1,295 @@
+#include "Sample.h"
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <algorithm>
+#include <ostream>
+#include <stdexcept>
+
+using namespace std;
+
+// Optional and repeated elements below this depth only occur minOccurs times,
+// so that recursive types end.
+static const size_t optionalDepth = 16;
+static const size_t maxDepth = 64;
+static const size_t flushSize = 1 << 16;
+
+Sample::Sample(const vector<InterRep> & reps, const SampleOptions & options)
+	: reps(reps), options(options), out(0), bytes(0), elements(0)
+{
+}
+
+void Sample::write(const string & element, ostream & out)
+{
+	const Type * root = 0;
+	BOOST_FOREACH(const InterRep & rep, reps) {
+		map<string, string>::const_iterator itE = rep.elements.find(element);
+		if (itE == rep.elements.end()) {
+			continue;
+		}
+		BOOST_FOREACH(const InterRep & typeRep, reps) {
+			map<string, Type *>::const_iterator itT = typeRep.typesByNames.find(itE->second);
+			if (itT != typeRep.typesByNames.end()) {
+				root = itT->second;
+			}
+		}
+		if (!root) {
+			throw runtime_error("Element " + element + " has no complex type.");
+		}
+	}
+	if (!root) {
+		throw runtime_error("No top-level element " + element + ".");
+	}
+	this->out = &out;
+	buffer.clear();
+	bytes = 0;
+	elements = 0;
+	random.seed(options.seed);
+	put("<?xml version=\"1.0\" encoding=\"UTF-8\"?>");
+	writeElement(element, *root, 0, 0, 1);
+	put("\n");
+	flush();
+}
+
+void Sample::getAllFields(const Type & t, vector<Field const *> & fields) const
+{
+	if (t.pSuperType) {
+		getAllFields(*t.pSuperType, fields);
+	}
+	BOOST_FOREACH(const Field & f, t.fields) {
+		fields.push_back(&f);
+	}
+}
+
+void Sample::getAllChildTypes(const Type & t, vector<Type *> & types) const
+{
+	BOOST_FOREACH(Type * ct, t.pChildTypes) {
+		types.push_back(ct);
+		getAllChildTypes(*ct, types);
+	}
+}
+
+// Whether t holds, at any depth, an unbounded element.
+bool Sample::canGrow(const Type & t, vector<const Type *> & seen) const
+{
+	if (find(seen.begin(), seen.end(), &t) != seen.end()) {
+		return false;
+	}
+	seen.push_back(&t);
+	vector<Field const *> fields;
+	getAllFields(t, fields);
+	BOOST_FOREACH(const Field * f, fields) {
+		if (!f->isAttr && (f->maxOccurs < 0 || (f->pType && canGrow(*f->pType, seen)))) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Sample::canGrow(const Field & f) const
+{
+	vector<const Type *> seen;
+	return !f.isAttr && (f.maxOccurs < 0 || (f.pType && canGrow(*f.pType, seen)));
+}
+
+// Part of the target reached, from 0 to 1.
+double Sample::progress() const
+{
+	if (options.targetElements) {
+		return (double)elements / options.targetElements;
+	}
+	return options.targetBytes ? (double)bytes / options.targetBytes : 1;
+}
+
+bool Sample::coin()
+{
+	return uniform(0, 1) == 1;
+}
+
+long long Sample::uniform(long long min, long long max)
+{
+	return boost::random::uniform_int_distribution<long long>(min, max)(random);
+}
+
+// Occurrences of an element which does not grow the document.
+size_t Sample::count(const Field & f, size_t depth)
+{
+	if (depth >= optionalDepth || f.minOccurs == f.maxOccurs) {
+		return f.minOccurs;
+	}
+	if (f.maxOccurs == 1) {
+		return coin() ? 1 : 0;
+	}
+	return uniform(f.minOccurs, f.maxOccurs < 0 ? f.minOccurs + 4 : f.maxOccurs);
+}
+
+// Lexical form of a random value of a simple field, other types than the
+// numbers, booleans and dates giving words.
+string Sample::value(const Field & f)
+{
+	if (f.pEnum) {
+		return f.pEnum->values.empty() ? string() : f.pEnum->values[uniform(0, f.pEnum->values.size() - 1)];
+	}
+	const string & t = f.type;
+	if (t == "bool") {
+		return coin() ? "true" : "false";
+	}
+	long long min = 0, max = -1;
+	if (t == "char") {
+		min = -128;
+		max = 127;
+	} else if (t == "unsignedByte") {
+		max = 255;
+	} else if (t == "short") {
+		min = -32768;
+		max = 32767;
+	} else if (t == "unsignedShort") {
+		max = 65535;
+	} else if (t == "int" || t == "long") {
+		min = -1000000000;
+		max = 1000000000;
+	} else if (t == "unsignedInt" || t == "unsignedLong" || t == "nonNegativeInteger") {
+		max = 1000000000;
+	} else if (t == "positiveInteger") {
+		min = 1;
+		max = 1000000000;
+	} else if (t == "negativeInteger") {
+		min = -1000000000;
+		max = -1;
+	} else if (t == "nonPositiveInteger") {
+		min = -1000000000;
+	}
+	if (min <= max) {
+		return boost::lexical_cast<string>(uniform(min, max));
+	}
+	if (t == "double" || t == "float" || t == "decimal") {
+		return (boost::format("%.3f") % (uniform(-10000000, 10000000) / 1000.0)).str();
+	}
+	const string date = (boost::format("%04d-%02d-%02d") % uniform(1970, 2037) % uniform(1, 12) % uniform(1, 28)).str();
+	const string time = (boost::format("%02d:%02d:%02d") % uniform(0, 23) % uniform(0, 59) % uniform(0, 59)).str();
+	if (t == "date") {
+		return date;
+	} else if (t == "time") {
+		return time;
+	} else if (t == "dateTime") {
+		return date + "T" + time;
+	}
+	string w = words();
+	if (f.maxLength > 0 && w.size() > (size_t)f.maxLength) {
+		w.resize(f.maxLength);
+		//an entity is not cut
+		const size_t amp = w.rfind('&');
+		if (amp != string::npos && w.find(';', amp) == string::npos) {
+			w.resize(amp);
+		}
+	}
+	return w;
+}
+
+// One to three lowercase words, sometimes joined by an entity.
+string Sample::words()
+{
+	string s;
+	const long long n = uniform(1, 3);
+	for (long long i = 0; i < n; i++) {
+		if (i > 0) {
+			s += uniform(0, 15) == 0 ? " &amp; " : " ";
+		}
+		const long long length = uniform(3, 10);
+		for (long long k = 0; k < length; k++) {
+			s += (char)('a' + uniform(0, 25));
+		}
+	}
+	return s;
+}
+
+// The elements of t able to grow the document share the part [from, to) of
+// the target in turn: an unbounded one is repeated until its share is
+// reached, a complex one hands its share to its own elements.
+void Sample::writeElement(const string & name, const Type & declared, size_t depth, double from, double to)
+{
+	if (depth > maxDepth) {
+		throw runtime_error("Element " + name + " nests more than " + boost::lexical_cast<string>(maxDepth)
+		                    + " levels deep, a required element is recursive.");
+	}
+	const bool grows = to > from;
+	const Type * t = &declared;
+	vector<Type *> derived;
+	getAllChildTypes(declared, derived);
+	const long long pick = grows ? 0 : uniform(0, derived.size());
+	if (pick > 0) {
+		t = derived[pick - 1];
+	}
+	const string indent = "\n" + string(depth * 2, ' ');
+	elements++;
+	put(indent + "<" + name);
+	if (depth == 0) {
+		put(" xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\"");
+	}
+	//the parsers of a polymorphic type read its xsi:type, even for the type itself
+	if (!derived.empty()) {
+		put(" xsi:type=\"" + t->name + "\"");
+	}
+	vector<Field const *> fields, elts, growing;
+	getAllFields(*t, fields);
+	BOOST_FOREACH(const Field * f, fields) {
+		if (f->isAttr) {
+			if (!f->isOptionnal || coin()) {
+				put(" " + f->nodeName + "=\"" + value(*f) + "\"");
+			}
+		} else {
+			elts.push_back(f);
+			if (grows && canGrow(*f)) {
+				growing.push_back(f);
+			}
+		}
+	}
+	if (elts.empty()) {
+		put("/>");
+		return;
+	}
+	put(">");
+	const double share = growing.empty() ? 0 : (to - from) / growing.size();
+	size_t shared = 0;
+	BOOST_FOREACH(const Field * f, elts) {
+		const bool fGrows = find(growing.begin(), growing.end(), f) != growing.end();
+		const double fFrom = from + share * shared;
+		const double fTo = fFrom + share;
+		size_t n = count(*f, depth);
+		if (fGrows) {
+			shared++;
+			n = f->maxOccurs < 0 ? f->minOccurs : 1;
+		}
+		const bool repeat = fGrows && f->maxOccurs < 0;
+		for (size_t i = 0; i < n || (repeat && progress() < fTo); i++) {
+			if (!f->pType) {
+				elements++;
+				put(indent + "  <" + f->nodeName + ">" + value(*f) + "</" + f->nodeName + ">");
+			} else if (fGrows && !repeat) {
+				writeElement(f->nodeName, *f->pType, depth + 1, fFrom, fTo);
+			} else {
+				writeElement(f->nodeName, *f->pType, depth + 1, 0, 0);
+			}
+		}
+	}
+	put(indent + "</" + name + ">");
+}
+
+void Sample::put(const string & s)
+{
+	buffer += s;
+	bytes += s.size();
+	if (buffer.size() >= flushSize) {
+		flush();
+	}
+}
+
+void Sample::flush()
+{
+	out->write(buffer.data(), buffer.size());
+	buffer.clear();
+	if (!*out) {
+		throw runtime_error("Cannot write the sample document.");
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "InterRep.h"
+#include <boost/random/mersenne_twister.hpp>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+struct SampleOptions {
+
+	unsigned long long targetBytes;//repeated elements are added until the document reaches this size
+
+	unsigned long long targetElements;//or until it holds this many elements, when not 0
+
+	unsigned long long seed;//the same seed and schemas give the same document
+
+	SampleOptions() : targetBytes(1 << 20), targetElements(0), seed(1) {}
+};
+
+// Writes random instance documents of the parsed schemas, for load tests.
+// Occurrences, enumerations, optional attributes and elements and the types
+// derived from an element's type (given by xsi:type) are chosen at random,
+// the repeated elements able to grow the document sharing the target size.
+// The document is streamed, the memory used does not depend on its size.
+class Sample {
+public:
+	Sample(const std::vector<InterRep> & reps, const SampleOptions & options = SampleOptions());
+
+	// Writes a document rooted at the top-level element of the schemas.
+	void write(const std::string & element, std::ostream & out);
+
+private:
+	void getAllFields(const Type & t, std::vector<Field const *> & fields) const;
+	void getAllChildTypes(const Type & t, std::vector<Type *> & types) const;
+	bool canGrow(const Type & t, std::vector<const Type *> & seen) const;
+	bool canGrow(const Field & f) const;
+	double progress() const;
+	bool coin();
+	long long uniform(long long min, long long max);
+	size_t count(const Field & f, size_t depth);
+	std::string value(const Field & f);
+	std::string words();
+	void writeElement(const std::string & name, const Type & t, size_t depth, double from, double to);
+	void put(const std::string & s);
+	void flush();
+
+	const std::vector<InterRep> & reps;
+	SampleOptions options;
+	boost::random::mt19937_64 random;
+	std::ostream * out;
+	std::string buffer;
+	unsigned long long bytes;
+	unsigned long long elements;
+};
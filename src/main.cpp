@@ -1,11 +1,17 @@
 #include "Parsing.h"
 #include "Gen.h"
 #include "GenFlat.h"
+#include "Sample.h"
 #include <boost/filesystem.hpp>
 //#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/optional.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <atomic>
+#include <fstream>
 #include <iostream>
 #include <string>
+#include <thread>
 
 using namespace std;
 namespace fs = boost::filesystem;
@@ -13,6 +19,13 @@ string ns = "xsdgen";
 string outDirH = "gen/includes";
 string outDirC = "gen/src";
 bool recursive = false;
+bool flat = false;
+XsdNames xsdNames;
+unsigned parseThreads = 0;// 0 : one per core
+GenOptions options;
+string sampleElement;
+string sampleFile;
+SampleOptions sampleOptions;
 
 int fatal(const string & msg)
 {
@@ -31,19 +44,56 @@ void prepareOutDir(const fs::path & outPath)
 	}
 }
 
-void doParsing(const fs::path & path, vector<InterRep> & reps, vector<fs::path> & paths)
+void findFiles(const fs::path & path, vector<fs::path> & files)
 {
 	if (path.extension().string() == ".xsd") {
+		files.push_back(path);
+	} else if (recursive && fs::is_directory(path)) {
+		for (fs::directory_iterator dir(path); dir != fs::directory_iterator(); ++dir) {
+			findFiles(dir->path(), files);
+		}
+	}
+}
+
+// Parses the files not taken yet by another thread, next being the index of
+// the first one.
+void parseFiles(const vector<fs::path> & files, vector<InterRep> & reps, vector<boost::optional<string> > & errors,
+                atomic<size_t> & next)
+{
+	for (size_t i = next++; i < files.size(); i = next++) {
 		try {
-			cout << "Parsing " << path << endl;
-			reps.push_back(parseFile(path.string()));
-			paths.push_back(path);
+			reps[i] = parseFile(files[i].string(), xsdNames);
 		} catch ( const std::exception & e) {
-			cerr << "Error : " << e.what() << endl;
+			errors[i] = string(e.what());
 		}
-	} else if (recursive && fs::is_directory(path)) {
-		for (fs::directory_iterator dir(path); dir != fs::directory_iterator(); ++dir) {
-			doParsing(dir->path(), reps, paths);
+	}
+}
+
+// The files are parsed on parseThreads threads, their results being kept in
+// the order of the files so that the output is that of a serial parsing.
+void doParsing(const fs::path & path, vector<InterRep> & reps, vector<fs::path> & paths)
+{
+	vector<fs::path> files;
+	findFiles(path, files);
+	vector<InterRep> parsed(files.size());
+	vector<boost::optional<string> > errors(files.size());
+	atomic<size_t> next(0);
+	const size_t threadCount = min<size_t>(parseThreads ? parseThreads : max(thread::hardware_concurrency(), 1u), files.size());
+	vector<thread> threads;
+	for (size_t t = 1; t < threadCount; t++) {
+		threads.push_back(thread(parseFiles, cref(files), ref(parsed), ref(errors), ref(next)));
+	}
+	parseFiles(files, parsed, errors, next);
+	for (size_t t = 0; t < threads.size(); t++) {
+		threads[t].join();
+	}
+	for (size_t i = 0; i < files.size(); i++) {
+		cout << "Parsing " << files[i] << endl;
+		if (errors[i]) {
+			cerr << "Error : " << *errors[i] << endl;
+		} else {
+			reps.push_back(std::move(parsed[i]));
+			paths.push_back(files[i]);
 		}
 	}
 }
@@ -54,6 +104,7 @@ void doGeneration(Gen * gen, const vector<InterRep> & reps, const vector<fs::pat
 	try {
 		prepareOutDir(outPathH);
 		prepareOutDir(outPathC);
+		gen->genRuntime(outPathH.string());
 	} catch ( const std::exception & e) {
 		cerr << "Error : " << e.what() << endl;
 	}
@@ -70,6 +121,40 @@ void doGeneration(Gen * gen, const vector<InterRep> & reps, const vector<fs::pat
 	}
 }
 
+int doSample(const vector<InterRep> & reps)
+{
+	cout << "Writing sample document : " << sampleFile << endl;
+	ofstream out(sampleFile.c_str(), ios::binary);
+	if (!out) {
+		return fatal("Cannot write to : " + sampleFile);
+	}
+	try {
+		Sample sample(reps, sampleOptions);
+		sample.write(sampleElement, out);
+	} catch (const std::exception & e) {
+		return fatal(string("Error : ") + e.what());
+	}
+	return 0;
+}
+
+// Byte count with an optional k, M or G suffix.
+unsigned long long parseSize(const string & value)
+{
+	const size_t digits = value.find_first_not_of("0123456789");
+	unsigned long long size = boost::lexical_cast<unsigned long long>(value.substr(0, digits));
+	const string suffix = digits == string::npos ? "" : value.substr(digits);
+	if (suffix == "k") {
+		size <<= 10;
+	} else if (suffix == "M") {
+		size <<= 20;
+	} else if (suffix == "G") {
+		size <<= 30;
+	} else if (!suffix.empty()) {
+		throw boost::bad_lexical_cast();
+	}
+	return size;
+}
+
 int help()
 {
 	cout << "#################################################" << endl;
@@ -84,6 +169,37 @@ int help()
 	cout << "  -r  : looks recursively in xsd folder" << endl;
 	cout << "  -f  : generate a flat representation (with no virtual inheritance)" << endl;
 	cout << "  -xs : use <xs:...> instead of <xsd:...>" << endl;
+	cout << "  -j threads : number of threads parsing the xsd files (default: one per core)" << endl;
+	cout << "  -pull : also generate parsers reading the xml text directly (no property_tree)" << endl;
+	cout << "  -view : xs:string fields are cppxb::xstring views into the parsed document, which" << endl;
+	cout << "          must outlive the generated objects (entities are decoded on access)" << endl;
+	cout << "  -pmr : std::pmr strings and vectors, types are allocator aware and can be parsed into" << endl;
+	cout << "         a std::pmr::memory_resource arena" << endl;
+	cout << "  -snapshot : also generate parser::snapshot, writing offset based images of the types, and" << endl;
+	cout << "              view classes reading the fields of a mapped image in place" << endl;
+	cout << "  -lazy : also generate lazy::T types, parsed by the pull parsers, whose complex elements" << endl;
+	cout << "          are only parsed the first time they are read" << endl;
+	cout << "  -dirty : types record the element they were pulled from and the fields changed through" << endl;
+	cout << "           their set_ and edit_ accessors, parser::write copies unchanged values verbatim" << endl;
+	cout << "  -stats : generated parse, put and write functions count their calls, bytes read, time and" << endl;
+	cout << "           allocations by type, see cppXbStats.h" << endl;
+	cout << "  -pod : with -f, strings, optional values and unbounded sequences are stored inline with fixed" << endl;
+	cout << "         capacities, the types being standard layout and trivially copyable (memcpy, shared" << endl;
+	cout << "         memory); base type fields are copied into the derived types, -columns is ignored" << endl;
+	cout << "  -bound Type.field capacity : with -pod, items of this sequence or chars of this string" << endl;
+	cout << "  -maxLength capacity : with -pod, chars of the strings without an xs:maxLength facet" << endl;
+	cout << "  -maxOccurs capacity : with -pod, items of the sequences with maxOccurs=\"unbounded\"" << endl;
+	cout << "  -stream Type.field : pull parsers hand the items of this repeated field to Type::visitor" << endl;
+	cout << "                       (also set by cppxb:stream=\"true\" on the xsd element)" << endl;
+	cout << "  -columns Type : unbounded sequences of Type, a type of attributes and simple elements, are" << endl;
+	cout << "                  stored by column as Type::columns (also set by cppxb:columns=\"true\" on the" << endl;
+	cout << "                  xsd complexType)" << endl;
+	cout << "  -sample element file : instead of generating code, writes to file a random document valid" << endl;
+	cout << "                        against the xsds, rooted at this top-level element" << endl;
+	cout << "  -sampleSize size : approximate size of the sample document, with a k, M or G suffix" << endl;
+	cout << "                     (default: 1M)" << endl;
+	cout << "  -sampleCount count : approximate element count of the sample document, instead of its size" << endl;
+	cout << "  -seed seed : seed of the sample document, the same seed giving the same document (default: 1)" << endl;
 	cout << " last parameter : xsd file or xsds folder" << endl;
 	return 0;
 }
@@ -130,9 +246,89 @@ int main(int argc, char ** argv)
 			} else if (arg == "-r") {
 				recursive = true;
 			} else if (arg == "-xs") {
-				setXSDNameSpace("xs:");
-			} else if (arg == "-f" && !gen) {
-				gen.reset(new GenFlat());
+				xsdNames = XsdNames("xs:");
+			} else if (arg == "-j") {
+				if (i == argc - 1) {
+					return fatal("Missing value for parameter 'j'.");
+				}
+				i++;
+				try {
+					parseThreads = boost::lexical_cast<unsigned>(argv[i]);
+				} catch (const boost::bad_lexical_cast &) {
+					return fatal("Invalid value '" + string(argv[i]) + "' for parameter 'j'.");
+				}
+			} else if (arg == "-f") {
+				flat = true;
+			} else if (arg == "-pull") {
+				options.pullParser = true;
+			} else if (arg == "-view") {
+				options.stringViews = true;
+			} else if (arg == "-pmr") {
+				options.allocators = true;
+			} else if (arg == "-snapshot") {
+				options.snapshots = true;
+			} else if (arg == "-lazy") {
+				options.lazyTypes = true;
+			} else if (arg == "-dirty") {
+				options.dirtyTracking = true;
+			} else if (arg == "-stats") {
+				options.statistics = true;
+			} else if (arg == "-pod") {
+				options.pod = true;
+			} else if (arg == "-bound") {
+				if (i + 2 >= argc - 1) {
+					return fatal("Missing Type.field and capacity values for parameter 'bound'.");
+				}
+				const string field = argv[++i];
+				try {
+					options.bounds[field] = boost::lexical_cast<int>(argv[++i]);
+				} catch (const boost::bad_lexical_cast &) {
+					return fatal("Invalid capacity '" + string(argv[i]) + "' for parameter 'bound'.");
+				}
+			} else if (arg == "-maxLength" || arg == "-maxOccurs") {
+				if (i == argc - 1) {
+					return fatal("Missing value for parameter '" + arg.substr(1) + "'.");
+				}
+				i++;
+				try {
+					(arg == "-maxLength" ? options.defaultLength : options.defaultOccurs) = boost::lexical_cast<int>(argv[i]);
+				} catch (const boost::bad_lexical_cast &) {
+					return fatal("Invalid value '" + string(argv[i]) + "' for parameter '" + arg.substr(1) + "'.");
+				}
+			} else if (arg == "-stream") {
+				if (i == argc - 1) {
+					return fatal("Missing Type.field value for parameter 'stream'.");
+				}
+				i++;
+				options.streamedFields.insert(argv[i]);
+			} else if (arg == "-columns") {
+				if (i == argc - 1) {
+					return fatal("Missing Type value for parameter 'columns'.");
+				}
+				i++;
+				options.columnTypes.insert(argv[i]);
+			} else if (arg == "-sample") {
+				if (i + 2 >= argc - 1) {
+					return fatal("Missing element and file values for parameter 'sample'.");
+				}
+				sampleElement = argv[++i];
+				sampleFile = argv[++i];
+			} else if (arg == "-sampleSize" || arg == "-sampleCount" || arg == "-seed") {
+				if (i == argc - 1) {
+					return fatal("Missing value for parameter '" + arg.substr(1) + "'.");
+				}
+				i++;
+				try {
+					if (arg == "-sampleSize") {
+						sampleOptions.targetBytes = parseSize(argv[i]);
+					} else if (arg == "-sampleCount") {
+						sampleOptions.targetElements = boost::lexical_cast<unsigned long long>(argv[i]);
+					} else {
+						sampleOptions.seed = boost::lexical_cast<unsigned long long>(argv[i]);
+					}
+				} catch (const boost::bad_lexical_cast &) {
+					return fatal("Invalid value '" + string(argv[i]) + "' for parameter '" + arg.substr(1) + "'.");
+				}
 			} else if (arg == "-h") {
 				return help();
 			}
@@ -141,12 +337,27 @@ int main(int argc, char ** argv)
 	cout << "Namespace : " << ns << endl;
 	cout << "Headers Out Dir : " << outDirH << endl;
 	cout << "Sources Out Dir : " << outDirC << endl;
-	if (gen) {
+	if (flat) {
+		gen.reset(new GenFlat(options));
 		cout << "Generating simplified flat representation" << endl;
 	} else {
-		gen.reset(new Gen());
+		gen.reset(new Gen(options));
 		cout << "Generating full virtual inheritance representation" << endl;
 	}
+	if (options.pullParser) {
+		cout << "Generating pull parsers" << endl;
+	} else if (!options.streamedFields.empty()) {
+		return fatal("Streamed fields need the pull parsers (-pull).");
+	} else if (options.lazyTypes) {
+		return fatal("Lazy types need the pull parsers (-pull).");
+	} else if (options.dirtyTracking) {
+		return fatal("Dirty tracking needs the pull parsers (-pull).");
+	}
+	if (options.pod && !flat) {
+		return fatal("Pod types need the flat representation (-f).");
+	} else if (options.pod && (options.allocators || options.stringViews || options.snapshots || options.lazyTypes || options.dirtyTracking)) {
+		return fatal("Pod types hold their values inline, they cannot be used with -pmr, -view, -snapshot, -lazy or -dirty.");
+	}
 
 	fs::path srcPath(src);
 	vector<InterRep> reps;
@@ -156,6 +367,9 @@ int main(int argc, char ** argv)
 	if (reps.size() != paths.size() || reps.empty()) {
 		return fatal("Invalid source : " + src);
 	}
+	if (!sampleElement.empty()) {
+		return doSample(reps);
+	}
 	doGeneration(gen.get(), reps, paths, fs::path(outDirH), fs::path(outDirC));
 	return 0;
 }
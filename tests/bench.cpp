@@ -0,0 +1,498 @@
+#include "gen/includes/Test.h"
+#include "gen/includes/TestIncl.h"
+#include "gen/includes/cppXbReader.h"
+#include "gen/includes/cppXbConvert.h"
+#include "gen/includes/cppXbWriter.h"
+#include "gen/includes/cppXbBinary.h"
+#include "gen/includes/cppXbParallel.h"
+#include "gen/includes/cppXbValidate.h"
+#include "gen/includes/cppXbPatch.h"
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+using namespace boost::property_tree;
+
+string readFile(const string & filePath)
+{
+	ifstream in(filePath.c_str(), ios::binary);
+	if (!in) {
+		throw runtime_error("no file " + filePath);
+	}
+	ostringstream content;
+	content << in.rdbuf();
+	return content.str();
+}
+
+// Repeats the first <child1> element of doc so the document holds copies of it.
+string scaleDocument(const string & doc, size_t copies)
+{
+	const size_t begin = doc.find("<child1");
+	const size_t end = doc.find("</child1>", begin) + 9;
+	const string child = doc.substr(begin, end - begin) + "\n";
+	string scaled = doc.substr(0, begin);
+	for (size_t i = 0; i < copies; i++) {
+		scaled += child;
+	}
+	scaled += doc.substr(end);
+	return scaled;
+}
+
+// Length of a string field, a std::string or with -view a cppxb::xstring.
+template<typename S>
+size_t length(const S & s)
+{
+	return s.size();
+}
+
+inline size_t length(const cppxb::xstring & s)
+{
+	return s.raw().size();
+}
+
+template<typename F>
+void measure(const string & label, size_t bytes, size_t iterations, F f)
+{
+	f();
+	const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; i++) {
+		f();
+	}
+	const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	cout << "  " << left << setw(28) << label << right << fixed << setprecision(3)
+	     << setw(10) << seconds * 1e3 / iterations << " ms/doc "
+	     << setw(10) << bytes * iterations / seconds / 1e6 << " MB/s" << endl;
+}
+
+void benchParse(const string & doc, size_t iterations)
+{
+	cout << "document: " << doc.size() << " bytes, " << iterations << " iterations" << endl;
+	measure("property_tree + parse", doc.size(), iterations, [&]() {
+		ptree pt;
+		istringstream in(doc);
+		xml_parser::read_xml(in, pt);
+		tst::testDefinition test;
+		tst::parser::parse(pt.get_child("test"), test);
+	});
+	measure("pull parse", doc.size(), iterations, [&]() {
+		cppxb::Reader reader(doc);
+		tst::testDefinition test;
+		tst::parser::parse(reader, test);
+	});
+}
+
+// Speedup of parse_parallel over the single threaded pull parser.
+void benchParallel(const string & doc, size_t iterations)
+{
+	cout << "parallel pull parse, " << doc.size() << " bytes" << endl;
+	double single = 0;
+	const unsigned threads[] = { 0, 1, 2, 4, 8, 16, 32 };
+	for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+		const unsigned n = threads[i];
+		const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (size_t j = 0; j < iterations; j++) {
+			cppxb::Reader reader(doc);
+			tst::testDefinition test;
+			if (n == 0) {
+				tst::parser::parse(reader, test);
+			} else {
+				tst::parser::parse_parallel(reader, test, n);
+			}
+		}
+		const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count() / iterations;
+		if (n == 0) {
+			single = seconds;
+		}
+		cout << "  " << left << setw(28) << (n == 0 ? string("parse") : "parse_parallel x" + to_string(n)) << right << fixed
+		     << setprecision(3) << setw(10) << seconds * 1e3 << " ms/doc " << setw(10) << single / seconds << " speedup" << endl;
+	}
+}
+
+// Many small documents: one at a time, then batches reusing their threads.
+void benchBatch(const string & doc, size_t count, size_t iterations)
+{
+	cout << "batch of " << count << " documents of " << doc.size() << " bytes" << endl;
+	const vector<string_view> docs(count, string_view(doc));
+	measure("property_tree + parse", doc.size() * count, iterations, [&]() {
+		for (size_t i = 0; i < count; i++) {
+			ptree pt;
+			istringstream in(doc);
+			xml_parser::read_xml(in, pt);
+			tst::testDefinition test;
+			tst::parser::parse(pt.get_child("test"), test);
+		}
+	});
+	measure("pull parse", doc.size() * count, iterations, [&]() {
+		for (size_t i = 0; i < count; i++) {
+			cppxb::Reader reader(docs[i]);
+			tst::testDefinition test;
+			tst::parser::parse(reader, test);
+		}
+	});
+	const unsigned threads[] = { 1, 2, 4, 8, 16, 32 };
+	for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+		cppxb::Batch batch(threads[i]);
+		vector< cppxb::Parsed<tst::testDefinition> > results;
+		measure("parse_batch x" + to_string(threads[i]), doc.size() * count, iterations, [&]() {
+			tst::parser::parse_batch(batch, docs.data(), docs.size(), results);
+		});
+	}
+}
+
+// Parsing the root attributes only, the children being skipped.
+void benchMask(const string & doc, size_t iterations)
+{
+	tst::testDefinition::mask attributes;
+	attributes.set(attributes.F_strAttr).set(attributes.F_enumAttr);
+	measure("masked parse, attributes", doc.size(), iterations, [&]() {
+		cppxb::Reader reader(doc);
+		tst::testDefinition test;
+		tst::parser::parse(reader, test, attributes);
+		if (test.strAttr.empty()) {
+			throw runtime_error("no strAttr");
+		}
+	});
+}
+
+// Validating a document against parsing it.
+void benchValidate(const string & doc, size_t iterations)
+{
+	cppxb::Validation validation;
+	measure("validate", doc.size(), iterations, [&]() {
+		validation.clear();
+		if (!tst::parser::validate(doc, (tst::testDefinition *)0, validation)) {
+			throw runtime_error(validation.violations().front().message);
+		}
+	});
+}
+
+// Throughput of the character class searches alone, splitting the document
+// at names and whitespace, and of the pull parser with each implementation.
+void benchScan(const string & doc, size_t iterations)
+{
+	const char * const levels[] = { "scalar", "SSE2", "AVX2" };
+	const cppxb::scan::Level best = cppxb::scan::detect();
+	cout << "scan, " << doc.size() << " bytes" << endl;
+	for (int level = cppxb::scan::SCALAR; level <= best; level++) {
+		cppxb::scan::level = (cppxb::scan::Level)level;
+		size_t tokens = 0;
+		const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (size_t i = 0; i < iterations; i++) {
+			const char * end = doc.data() + doc.size();
+			for (const char * p = doc.data(); p < end; tokens++) {
+				p = cppxb::scan::find<cppxb::scan::NameEnd>(p, end);
+				p = cppxb::scan::skip<cppxb::scan::Space>(p, end);
+				p += (p < end);
+			}
+		}
+		const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		cout << "  " << left << setw(28) << string("tokens, ") + levels[level] << right << fixed << setprecision(3)
+		     << setw(10) << doc.size() * iterations / seconds / 1e9 << " GB/s " << setw(10) << tokens / iterations << " tokens" << endl;
+		measure(string("pull parse, ") + levels[level], doc.size(), iterations, [&]() {
+			cppxb::Reader reader(doc);
+			tst::testDefinition test;
+			tst::parser::parse(reader, test);
+		});
+	}
+	cppxb::scan::level = best;
+}
+
+#ifdef CPPXB_LAZY
+// Reading the root attributes only, then the whole value.
+void benchLazy(const string & doc, size_t iterations)
+{
+	measure("pull parse, attributes", doc.size(), iterations, [&]() {
+		cppxb::Reader reader(doc);
+		tst::testDefinition test;
+		tst::parser::parse(reader, test);
+		if (test.strAttr.empty()) {
+			throw runtime_error("no strAttr");
+		}
+	});
+	measure("lazy parse, attributes", doc.size(), iterations, [&]() {
+		cppxb::Reader reader(doc);
+		tst::lazy::testDefinition test;
+		tst::parser::parse(reader, test);
+		if (test.strAttr().empty()) {
+			throw runtime_error("no strAttr");
+		}
+	});
+	measure("lazy parse, whole value", doc.size(), iterations, [&]() {
+		cppxb::Reader reader(doc);
+		tst::lazy::testDefinition test;
+		tst::parser::parse(reader, test);
+		if (test.value().child1.empty()) {
+			throw runtime_error("no child1");
+		}
+	});
+}
+#endif
+
+void benchWrite(const string & doc, size_t iterations)
+{
+	cppxb::Reader reader(doc);
+	tst::testDefinition test;
+	tst::parser::parse(reader, test);
+	measure("put + write_xml", doc.size(), iterations, [&]() {
+		ptree pt;
+		tst::parser::put(test, pt, "test");
+		ostringstream out;
+		xml_parser::write_xml(out, pt);
+	});
+	measure("cppxb::Writer", doc.size(), iterations, [&]() {
+		string out;
+		cppxb::Writer w(out);
+		tst::parser::write(test, w, "test");
+	});
+}
+
+void benchBinary(const string & doc, size_t iterations)
+{
+	cppxb::Reader reader(doc);
+	tst::testDefinition test;
+	tst::parser::parse(reader, test);
+	string data;
+	tst::parser::encode(test, data);
+	cout << "binary: " << data.size() << " bytes for " << doc.size() << " bytes of xml" << endl;
+	measure("xml write + pull parse", doc.size(), iterations, [&]() {
+		string out;
+		{
+			cppxb::Writer w(out);
+			tst::parser::write(test, w, "test");
+		}
+		cppxb::Reader r(out);
+		tst::testDefinition copy;
+		tst::parser::parse(r, copy);
+	});
+	measure("binary encode + decode", doc.size(), iterations, [&]() {
+		string out;
+		tst::parser::encode(test, out);
+		tst::testDefinition copy;
+		tst::parser::decode(out, copy);
+	});
+}
+
+// Bringing a copy up to date after one attribute changed: sending the patch against
+// sending the whole value in binary.
+void benchPatch(const string & doc, size_t iterations)
+{
+	cppxb::Reader reader(doc);
+	tst::testDefinition test;
+	tst::parser::parse(reader, test);
+	tst::testDefinition changed = test;
+	changed.child1[changed.child1.size() / 2].childStrAtt = "changed";
+	cppxb::Patch patch;
+	tst::parser::diff(test, changed, patch);
+	string data;
+	patch.encode(data);
+	cout << "patch: " << data.size() << " bytes, " << patch.edits.size() << " edits" << endl;
+	tst::testDefinition copy = test;
+	measure("binary encode + decode", doc.size(), iterations, [&]() {
+		string out;
+		tst::parser::encode(changed, out);
+		tst::parser::decode(out, copy);
+	});
+	measure("diff + apply", doc.size(), iterations, [&]() {
+		cppxb::Patch p;
+		tst::parser::diff(test, changed, p);
+		tst::parser::apply(copy, p);
+	});
+	measure("equality", doc.size(), iterations, [&]() {
+		if (copy != changed) {
+			cout << "copy not up to date" << endl;
+		}
+	});
+}
+
+#ifdef CPPXB_DIRTY
+// Writing a document back after one change: encoding every value against copying the
+// unchanged ones verbatim.
+void benchDirty(const string & doc, size_t iterations)
+{
+	cppxb::Reader reader(doc);
+	tst::testDefinition test;
+	tst::parser::parse(reader, test);
+	test.edit_child1()[test.child1.size() / 2].set_childStrAtt("changed");
+	string data;
+	tst::parser::encode(test, data);
+	tst::testDefinition decoded;
+	tst::parser::decode(data, decoded);
+	measure("write, all values", doc.size(), iterations, [&]() {
+		string out;
+		cppxb::Writer w(out);
+		tst::parser::write(decoded, w, "test");
+	});
+	measure("write, changed values", doc.size(), iterations, [&]() {
+		string out;
+		cppxb::Writer w(out);
+		tst::parser::write(test, w, "test");
+	});
+}
+#endif
+
+#ifdef CPPXB_COLUMNS
+// A polygon of points stored by column: parsing it and summing one field, read
+// from its column and from the vector of point2d the columns replace.
+void benchColumns(size_t points, size_t iterations)
+{
+	string doc = "<polygon>";
+	for (size_t i = 0; i < points; i++) {
+		doc += "<point x=\"" + to_string(i) + ".5\" y=\"" + to_string(i * 2) + "\"/>";
+	}
+	doc += "</polygon>";
+	tst::polygon polygon;
+	measure("pull parse, columns", doc.size(), iterations, [&]() {
+		cppxb::Reader reader(doc);
+		tst::parser::parse(reader, polygon);
+	});
+	vector<tst::point2d> rows;
+	for (const tst::point2d::columns::const_row & p : polygon.point) {
+		rows.push_back(p.value());
+	}
+	double sum = 0;
+	measure("sum x, columns", doc.size(), iterations * 100, [&]() {
+		sum += accumulate(polygon.point.x.begin(), polygon.point.x.end(), 0.0);
+	});
+	measure("sum x, vector of point2d", doc.size(), iterations * 100, [&]() {
+		for (const tst::point2d & p : rows) {
+			sum += p.x;
+		}
+	});
+	if (sum == 0) {
+		cerr << "no points" << endl;
+	}
+}
+#endif
+
+#ifdef CPPXB_SNAPSHOT
+// Time to first field: parsing the whole document against opening its snapshot.
+void benchSnapshot(const string & doc, size_t iterations)
+{
+	cppxb::Reader reader(doc);
+	tst::testDefinition test;
+	tst::parser::parse(reader, test);
+	string image;
+	tst::parser::snapshot(test, image);
+	cout << "snapshot: " << image.size() << " bytes for " << doc.size() << " bytes of xml" << endl;
+	size_t sink = 0;
+	measure("pull parse, last child1", doc.size(), iterations, [&]() {
+		cppxb::Reader r(doc);
+		tst::testDefinition copy;
+		tst::parser::parse(r, copy);
+		sink += length(copy.child1.back().subChild3Elems[2]);
+	});
+	measure("snapshot view, last child1", doc.size(), iterations, [&]() {
+		const cppxb::Snapshot snapshot((std::string_view(image)));
+		const tst::view::testDefinition v(snapshot);
+		sink += v.child1()[v.child1().size() - 1].subChild3Elems()[2].size();
+	});
+	if (sink == 0) {
+		cout << endl;
+	}
+}
+#endif
+
+// str2testEnum as generated before the length and character switch.
+static const string legacyTestEnumVals[] = { "TE_VAL1", "TE_VAL2", "TE_VAL3" };
+tst::testEnum legacyStr2testEnum(const string & str)
+{
+	const size_t t = distance(legacyTestEnumVals, find(legacyTestEnumVals, legacyTestEnumVals + 3, str));
+	if (t >= 3) {
+		throw domain_error("Invalid Enum Val " + str);
+	}
+	return (tst::testEnum)t;
+}
+
+void benchEnum(size_t iterations)
+{
+	const string values[] = { "TE_VAL1", "TE_VAL2", "TE_VAL3" };
+	const size_t count = 1000;
+	size_t bytes = 0;
+	for (size_t i = 0; i < count; i++) {
+		bytes += values[i % 3].size();
+	}
+	volatile unsigned sink = 0;
+	cout << "enum conversion: " << count << " values, " << iterations << " iterations" << endl;
+	measure("linear findEnumVal", bytes, iterations, [&]() {
+		for (size_t i = 0; i < count; i++) {
+			sink = sink + legacyStr2testEnum(values[i % 3]);
+		}
+	});
+	measure("generated switch", bytes, iterations, [&]() {
+		for (size_t i = 0; i < count; i++) {
+			sink = sink + tst::str2testEnum(values[i % 3]);
+		}
+	});
+}
+
+void benchConvert(size_t iterations)
+{
+	const string values[] = { "1.2", "-56.7", "78.9", "123456789", "2.5e-3" };
+	const size_t count = 1000;
+	size_t bytes = 0;
+	for (size_t i = 0; i < count; i++) {
+		bytes += values[i % 5].size();
+	}
+	ptree nodes[5];
+	for (size_t i = 0; i < 5; i++) {
+		nodes[i].data() = values[i];
+	}
+	volatile double sink = 0;
+	cout << "double conversion: " << count << " values, " << iterations << " iterations" << endl;
+	measure("ptree get_value", bytes, iterations, [&]() {
+		for (size_t i = 0; i < count; i++) {
+			sink = sink + nodes[i % 5].get_value<double>();
+		}
+	});
+	measure("cppxb::convert", bytes, iterations, [&]() {
+		for (size_t i = 0; i < count; i++) {
+			double d = 0;
+			cppxb::convert(values[i % 5], d);
+			sink = sink + d;
+		}
+	});
+}
+
+int main(int argc, char ** argv)
+{
+	const size_t copies = (argc > 1) ? atoi(argv[1]) : 10000;
+	try {
+		const string doc = readFile("test.xml");
+		benchParse(doc, 10000);
+		benchParse(scaleDocument(doc, copies), 10);
+		benchParallel(scaleDocument(doc, copies * 10), 5);
+		benchBatch(doc, copies, 10);
+		benchMask(scaleDocument(doc, copies), 10);
+		benchValidate(scaleDocument(doc, copies), 10);
+		benchScan(scaleDocument(doc, copies), 10);
+#ifdef CPPXB_LAZY
+		benchLazy(scaleDocument(doc, copies), 10);
+#endif
+		benchWrite(scaleDocument(doc, copies), 10);
+		benchBinary(scaleDocument(doc, copies), 10);
+		benchPatch(scaleDocument(doc, copies), 10);
+#ifdef CPPXB_COLUMNS
+		benchColumns(copies * 10, 10);
+#endif
+#ifdef CPPXB_DIRTY
+		benchDirty(scaleDocument(doc, copies), 10);
+#endif
+#ifdef CPPXB_SNAPSHOT
+		benchSnapshot(scaleDocument(doc, copies), 10);
+#endif
+		benchEnum(10000);
+		benchConvert(1000);
+	} catch (const std::exception & e) {
+		cerr << e.what() << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -1,12 +1,17 @@
 #!/bin/bash
 
-../bin/cppXb -ns tst -r -xs xsd
+../bin/cppXb -xs -sample test sample.xml -sampleSize 1M -r xsd || exit 1
 
-cd build
+for flags in "" "-view" "-pmr" "-snapshot" "-lazy" "-stats" "-dirty" "-view -dirty" "-columns point2d"; do
+	../bin/cppXb -ns tst -pull -stream testDefinition.child1 $flags -r -xs xsd || exit 1
 
-make
+	(cd build && make) || exit 1
 
-cd ..
+	./bin/cppXbTest || exit 1
+done
 
-./bin/cppXbTest
+../bin/cppXb -ns tst -f -pod -maxLength 32 -maxOccurs 8 -pull -r -xs xsd || exit 1
 
+(cd build && make cppXbPodTest) || exit 1
+
+./bin/cppXbPodTest || exit 1
@@ -0,0 +1,145 @@
+#include "gen/includes/Test.h"
+#include "gen/includes/TestIncl.h"
+#include "gen/includes/cppXbPatch.h"
+#include "gen/includes/cppXbReader.h"
+#include "gen/includes/cppXbWriter.h"
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <type_traits>
+
+// Tests of the -f -pod types, generated by gen-build-run.sh with
+// -maxLength 32 -maxOccurs 8.
+
+using namespace std;
+using namespace boost::property_tree;
+
+static_assert(is_trivially_copyable<tst::testDefinition>::value && is_standard_layout<tst::testDefinition>::value,
+              "testDefinition is not a pod");
+static_assert(is_trivially_copyable<tst::chid2Definition>::value && is_standard_layout<tst::chid2Definition>::value,
+              "chid2Definition is not a pod");
+
+string readFile(const string & filePath)
+{
+	ifstream in(filePath.c_str(), ios::binary);
+	ostringstream content;
+	content << in.rdbuf();
+	return content.str();
+}
+
+void parseTree(const string & doc, tst::testDefinition & test)
+{
+	ptree pt;
+	istringstream in(doc);
+	xml_parser::read_xml(in, pt);
+	tst::parser::parse(pt.get_child("test"), test);
+}
+
+// Both parsers read test.xml the same, a memcpy copy and the written
+// document being equal to the parsed value.
+bool checkRoundTrip(const string & doc)
+{
+	cppxb::Reader reader(doc);
+	tst::testDefinition test;
+	tst::parser::parse(reader, test);
+	tst::testDefinition testTree;
+	parseTree(doc, testTree);
+	if (test != testTree || test.child1.size() != 1 || !test.child2 || test.child2->shapes.shape.size() != 3
+	        || test.strAttr.view() != "test string") {
+		cerr << "pull parser result differs from property_tree parser" << endl;
+		return false;
+	}
+	tst::testDefinition copy;
+	memcpy(&copy, &test, sizeof(copy));
+	if (copy != test) {
+		cerr << "memcpy copy differs" << endl;
+		return false;
+	}
+	string written;
+	{
+		cppxb::Writer w(written);
+		tst::parser::write(copy, w, "test");
+	}
+	cppxb::Reader writtenReader(written);
+	tst::testDefinition reread;
+	tst::parser::parse(writtenReader, reread);
+	if (reread != test) {
+		cerr << "written document read back differs" << endl;
+		return false;
+	}
+	return true;
+}
+
+// A patch setting the optional strAttrOpt to another value applies.
+bool checkPatch(const string & doc)
+{
+	cppxb::Reader reader(doc);
+	tst::testDefinition from;
+	tst::parser::parse(reader, from);
+	from.strAttrOpt.emplace() = "hello";
+	tst::testDefinition to = from;
+	to.strAttrOpt.emplace() = "world, longer";
+	cppxb::Patch patch;
+	tst::parser::diff(from, to, patch);
+	tst::parser::apply(from, patch);
+	if (patch.edits.size() != 1 || from != to) {
+		cerr << "optional value changed to another one not patched" << endl;
+		return false;
+	}
+	return true;
+}
+
+// Both parsers reject doc, a value over its capacity, as a document error.
+bool checkRejected(const string & doc, const char * what)
+{
+	try {
+		cppxb::Reader reader(doc);
+		tst::testDefinition test;
+		tst::parser::parse(reader, test);
+		cerr << what << " accepted by the pull parser" << endl;
+		return false;
+	} catch (const cppxb::parse_error & e) {
+		if (e.offset() == 0) {
+			cerr << what << " rejected without offset" << endl;
+			return false;
+		}
+	}
+	try {
+		tst::testDefinition test;
+		parseTree(doc, test);
+		cerr << what << " accepted by the property_tree parser" << endl;
+		return false;
+	} catch (const ptree_bad_data &) {
+	}
+	return true;
+}
+
+bool checkOverflows()
+{
+	const string attrs = " longAttr=\"1\" boolAttr=\"true\" dblAttr=\"1.5\" enumAttr=\"TE_VAL1\"";
+	const string longString = "<test strAttr=\"" + string(33, 'x') + "\"" + attrs + "/>";
+	string children;
+	for (int i = 0; i < 9; i++) {
+		children += "<child1 childStrAtt=\"c\"><subChild3Elems>a</subChild3Elems><subChild3Elems>b</subChild3Elems>"
+		            "<subChild3Elems>c</subChild3Elems></child1>";
+	}
+	const string manyChildren = "<test strAttr=\"s\"" + attrs + ">" + children + "</test>";
+	return checkRejected(longString, "string over its xs:maxLength") && checkRejected(manyChildren, "elements over maxOccurs");
+}
+
+int main(int , char **)
+{
+	try {
+		const string doc = readFile("test.xml");
+		if (!checkRoundTrip(doc) || !checkPatch(doc) || !checkOverflows()) {
+			return 1;
+		}
+	} catch (const std::exception & e) {
+		cerr << e.what() << endl;
+		return 1;
+	}
+	return 0;
+}
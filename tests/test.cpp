@@ -1,13 +1,75 @@
 #include "gen/includes/Test.h"
 #include "gen/includes/TestIncl.h"
+#include "gen/includes/cppXbReader.h"
+#include "gen/includes/cppXbConvert.h"
+#include "gen/includes/cppXbWriter.h"
+#include "gen/includes/cppXbBinary.h"
+#include "gen/includes/cppXbParallel.h"
+#include "gen/includes/cppXbValidate.h"
+#include "gen/includes/cppXbPatch.h"
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/xml_parser.hpp>
 #include <boost/foreach.hpp>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <thread>
 
 using namespace std;
 using namespace boost::property_tree;
 
+// Heap allocations made since the start of the program.
+static atomic<size_t> allocations(0);
+
+void * operator new(size_t n)
+{
+	allocations++;
+#ifdef CPPXB_STATS
+	cppxb::stats::countAllocation();
+#endif
+	if (void * p = malloc(n ? n : 1)) {
+		return p;
+	}
+	throw bad_alloc();
+}
+
+void * operator new(size_t n, align_val_t al)
+{
+	allocations++;
+#ifdef CPPXB_STATS
+	cppxb::stats::countAllocation();
+#endif
+	const size_t a = (size_t)al;
+	if (void * p = aligned_alloc(a, (n + a - 1) / a * a)) {
+		return p;
+	}
+	throw bad_alloc();
+}
+
+void operator delete(void * p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void * p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete(void * p, align_val_t) noexcept
+{
+	free(p);
+}
+
+void operator delete(void * p, size_t, align_val_t) noexcept
+{
+	free(p);
+}
+
 void printTree(const ptree & pt, const string & indent = string())
 {
 	ptree::const_iterator end = pt.end();
@@ -30,14 +92,162 @@ void printTest(const tst::testDefinition & test)
 	}
 }
 
+// test.xml holds a polygon, a regularPolygon deriving from polygon and an ellipsoid.
+bool checkShapes(const tst::testDefinition & test)
+{
+	if (!test.child2 || test.child2->shapes.shape.size() != 3) {
+		cerr << "missing shapes" << endl;
+		return false;
+	}
+	const tst::abstractShape & polygon = *test.child2->shapes.shape[0];
+	const tst::abstractShape & regular = *test.child2->shapes.shape[1];
+	const tst::abstractShape & ellipsoid = *test.child2->shapes.shape[2];
+	if (!polygon.as_polygon() || polygon.as_regularPolygon() || polygon.as_ellipsoid()
+	        || !regular.as_polygon() || !regular.as_regularPolygon() || regular.as_ellipsoid()
+	        || ellipsoid.as_polygon() || ellipsoid.as_regularPolygon() || !ellipsoid.as_ellipsoid()) {
+		cerr << "wrong shape types" << endl;
+		return false;
+	}
+	if (regular.as_polygon()->point.size() != 4 || regular.as_regularPolygon()->sideLength != 2.5) {
+		cerr << "wrong regularPolygon content" << endl;
+		return false;
+	}
+	double sumX = 0;
+	size_t diagonal = 0;
+#ifdef CPPXB_COLUMNS
+	// point2d is stored by column (-columns point2d)
+	const tst::point2d::columns & points = regular.as_polygon()->point;
+	BOOST_FOREACH(double x, points.x) {
+		sumX += x;
+	}
+	BOOST_FOREACH(const tst::point2d::columns::const_row & p, points) {
+		diagonal += p.y - p.x == 1 ? 1 : 0;
+	}
+	const tst::point2d first = points[0].value();
+	const bool secondLabel = points.has_label[1];
+#else
+	const auto & points = regular.as_polygon()->point;
+	BOOST_FOREACH(const tst::point2d & p, points) {
+		sumX += p.x;
+		diagonal += p.y - p.x == 1 ? 1 : 0;
+	}
+	const tst::point2d & first = points[0];
+	const bool secondLabel = (bool)points[1].label;
+#endif
+	if (sumX != 16 || diagonal != 4 || !first.label || *first.label != string_view("start") || secondLabel || first.y != 8) {
+		cerr << "wrong points" << endl;
+		return false;
+	}
+	return true;
+}
 
-ptree loadTest(tst::testDefinition & test, const string & filePath)
+bool checkEnums()
+{
+	const tst::testEnum values[] = { tst::TESTENUM_TE_VAL1, tst::TESTENUM_TE_VAL2, tst::TESTENUM_TE_VAL3 };
+	BOOST_FOREACH(tst::testEnum v, values) {
+		if (tst::str2testEnum(tst::testEnum2str(v)) != v) {
+			cerr << "enum " << tst::testEnum2str(v) << " does not convert back" << endl;
+			return false;
+		}
+	}
+	const char * invalids[] = { "", "TE_VAL", "TE_VAL4", "te_val1", "TE_VAL10" };
+	BOOST_FOREACH(const char * invalid, invalids) {
+		try {
+			tst::str2testEnum(invalid);
+			cerr << "invalid enum value '" << invalid << "' accepted" << endl;
+			return false;
+		} catch (const std::domain_error &) {
+		}
+	}
+	return true;
+}
+
+template<typename T>
+bool checkConvert(const char * value, bool valid, T expected = T())
+{
+	T t = T();
+	if (cppxb::convert(value, t) != valid || (valid && t != expected && !(std::isnan((double)expected) && std::isnan((double)t)))) {
+		cerr << "wrong conversion of '" << value << "'" << endl;
+		return false;
+	}
+	return true;
+}
+
+bool checkConversions()
+{
+	const double inf = std::numeric_limits<double>::infinity();
+	return checkConvert<bool>("true", true, true) && checkConvert<bool>(" 0 ", true, false)
+	       && checkConvert<bool>("1", true, true) && checkConvert<bool>("TRUE", false)
+	       && checkConvert<bool>("yes", false) && checkConvert<bool>("", false)
+	       && checkConvert<int>("+12", true, 12) && checkConvert<int>("-0", true, 0)
+	       && checkConvert<int>("\n -2147483648\t", true, -2147483647 - 1) && checkConvert<int>("2147483648", false)
+	       && checkConvert<int>("12a", false) && checkConvert<int>("1.0", false) && checkConvert<int>("+-1", false)
+	       && checkConvert<int>("", false) && checkConvert<long>("123456789", true, 123456789L)
+	       && checkConvert<signed char>("-128", true, -128) && checkConvert<signed char>("128", false)
+	       && checkConvert<double>("123.456", true, 123.456) && checkConvert<double>(".5", true, 0.5)
+	       && checkConvert<double>("5.", true, 5.0) && checkConvert<double>("-1.5E-3", true, -1.5e-3)
+	       && checkConvert<double>("+1e3", true, 1e3) && checkConvert<double>("INF", true, inf)
+	       && checkConvert<double>("-INF", true, -inf) && checkConvert<double>("NaN", true, std::nan(""))
+	       && checkConvert<double>("inf", false) && checkConvert<double>("nan", false)
+	       && checkConvert<double>("0x1p3", false) && checkConvert<double>("1e400", false)
+	       && checkConvert<double>("1,5", false) && checkConvert<double>("", false);
+}
+
+// Both parsers must reject a document missing the required strAttr attribute.
+bool checkMissingAttribute()
+{
+	const string doc = "<test longAttr=\"1\" boolAttr=\"true\" dblAttr=\"1.5\" enumAttr=\"TE_VAL1\"/>";
+	try {
+		ptree pt;
+		istringstream in(doc);
+		xml_parser::read_xml(in, pt);
+		tst::testDefinition test;
+		tst::parser::parse(pt.get_child("test"), test);
+		cerr << "missing strAttr accepted by the property_tree parser" << endl;
+		return false;
+	} catch (const ptree_bad_path &) {
+	}
+	try {
+		cppxb::Reader reader(doc);
+		tst::testDefinition test;
+		tst::parser::parse(reader, test);
+		cerr << "missing strAttr accepted by the pull parser" << endl;
+		return false;
+	} catch (const cppxb::parse_error &) {
+	}
+	return true;
+}
+
+// The pull parser rejects end tags not closing the open element, whether it
+// reads or skips that element.
+bool checkEndTags()
+{
+	const string attrs = "<test strAttr=\"s\" longAttr=\"1\" boolAttr=\"true\" dblAttr=\"1.5\" enumAttr=\"TE_VAL1\">";
+	const string docs[] = {
+		attrs + "<child1 childStrAtt=\"c\"></test></child1>",
+		attrs + "<unknown><inner></unknown></inner></test>",
+		attrs + "</tes>",
+	};
+	BOOST_FOREACH(const string & doc, docs) {
+		try {
+			cppxb::Reader reader(doc);
+			tst::testDefinition test;
+			tst::parser::parse(reader, test);
+			cerr << "mismatched end tag accepted: " << doc << endl;
+			return false;
+		} catch (const cppxb::parse_error &) {
+		}
+	}
+	return true;
+}
+
+// pt holds the strings test refers to when generated with -view.
+bool loadTest(tst::testDefinition & test, ptree & pt, const string & filePath)
 {
-	ptree pt;
 	ifstream tstStr(filePath.c_str());
 	if (!tstStr) {
 		cerr << "no file " << filePath << endl;
-		return pt;
+		return false;
 	}
 	xml_parser::read_xml(tstStr, pt);
 
@@ -45,28 +255,972 @@ ptree loadTest(tst::testDefinition & test, const string & filePath)
 		tst::parser::parse(pt.get_child("test"), test);
 	} catch (const std::runtime_error & e) {
 		cerr << e.what() << endl;
-		return ptree();
+		return false;
+	}
+	return true;
+}
+
+struct Child1Counter : public tst::testDefinition::visitor {
+	size_t count;
+	Child1Counter() : count(0) {}
+	void on_child1(tst::child1Definition & item)
+	{
+		count++;
+	}
+};
+
+bool loadTestPull(tst::testDefinition & test, const cppxb::MappedFile & doc, Child1Counter * counter = 0)
+{
+	try {
+		cppxb::Reader reader(doc.view());
+		reader.setVisitor<tst::testDefinition::visitor>(counter);
+		tst::parser::parse(reader, test);
+	} catch (const std::runtime_error & e) {
+		cerr << e.what() << endl;
+		return false;
+	}
+	return true;
+}
+
+// Document with count child1 items, their text split by a comment so the
+// views handed out for it are copies kept by the reader.
+string parallelDocument(size_t count, size_t invalidItem)
+{
+	string doc = "<test strAttr=\"s\" longAttr=\"1\" boolAttr=\"true\" dblAttr=\"1.5\" enumAttr=\"TE_VAL1\">\n";
+	for (size_t i = 0; i < count; i++) {
+		const string n = to_string(i);
+		doc += (i == invalidItem) ? "<child1>" : "<child1 childStrAtt=\"item " + n + "\">";
+		doc += "<subChild3Elems>first<!-- split -->" + n + "</subChild3Elems><subChild3Elems/><subChild3Elems>third</subChild3Elems></child1>\n";
+	}
+	return doc + "<child2 id=\"c\"><shapes><shape xsi:type=\"polygon\"><point x=\"0\" y=\"0\"/></shape></shapes>"
+	       "<position x=\"1\" y=\"2\"/></child2></test>\n";
+}
+
+// Parsing into a value holding a previous document replaces its optional
+// elements.
+bool checkReparse()
+{
+	const string first = parallelDocument(0, string::npos);
+	string second = first;
+	second.replace(second.find("x=\"1\""), 5, "x=\"3\"");
+	tst::testDefinition test;
+	cppxb::Reader firstReader(first);
+	tst::parser::parse(firstReader, test);
+	cppxb::Reader secondReader(second);
+	tst::parser::parse(secondReader, test);
+	if (!test.child2 || test.child2->position.x != 3) {
+		cerr << "optional child2 not replaced by a second parse" << endl;
+		return false;
+	}
+	return true;
+}
+
+// parse_parallel gives the result of parse, and the error of the first
+// invalid item.
+bool checkParallel()
+{
+	const string doc = parallelDocument(1000, string::npos);
+	cppxb::Reader reader(doc);
+	tst::testDefinition test;
+	tst::parser::parse(reader, test);
+	ptree expected;
+	tst::parser::put(test, expected, "test");
+	const unsigned threads[] = { 1, 3, 8 };
+	BOOST_FOREACH(unsigned n, threads) {
+		cppxb::Reader parallelReader(doc);
+		tst::testDefinition parallel;
+		tst::parser::parse_parallel(parallelReader, parallel, n);
+		ptree actual;
+		tst::parser::put(parallel, actual, "test");
+		if (parallel.child1.size() != 1000 || actual != expected) {
+			cerr << "parse_parallel on " << n << " threads differs from parse" << endl;
+			return false;
+		}
+	}
+	const string invalid = parallelDocument(1000, 700);
+	size_t offset = 0;
+	try {
+		cppxb::Reader invalidReader(invalid);
+		tst::parser::parse(invalidReader, test);
+	} catch (const cppxb::parse_error & e) {
+		offset = e.offset();
+	}
+	try {
+		cppxb::Reader invalidReader(invalid);
+		tst::parser::parse_parallel(invalidReader, test, 4);
+		cerr << "invalid item accepted by parse_parallel" << endl;
+		return false;
+	} catch (const cppxb::parse_error & e) {
+		if (offset == 0 || e.offset() != offset) {
+			cerr << "parse_parallel error at offset " << e.offset() << ", parse at " << offset << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// parse_batch gives the result of parse for each document, an invalid one
+// only failing its own result, and a batch can be reused.
+bool checkBatch(string_view valid, const ptree & expected)
+{
+	const string invalid = parallelDocument(10, 3);
+	vector<string_view> docs;
+	for (size_t i = 0; i < 200; i++) {
+		docs.push_back(i % 7 == 3 ? string_view(invalid) : valid);
+	}
+	cppxb::Batch batch(3);
+	vector< cppxb::Parsed<tst::testDefinition> > results;
+	for (int pass = 0; pass < 2; pass++) {
+		tst::parser::parse_batch(batch, docs.data(), docs.size(), results);
+		if (results.size() != docs.size()) {
+			cerr << "parse_batch gave " << results.size() << " results for " << docs.size() << " documents" << endl;
+			return false;
+		}
+		for (size_t i = 0; i < docs.size(); i++) {
+			if (i % 7 == 3) {
+				if (results[i] || results[i].offset == 0) {
+					cerr << "invalid document " << i << " of the batch was accepted" << endl;
+					return false;
+				}
+				continue;
+			}
+			ptree actual;
+			if (results[i]) {
+				tst::parser::put(results[i].value, actual, "test");
+			}
+			if (actual != expected) {
+				cerr << "document " << i << " of the batch differs from parse: " << results[i].error << endl;
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// A masked parse only reads the selected fields, without allocating for the
+// skipped ones, and only checks the selected required fields.
+bool checkMask(string_view doc)
+{
+	tst::testDefinition::mask attributes;
+	attributes.set(attributes.F_longAttr).set(attributes.F_enumAttr);
+	cppxb::Reader reader(doc);
+	tst::testDefinition test;
+	const size_t before = allocations;
+	tst::parser::parse(reader, test, attributes);
+	if (allocations != before) {
+		cerr << "masked parse made " << allocations - before << " allocations" << endl;
+		return false;
+	}
+	if (test.longAttr != 123456789 || test.enumAttr != tst::TESTENUM_TE_VAL2 || !test.child1.empty() || test.child2) {
+		cerr << "wrong masked parse" << endl;
+		return false;
+	}
+	tst::chid2Definition::mask position;
+	position.set(position.F_position);
+	tst::testDefinition::mask nested;
+	nested.set(nested.F_child2).child2 = &position;
+	cppxb::Reader nestedReader(doc);
+	tst::testDefinition child2Only;
+	tst::parser::parse(nestedReader, child2Only, nested);
+	if (!child2Only.child2 || !child2Only.child2->shapes.shape.empty() || child2Only.child2->position.x != 56.7) {
+		cerr << "wrong nested masked parse" << endl;
+		return false;
+	}
+	const string missing = "<test longAttr=\"1\" boolAttr=\"true\" dblAttr=\"1.5\" enumAttr=\"TE_VAL1\"/>";
+	cppxb::Reader missingReader(missing);
+	tst::parser::parse(missingReader, test, attributes);
+	try {
+		tst::testDefinition::mask strAttr;
+		strAttr.set(strAttr.F_strAttr);
+		cppxb::Reader strAttrReader(missing);
+		tst::parser::parse(strAttrReader, test, strAttr);
+		cerr << "missing selected strAttr accepted" << endl;
+		return false;
+	} catch (const cppxb::parse_error &) {
+	}
+	return true;
+}
+
+// Validation accepts the valid documents without allocating once its reader
+// is warm, and reports every violation of an invalid one with its offset.
+bool checkValidate(string_view valid)
+{
+	cppxb::Validation validation;
+	if (!tst::parser::validate(valid, (tst::testDefinition *)0, validation)) {
+		cerr << "valid document rejected: " << validation.violations().front().message << endl;
+		return false;
+	}
+	const string repeated = parallelDocument(1000, string::npos);
+	cppxb::Reader reader(repeated);
+	tst::parser::validate(reader, (tst::testDefinition *)0, validation);
+	reader.reset(repeated.data(), repeated.data() + repeated.size());
+	const size_t before = allocations;
+	tst::parser::validate(reader, (tst::testDefinition *)0, validation);
+	if (allocations != before || !validation.valid()) {
+		cerr << "validation made " << allocations - before << " allocations" << endl;
+		return false;
+	}
+	const string invalid =
+	    "<test strAttr=\"s\" longAttr=\"12x\" boolAttr=\"maybe\" enumAttr=\"TE_VAL9\">\n"
+	    "<child1 childStrAtt=\"a\"><subChild3Elems>x</subChild3Elems></child1>\n"
+	    "<child2 id=\"c\"><shapes><shape xsi:type=\"circle\"/><shape xsi:type=\"polygon\"/></shapes>"
+	    "<position x=\"1\" y=\"oops\"/></child2>\n"
+	    "<child2 id=\"d\"><shapes/><position x=\"1\" y=\"2\"/></child2>\n"
+	    "</test>\n";
+	const pair<size_t, string> expected[] = {
+		make_pair(invalid.find("12x"), string("invalid value '12x' for longAttr")),
+		make_pair(invalid.find("maybe"), string("invalid value 'maybe' for boolAttr")),
+		make_pair(invalid.find("TE_VAL9"), string("invalid value 'TE_VAL9' for enumAttr")),
+		make_pair(invalid.find("<child1"), string("1 subChild3Elems elements, at least 3 expected")),
+		make_pair(invalid.find("circle"), string("invalid value 'circle' for xsi:type")),
+		make_pair(invalid.find("<shape xsi:type=\"polygon"), string("missing element point")),
+		make_pair(invalid.find("oops"), string("invalid value 'oops' for y")),
+		make_pair(invalid.find("<child2 id=\"d"), string("more than 1 child2 elements")),
+		make_pair((size_t)0, string("missing attribute dblAttr")),
+	};
+	const size_t count = sizeof(expected) / sizeof(expected[0]);
+	validation.clear();
+	if (tst::parser::validate(invalid, (tst::testDefinition *)0, validation) || validation.count() != count) {
+		cerr << "validation found " << validation.count() << " violations instead of " << count << endl;
+		return false;
+	}
+	for (size_t i = 0; i < count; i++) {
+		const cppxb::Violation & v = validation.violations()[i];
+		if (v.offset != expected[i].first || v.message != expected[i].second) {
+			cerr << "violation '" << v.message << "' at " << v.offset << " instead of '" << expected[i].second << "' at "
+			     << expected[i].first << endl;
+			return false;
+		}
+	}
+	cppxb::Validation firstTwo(2);
+	tst::parser::validate(invalid, (tst::testDefinition *)0, firstTwo);
+	cppxb::Validation truncated;
+	tst::parser::validate(invalid.substr(0, invalid.find("<child2")), (tst::testDefinition *)0, truncated);
+	if (firstTwo.violations().size() != 2 || firstTwo.count() != count
+	        || truncated.violations().back().message.find("unexpected end of document") == string::npos) {
+		cerr << "violations not limited, or malformed document not reported" << endl;
+		return false;
+	}
+	const string small = parallelDocument(1, string::npos);
+	const size_t child2 = small.find("<child2");
+	const pair<string, string> rejected[] = {
+		make_pair(small.substr(0, small.find("</child1>")) + "</test></child1>", string("mismatched end tag")),
+		make_pair(small + " trailing <garbage", string("content after the root element")),
+		make_pair("<other" + small.substr(5, small.rfind("</test>") - 5) + "</other>", string("unexpected element other")),
+		make_pair(small.substr(0, child2) + "<unknown><a/></unknown>" + small.substr(child2), string("unexpected element unknown")),
+	};
+	for (size_t i = 0; i < sizeof(rejected) / sizeof(rejected[0]); i++) {
+		const pair<string, string> & doc = rejected[i];
+		cppxb::Validation v;
+		if (tst::parser::validate(doc.first, (tst::testDefinition *)0, v) || v.violations().front().message.find(doc.second) == string::npos) {
+			cerr << "'" << doc.second << "' not reported" << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+template<typename C>
+bool checkScanClass(const char * name, const string & buffer)
+{
+	const char * end = buffer.data() + buffer.size();
+	for (const char * p = buffer.data(); p <= end; p++) {
+		if (cppxb::scan::find<C>(p, end) != cppxb::scan::findScalar<C, true>(p, end)
+		        || cppxb::scan::skip<C>(p, end) != cppxb::scan::findScalar<C, false>(p, end)) {
+			cerr << name << " search at level " << cppxb::scan::level << " differs from the scalar one at offset "
+			     << p - buffer.data() << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// The vector searches stop where the scalar ones do, from any offset of
+// random buffers made of runs of markup, whitespace and other characters.
+bool checkScan()
+{
+	const char alphabet[] = "<>/=\"' \t\n\r&a\x80";
+	const cppxb::scan::Level best = cppxb::scan::detect();
+	bool ok = true;
+	srand(17);
+	for (int i = 0; i < 300 && ok; i++) {
+		string buffer(rand() % 200, 'a');
+		for (size_t k = 0; k < buffer.size();) {
+			const char c = alphabet[rand() % (sizeof(alphabet) - 1)];
+			for (int run = 1 + rand() % 40; run > 0 && k < buffer.size(); run--) {
+				buffer[k++] = c;
+			}
+		}
+		for (int level = cppxb::scan::SCALAR; level <= best && ok; level++) {
+			cppxb::scan::level = (cppxb::scan::Level)level;
+			ok = checkScanClass<cppxb::scan::Space>("Space", buffer)
+			     && checkScanClass<cppxb::scan::NameEnd>("NameEnd", buffer)
+			     && checkScanClass<cppxb::scan::TagMarkup>("TagMarkup", buffer);
+		}
+	}
+	cppxb::scan::level = best;
+	return ok;
+}
+
+// Copy of doc with random runs of whitespace in its tags and between its
+// elements, and random string attribute values, so that names, whitespace
+// and values cross the 16 and 32 byte blocks of the vector searches.
+string fuzzDocument(const string & doc)
+{
+	const char spaces[] = " \t\n\r";
+	string fuzzed;
+	bool inTag = false;
+	for (size_t i = 0; i < doc.size();) {
+		const char c = doc[i];
+		if (inTag && (c == '"' || c == '\'')) {
+			const size_t close = doc.find(c, i + 1);
+			const size_t name = fuzzed.find_last_of(spaces) + 1;
+			const string attribute = fuzzed.substr(name, fuzzed.find('=', name) - name);
+			if (attribute == "strAttr" || attribute == "childStrAtt") {
+				fuzzed += c;
+				for (int n = rand() % 70; n > 0; n--) {
+					fuzzed += (rand() % 10 == 0) ? "&amp;" : string(1, "ab c"[rand() % 4]);
+				}
+				fuzzed += c;
+			} else {
+				fuzzed.append(doc, i, close + 1 - i);
+			}
+			i = close + 1;
+		} else if (isspace((unsigned char)c)) {
+			size_t end = i;
+			while (end < doc.size() && isspace((unsigned char)doc[end])) {
+				end++;
+			}
+			if (inTag || (!fuzzed.empty() && fuzzed.back() == '>' && end < doc.size() && doc[end] == '<')) {
+				for (int n = (inTag ? 1 : 0) + rand() % 40; n > 0; n--) {
+					fuzzed += spaces[rand() % 4];
+				}
+			} else {
+				fuzzed.append(doc, i, end - i);
+			}
+			i = end;
+		} else {
+			if (c == '<') {
+				inTag = true;
+			} else if (c == '>') {
+				inTag = false;
+			}
+			fuzzed += c;
+			i++;
+		}
+	}
+	return fuzzed;
+}
+
+// Malformed copy of doc: two end tags following each other swapped (kind 0),
+// an end tag cut before its '>' (1) or a stray '<' before a tag (2).
+string breakDocument(const string & doc, int kind)
+{
+	vector<size_t> tags;
+	for (size_t i = doc.find('<'); i != string::npos; i = doc.find('<', i + 1)) {
+		if (doc[i + 1] == '/' || (kind == 2 && doc[i + 1] != '?')) {
+			tags.push_back(i);
+		}
+	}
+	if (kind == 2) {
+		const size_t tag = tags[rand() % tags.size()];
+		return doc.substr(0, tag) + "<" + doc.substr(tag);
+	}
+	if (kind == 1) {
+		const size_t tag = tags[rand() % tags.size()];
+		const size_t close = doc.find('>', tag);
+		return doc.substr(0, tag + 2 + rand() % (close - tag - 1)) + doc.substr(close + 1);
+	}
+	auto name = [&](size_t tag) { return doc.substr(tag + 2, doc.find_first_of(" \t\r\n>", tag) - tag - 2); };
+	vector<size_t> swappable;
+	for (size_t j = 0; j + 1 < tags.size(); j++) {
+		if (doc.find_first_not_of(" \t\r\n", doc.find('>', tags[j]) + 1) == tags[j + 1] && name(tags[j]) != name(tags[j + 1])) {
+			swappable.push_back(j);
+		}
+	}
+	const size_t j = swappable[rand() % swappable.size()];
+	const size_t first = tags[j], firstEnd = doc.find('>', first) + 1;
+	const size_t second = tags[j + 1], secondEnd = doc.find('>', second) + 1;
+	return doc.substr(0, first) + doc.substr(second, secondEnd - second) + doc.substr(firstEnd, second - firstEnd)
+	       + doc.substr(first, firstEnd - first) + doc.substr(secondEnd);
+}
+
+// The pull parser gives the result of the property_tree parser on fuzzed
+// copies of doc, with each search implementation, and rejects malformed ones.
+bool checkFuzzedDocuments(const string & doc)
+{
+	const cppxb::scan::Level best = cppxb::scan::detect();
+	srand(17);
+	for (int i = 0; i < 200; i++) {
+		const string fuzzed = fuzzDocument(doc);
+		ptree pt;
+		istringstream in(fuzzed);
+		xml_parser::read_xml(in, pt);
+		tst::testDefinition test;
+		tst::parser::parse(pt.get_child("test"), test);
+		ptree expected;
+		tst::parser::put(test, expected, "test");
+		for (int level = cppxb::scan::SCALAR; level <= best; level++) {
+			cppxb::scan::level = (cppxb::scan::Level)level;
+			cppxb::Reader reader(fuzzed);
+			tst::testDefinition testPull;
+			tst::parser::parse(reader, testPull);
+			ptree actual;
+			tst::parser::put(testPull, actual, "test");
+			if (actual != expected) {
+				cerr << "pull parser at level " << level << " differs from property_tree parser on:" << endl << fuzzed << endl;
+				cppxb::scan::level = best;
+				return false;
+			}
+		}
+		//read_xml only rejects part of these, it neither compares end tag names
+		//nor checks the first character of element names
+		const string broken = breakDocument(fuzzed, i % 3);
+		for (int level = cppxb::scan::SCALAR; level <= best; level++) {
+			cppxb::scan::level = (cppxb::scan::Level)level;
+			try {
+				cppxb::Reader reader(broken);
+				tst::testDefinition testPull;
+				tst::parser::parse(reader, testPull);
+				cerr << "pull parser at level " << level << " accepted malformed document:" << endl << broken << endl;
+				cppxb::scan::level = best;
+				return false;
+			} catch (const cppxb::parse_error &) {
+			}
+		}
+	}
+	cppxb::scan::level = best;
+	return true;
+}
+
+#ifdef CPPXB_LAZY
+// A lazy parse reads the attributes at once and the complex elements on
+// first access, an invalid one failing its accessor only, on every call.
+bool checkLazy(string_view doc, const ptree & expected)
+{
+	cppxb::Reader reader(doc);
+	tst::lazy::testDefinition test;
+	tst::parser::parse(reader, test);
+	if (test.longAttr() != 123456789 || test.enumAttr() != tst::TESTENUM_TE_VAL2 || test._e_child1.size() != 1 || !test._value.child1.empty()
+	        || test._e_child2.size() != 1 || test._value.child2) {
+		cerr << "lazy parse decoded complex elements" << endl;
+		return false;
+	}
+	if (!test.child2() || test.child2()->shapes.shape.size() != 3 || !test._e_child2.empty() || !test._e_child1.size()) {
+		cerr << "wrong lazy child2" << endl;
+		return false;
+	}
+	ptree actual;
+	tst::parser::put(test.value(), actual, "test");
+	if (actual != expected) {
+		cerr << "lazy parser result differs from property_tree parser" << endl;
+		return false;
+	}
+	const string invalid = parallelDocument(10, 3);
+	cppxb::Reader invalidReader(invalid);
+	tst::lazy::testDefinition lazyInvalid;
+	tst::parser::parse(invalidReader, lazyInvalid);
+	for (int call = 0; call < 2; call++) {
+		try {
+			lazyInvalid.child1();
+			cerr << "invalid lazy element accepted on call " << call << endl;
+			return false;
+		} catch (const cppxb::parse_error &) {
+		}
+	}
+	if (lazyInvalid._e_child1.empty() || !lazyInvalid._value.child1.empty()) {
+		cerr << "invalid lazy elements forgotten or partly kept" << endl;
+		return false;
+	}
+	return lazyInvalid.child2().has_value();
+}
+#endif
+
+#ifdef CPPXB_DIRTY
+// Writing a pulled value copies its unchanged elements verbatim and encodes the
+// values along the paths to the changes again.
+bool checkDirty(string_view doc)
+{
+	cppxb::Reader reader(doc);
+	tst::testDefinition test;
+	tst::parser::parse(reader, test);
+	string written;
+	{
+		cppxb::Writer w(written);
+		tst::parser::write(test, w, "test");
+	}
+	if (!test._clean() || written.find(test._source()) == string::npos || test._source().substr(0, 5) != "<test") {
+		cerr << "unchanged document not copied" << endl;
+		return false;
+	}
+	test.edit_child1()[0].set_childStrAtt("changed");
+	test.edit_child2()->edit_shapes().edit_shape()[1]->as_regularPolygon()->set_sideLength(3.5);
+	const tst::chid2Definition & child2 = *test.child2;
+	if (!test._changed(tst::testDefinition::mask::F_child1) || test._changed(tst::testDefinition::mask::F_strAttr)
+	        || child2._clean() || !child2.position._clean() || !child2.shapes.shape[0]->_clean()) {
+		cerr << "wrong changed fields" << endl;
+		return false;
+	}
+	written.clear();
+	{
+		cppxb::Writer w(written);
+		tst::parser::write(test, w, "test");
+	}
+	if (written.find(child2.shapes.shape[0]->_source()) == string::npos || written.find(child2.shapes.shape[2]->_source()) == string::npos
+	        || written.find(child2.position._source()) == string::npos || written.find(child2.shapes.shape[1]->_source()) != string::npos) {
+		cerr << "unchanged elements not copied" << endl;
+		return false;
+	}
+	cppxb::Reader rereader(written);
+	tst::testDefinition reread;
+	tst::parser::parse(rereader, reread);
+	if (reread != test) {
+		cerr << "written document differs from the changed value" << endl;
+		return false;
+	}
+	return true;
+}
+#endif
+
+#ifdef CPPXB_STATS
+const cppxb::stats::Counters & typeStats(const vector<cppxb::stats::TypeStats> & stats, const string & type, cppxb::stats::Operation op)
+{
+	static const cppxb::stats::Counters none;
+	for (const cppxb::stats::TypeStats & s : stats) {
+		if (s.type == type) {
+			return s.operations[op];
+		}
+	}
+	return none;
+}
+
+// The counts of a pull parse and of a write, one of them on another thread.
+bool checkStats(string_view doc)
+{
+	cppxb::stats::reset();
+	tst::testDefinition test;
+	{
+		cppxb::Reader reader(doc);
+		tst::parser::parse(reader, test);
+	}
+	std::thread([doc] {
+		cppxb::Reader reader(doc);
+		tst::testDefinition other;
+		tst::parser::parse(reader, other);
+	}).join();
+#ifdef CPPXB_DIRTY
+	test._touchAll();
+#endif
+	string written;
+	{
+		cppxb::Writer w(written);
+		tst::parser::write(test, w, "test");
+	}
+	const vector<cppxb::stats::TypeStats> stats = cppxb::stats::collect();
+	const cppxb::stats::Counters & parsed = typeStats(stats, "testDefinition", cppxb::stats::PARSE);
+	const size_t root = doc.find("<test"), rootEnd = doc.rfind("</test>") + 7;
+	if (parsed.calls != 2 || parsed.bytes != 2 * (rootEnd - root) || parsed.allocations == 0 || parsed.selfNanoseconds > parsed.nanoseconds) {
+		cerr << "wrong testDefinition parse statistics" << endl;
+		return false;
+	}
+	if (typeStats(stats, "testDefinition", cppxb::stats::SERIALIZE).calls != 1 || typeStats(stats, "regularPolygon", cppxb::stats::PARSE).calls == 0
+	        || typeStats(stats, "abstractShape", cppxb::stats::PARSE).calls != 0) {
+		cerr << "wrong statistics of the nested types" << endl;
+		return false;
+	}
+	ostringstream json;
+	cppxb::stats::dumpJson(json);
+	if (json.str().find("{\"type\":\"testDefinition\",\"operation\":\"parse\",\"calls\":2,") == string::npos) {
+		cerr << "testDefinition missing from the json statistics" << endl;
+		return false;
+	}
+	cppxb::stats::reset();
+	if (typeStats(cppxb::stats::collect(), "testDefinition", cppxb::stats::PARSE).calls != 0) {
+		cerr << "statistics not reset" << endl;
+		return false;
+	}
+	return true;
+}
+#endif
+
+#ifdef CPPXB_ARENA
+// Parses the whole document into arena, checking the object graph was allocated from it.
+bool loadTestArena(cppxb::arena_ptr<tst::testDefinition> & test, std::pmr::memory_resource & arena, const cppxb::MappedFile & doc)
+{
+	try {
+		cppxb::Reader reader(doc.view());
+		tst::parser::parse(reader, test, arena);
+	} catch (const std::runtime_error & e) {
+		cerr << e.what() << endl;
+		return false;
+	}
+	if (test->child1.get_allocator().resource() != &arena) {
+		cerr << "arena parse did not allocate from the arena" << endl;
+		return false;
+	}
+	return true;
+}
+#endif
+
+// Writes test with cppxb::Writer and reads it back, out keeps the strings of
+// the result alive when generated with -view.
+bool checkWrite(const tst::testDefinition & test, const ptree & expected, string & out)
+{
+	{
+		cppxb::Writer w(out);
+		tst::parser::write(test, w, "test");
+	}
+	ostringstream stream;
+	{
+		cppxb::Writer w(stream);
+		tst::parser::write(test, w, "test");
+	}
+	if (stream.str() != out) {
+		cerr << "stream writer output differs from string writer output" << endl;
+		return false;
+	}
+	tst::testDefinition testWrite;
+	try {
+		cppxb::Reader reader(out);
+		tst::parser::parse(reader, testWrite);
+	} catch (const std::runtime_error & e) {
+		cerr << e.what() << endl;
+		return false;
 	}
-	return pt;
+	if (!checkShapes(testWrite)) {
+		return false;
+	}
+	ptree actual;
+	tst::parser::put(testWrite, actual, "test");
+	if (expected != actual) {
+		cerr << "written document differs from the original" << endl;
+		return false;
+	}
+	return true;
+}
+
+// Encodes test and decodes it back, data keeps the strings of the result alive when
+// generated with -view. Data of another schema and truncated data must be rejected.
+bool checkBinary(const tst::testDefinition & test, const ptree & expected, string & data)
+{
+	tst::parser::encode(test, data);
+	tst::testDefinition testDecoded;
+	try {
+		tst::parser::decode(data, testDecoded);
+	} catch (const std::runtime_error & e) {
+		cerr << e.what() << endl;
+		return false;
+	}
+	if (!checkShapes(testDecoded)) {
+		return false;
+	}
+	ptree actual;
+	tst::parser::put(testDecoded, actual, "test");
+	if (expected != actual) {
+		cerr << "decoded document differs from the original" << endl;
+		return false;
+	}
+	string child;
+	tst::parser::encode(test.child1.front(), child);
+	try {
+		tst::parser::decode(child, testDecoded);
+		cerr << "binary data of another type was decoded" << endl;
+		return false;
+	} catch (const std::runtime_error &) {
+	}
+	try {
+		tst::parser::decode(std::string_view(data).substr(0, data.size() - 1), testDecoded);
+		cerr << "truncated binary data was decoded" << endl;
+		return false;
+	} catch (const std::runtime_error &) {
+	}
+	return true;
 }
 
-ptree writeTest(const tst::testDefinition & t, const string & filePath)
+// Changes a copy of test and patches another copy into it: an attribute, an item inserted in
+// child1, a shape of another type and the optional strAttrOpt, then the reverse patch, and
+// strAttrOpt set to another value.
+bool checkPatch(const tst::testDefinition & test)
 {
+	tst::testDefinition to = test;
+	cppxb::Patch patch;
+	tst::parser::diff(test, to, patch);
+	if (to != test || !patch.empty()) {
+		cerr << "copy differs from the original" << endl;
+		return false;
+	}
+	to.strAttr = "patched";
+	tst::child1Definition child = to.child1.front();
+	child.childStrAtt = "inserted";
+	to.child1.insert(to.child1.begin(), child);
+	to.child2->shapes.shape[2] = to.child2->shapes.shape[0];
+	if (to.strAttrOpt) {
+		to.strAttrOpt = boost::none;
+	} else {
+		to.strAttrOpt = "optional";
+	}
+	tst::parser::diff(test, to, patch);
+	if (to == test || patch.edits.size() != 4) {
+		cerr << "diff found " << patch.edits.size() << " edits instead of 4" << endl;
+		return false;
+	}
+	string data;
+	patch.encode(data);
+	cppxb::Patch decoded;
+	decoded.decode(data);
+	tst::testDefinition patched = test;
+	tst::parser::apply(patched, decoded);
+	if (patched != to || !patched.child2->shapes.shape[2]->as_polygon()) {
+		cerr << "patched value differs from the changed one" << endl;
+		return false;
+	}
+	cppxb::Patch reverse;
+	tst::parser::diff(to, test, reverse);
+	tst::parser::apply(patched, reverse);
+	if (patched != test || !checkShapes(patched)) {
+		cerr << "reverse patch did not restore the original" << endl;
+		return false;
+	}
+	tst::testDefinition from = test;
+	from.strAttrOpt = "hello";
+	to = from;
+	to.strAttrOpt = "world, longer";
+	tst::parser::diff(from, to, patch);
+	tst::parser::apply(from, patch);
+	if (patch.edits.size() != 1 || from != to) {
+		cerr << "optional value changed to another one not patched" << endl;
+		return false;
+	}
+	tst::parser::diff(child, test.child1.front(), patch);
+	try {
+		tst::parser::apply(patched, patch);
+		cerr << "patch of another type was applied" << endl;
+		return false;
+	} catch (const std::runtime_error &) {
+	}
+	return true;
+}
+
+#ifdef CPPXB_SNAPSHOT
+// Writes a snapshot of test to filePath and reads it back in place through the views.
+bool checkSnapshot(const tst::testDefinition & test, const string & filePath)
+{
+	string image;
+	tst::parser::snapshot(test, image);
+	{
+		ofstream out(filePath.c_str(), ios::binary);
+		out << image;
+	}
+	const cppxb::Snapshot snapshot(filePath);
+	const tst::view::testDefinition v(snapshot);
+	if (test.strAttr != v.strAttr() || v.longAttr() != test.longAttr || v.boolAttr() != test.boolAttr
+	        || v.dblAttr() != test.dblAttr || v.enumAttr() != test.enumAttr
+	        || bool(v.strAttrOpt()) != bool(test.strAttrOpt) || (test.strAttrOpt && *test.strAttrOpt != *v.strAttrOpt())) {
+		cerr << "wrong snapshot attributes" << endl;
+		return false;
+	}
+	size_t i = 0;
+	for (const tst::view::child1Definition & child : v.child1()) {
+		if (i >= test.child1.size() || test.child1[i].childStrAtt != child.childStrAtt() || child.subChild3Elems().size() != 3
+		        || test.child1[i].subChild3Elems[2] != child.subChild3Elems()[2]) {
+			cerr << "wrong snapshot child1" << endl;
+			return false;
+		}
+		i++;
+	}
+	if (i != test.child1.size() || !v.child2()) {
+		cerr << "wrong snapshot children" << endl;
+		return false;
+	}
+	const cppxb::SnapshotRange< cppxb::SnapshotRecord<tst::view::abstractShape> > shapes = v.child2()->shapes().shape();
+	if (shapes.size() != 3 || !shapes[0].as_polygon() || shapes[0].as_regularPolygon() || shapes[1].as_ellipsoid()
+	        || shapes[1].as_polygon().point().size() != 4 || shapes[1].as_regularPolygon().sideLength() != 2.5
+	        || shapes[2].as_ellipsoid().center().y() != 2.3 || v.child2()->position().x() != 56.7) {
+		cerr << "wrong snapshot shapes" << endl;
+		return false;
+	}
+	try {
+		tst::view::child1Definition child(snapshot);
+		cerr << "snapshot of another type was opened" << endl;
+		return false;
+	} catch (const std::runtime_error &) {
+	}
+	return true;
+}
+#endif
+
+template<typename S>
+size_t heapString(const S & s)
+{
+	return s.size() > S().capacity() ? 1 : 0;
+}
+
+size_t heapString(const cppxb::xstring &)
+{
+	return 0;
+}
+
+// Parsing a property_tree allocates the strings which do not fit inline, the
+// vectors and the polymorphic children, once each.
+bool checkParseAllocations(const ptree & pt, const tst::testDefinition & expected)
+{
+	size_t minimum = heapString(expected.strAttr) + (expected.strAttrOpt ? heapString(*expected.strAttrOpt) : 0);
+	minimum += expected.child1.empty() ? 0 : 1;
+	BOOST_FOREACH(const tst::child1Definition & child, expected.child1) {
+		minimum += heapString(child.childStrAtt);
+		BOOST_FOREACH(const auto & s, child.subChild3Elems) {
+			minimum += heapString(s);
+		}
+	}
+	if (expected.child2) {
+		minimum += heapString(expected.child2->id) + (expected.child2->shapes.shape.empty() ? 0 : 1);
+		BOOST_FOREACH(const auto & shape, expected.child2->shapes.shape) {
+			minimum++;
+			if (const tst::polygon * p = shape->as_polygon()) {
+#ifdef CPPXB_COLUMNS
+				minimum += p->point.empty() ? 0 : 4;//the x, y, label and has_label columns
+#else
+				minimum += p->point.empty() ? 0 : 1;
+#endif
+			}
+		}
+	}
+	tst::testDefinition test;
+	const size_t before = allocations;
+	tst::parser::parse(pt, test);
+	const size_t made = allocations - before;
+	if (made != minimum) {
+		cerr << "property_tree parse made " << made << " allocations, expected " << minimum << endl;
+		return false;
+	}
+	return true;
+}
+
+// sample.xml, written by cppXb -sample when the tests are generated, is valid
+// and read the same by both parsers.
+bool checkSample(const string & filePath)
+{
+	if (!ifstream(filePath.c_str())) {
+		return true;
+	}
+	tst::testDefinition test, testPull;
 	ptree pt;
-	tst::parser::put(t, pt, "test");
-	xml_parser::xml_writer_settings<ptree::key_type> settings('\t', 1);
-	xml_parser::write_xml(filePath, pt, std::locale(), settings);
-	return pt;
+	const cppxb::MappedFile doc(filePath);
+	if (!loadTest(test, pt, filePath) || !loadTestPull(testPull, doc)) {
+		return false;
+	}
+	cppxb::Validation validation;
+	if (!tst::parser::validate(doc.view(), (const tst::testDefinition *)0, validation)) {
+		cerr << "invalid sample: " << validation.violations()[0].message << endl;
+		return false;
+	}
+	ptree expected, actual;
+	tst::parser::put(test, expected, "test");
+	tst::parser::put(testPull, actual, "test");
+	if (expected != actual || test.child1.empty()) {
+		cerr << "sample read differently by the parsers" << endl;
+		return false;
+	}
+	return true;
+}
+
+void writeTest(const tst::testDefinition & t, const string & filePath)
+{
+	ofstream out(filePath.c_str());
+	cppxb::Writer w(out);
+	tst::parser::write(t, w, "test");
 }
 
 int main(int , char **)
 {
 	try {
 		tst::testDefinition test;
-		ptree ptTest = loadTest(test, "test.xml");
+		ptree ptTest;
+		if (!loadTest(test, ptTest, "test.xml")) {
+			return 1;
+		}
 		printTest(test);
+		if (!checkShapes(test) || !checkEnums() || !checkMissingAttribute() || !checkEndTags() || !checkConversions()
+		        || !checkParseAllocations(ptTest.get_child("test"), test)) {
+			return 1;
+		}
+
+		const cppxb::MappedFile doc("test.xml");
+		tst::testDefinition testPull;
+		if (!loadTestPull(testPull, doc) || !checkShapes(testPull) || !checkReparse() || !checkParallel()) {
+			return 1;
+		}
+		ptree expected, actual;
+		tst::parser::put(test, expected, "test");
+		tst::parser::put(testPull, actual, "test");
+		if (expected != actual) {
+			cerr << "pull parser result differs from property_tree parser" << endl;
+			return 1;
+		}
+		if (!checkBatch(doc.view(), expected) || !checkMask(doc.view()) || !checkScan()
+		        || !checkFuzzedDocuments(string(doc.view())) || !checkValidate(doc.view()) || !checkSample("sample.xml")) {
+			return 1;
+		}
+#ifdef CPPXB_LAZY
+		if (!checkLazy(doc.view(), expected)) {
+			return 1;
+		}
+#endif
+#ifdef CPPXB_DIRTY
+		if (!checkDirty(doc.view())) {
+			return 1;
+		}
+#endif
+#ifdef CPPXB_STATS
+		if (!checkStats(doc.view())) {
+			return 1;
+		}
+#endif
+		tst::testDefinition testPut;
+		tst::parser::parse(expected.get_child("test"), testPut);
+		if (!checkShapes(testPut)) {
+			return 1;
+		}
+
+		string written;
+		if (!checkWrite(test, expected, written)) {
+			return 1;
+		}
+		string encoded;
+		if (!checkBinary(test, expected, encoded) || !checkPatch(test)) {
+			return 1;
+		}
+#ifdef CPPXB_SNAPSHOT
+		if (!checkSnapshot(test, "test.snapshot")) {
+			return 1;
+		}
+#endif
+
+		tst::testDefinition testStream;
+		Child1Counter counter;
+		if (!loadTestPull(testStream, doc, &counter)) {
+			return 1;
+		}
+		if (counter.count != test.child1.size() || !testStream.child1.empty()) {
+			cerr << "streamed child1 items were not handed to the visitor" << endl;
+			return 1;
+		}
+#ifdef CPPXB_ARENA
+		std::pmr::monotonic_buffer_resource arena;
+		cppxb::arena_ptr<tst::testDefinition> testArena;
+		if (!loadTestArena(testArena, arena, doc) || !checkShapes(*testArena)) {
+			return 1;
+		}
+		ptree arenaTree;
+		tst::parser::put(*testArena, arenaTree, "test");
+		if (expected != arenaTree) {
+			cerr << "arena parser result differs from property_tree parser" << endl;
+			return 1;
+		}
+#endif
 	} catch (const std::exception & e) {
 		cerr << e.what() << endl;
+		return 1;
 	}
 	return 0;
 }